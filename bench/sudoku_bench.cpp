@@ -0,0 +1,503 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <regex>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.hpp>
+
+#include "batch_solver.hpp"
+#include "generators.hpp"
+#include "propagate.hpp"
+#include "sudoku.hpp"
+#include "util.hpp"
+
+#ifndef SUDOKU_BENCH_CORPUS
+#define SUDOKU_BENCH_CORPUS "bench/corpus.txt"
+#endif
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_t_;
+
+    /**
+     * @brief Keeps the compiler from optimizing away benchmarked results.
+     *
+     */
+    volatile long long sink;
+
+    /**
+     * @brief Stream buffer swallowing everything, to silence the generators.
+     *
+     */
+    class null_buffer : public std::streambuf
+    {
+    protected:
+        int overflow(int c) override
+        {
+            return c;
+        }
+    };
+
+    /**
+     * @brief Seed used for every RNG in the benchmarks, so runs are comparable.
+     *
+     */
+    constexpr uint64_t SEED = 0x5eed;
+
+    struct options
+    {
+        std::string corpus_filename{SUDOKU_BENCH_CORPUS};
+        std::regex filter{".*"};
+        double min_time{0.5};
+        double macro_time{3.0};
+        bool run_macro{true};
+        std::vector<std::pair<std::string, sudoku::search_mode>> solvers{
+            {"mrv", sudoku::search_mode::mrv},
+            {"dlx", sudoku::search_mode::dlx},
+            {"backtrack", sudoku::search_mode::first_free}};
+        std::vector<propagate::kernel> kernels{propagate::best()};
+    };
+
+    /**
+     * @brief Get the candidate kernels to benchmark a solver with.
+     *
+     * Only `search_mode::mrv` uses the kernels, so the other solvers run once.
+     */
+    std::vector<propagate::kernel> kernels_for(sudoku::search_mode search, options const &opt)
+    {
+        if (search == sudoku::search_mode::mrv)
+        {
+            return opt.kernels;
+        }
+        return {opt.kernels.front()};
+    }
+
+    std::string kernel_suffix(sudoku::search_mode search, propagate::kernel k)
+    {
+        return search == sudoku::search_mode::mrv ? std::string("/") + propagate::name(k) : std::string();
+    }
+
+    void print_header()
+    {
+        std::cout << std::string(86, '-') << '\n'
+                  << std::left << std::setw(52) << "Benchmark"
+                  << std::right << std::setw(16) << "Time"
+                  << std::setw(18) << "Iterations" << '\n'
+                  << std::string(86, '-') << '\n';
+    }
+
+    /**
+     * @brief Run `fn(n)` with growing `n` until it takes at least `min_time` seconds, then report the time per iteration.
+     *
+     * @param fn runs the benchmarked operation n times
+     */
+    void run_micro(std::string const &name, options const &opt, std::function<void(long long)> const &fn)
+    {
+        if (!std::regex_search(name, opt.filter))
+        {
+            return;
+        }
+        long long n = 1;
+        double elapsed;
+        while (true)
+        {
+            auto const t0 = clock_t_::now();
+            fn(n);
+            elapsed = std::chrono::duration<double>(clock_t_::now() - t0).count();
+            if (elapsed >= opt.min_time || n >= (1LL << 40))
+            {
+                break;
+            }
+            // aim a little beyond min_time to finish in the next round
+            double const factor = elapsed > 0 ? 1.4 * opt.min_time / elapsed : 100.;
+            n = std::max(n + 1, static_cast<long long>(static_cast<double>(n) * std::min(factor, 100.)));
+        }
+        double const ns = elapsed * 1e9 / static_cast<double>(n);
+        std::cout << std::left << std::setw(52) << name
+                  << std::right << std::setw(13) << std::fixed << std::setprecision(ns < 100 ? 2 : 0) << ns << " ns"
+                  << std::setw(18) << n << '\n'
+                  << std::flush;
+    }
+
+    /**
+     * @brief Read the benchmark corpus and group its boards by level.
+     *
+     */
+    std::map<int, std::vector<sudoku::board_t>> load_corpus(std::string const &filename, std::vector<std::string> &level_names)
+    {
+        std::map<int, std::vector<sudoku::board_t>> tiers;
+        std::map<int, std::string> names;
+        std::ifstream fin{filename};
+        std::string line;
+        sudoku game;
+        while (std::getline(fin, line))
+        {
+            line = util::trim(line, " \t\r\n");
+            if (line.empty() || line.front() == '#' || line.length() != 81)
+            {
+                continue;
+            }
+            game.assign(line);
+            // the upper empty-cell bound of the tier as in `sudoku::level()` serves as sort key
+            static const std::array<int, 6> BOUNDS{25, 35, 45, 52, 58, 64};
+            auto const bound = std::find_if(BOUNDS.begin(), BOUNDS.end(), [&game](int b)
+                                            { return game.empty_count() <= b; });
+            int const key = bound == BOUNDS.end() ? 81 : *bound;
+            tiers[key].push_back(game.board());
+            names[key] = game.level();
+        }
+        for (auto const &n : names)
+        {
+            level_names.push_back(n.second);
+        }
+        return tiers;
+    }
+
+    void run_micro_benchmarks(options const &opt)
+    {
+        std::vector<std::string> level_names;
+        auto const tiers = load_corpus(opt.corpus_filename, level_names);
+        if (tiers.empty())
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m No boards in " << opt.corpus_filename << ".\n";
+            exit(EXIT_FAILURE);
+        }
+        sudoku::rng_t rng(SEED);
+        sudoku game(rng);
+        auto level_name = level_names.begin();
+        for (auto const &tier : tiers)
+        {
+            std::string const &level = *level_name++;
+            std::vector<sudoku::board_t> const &boards = tier.second;
+            // preloaded games for the benchmarks that don't modify the board
+            std::vector<std::unique_ptr<sudoku>> games;
+            for (auto const &board : boards)
+            {
+                games.emplace_back(std::make_unique<sudoku>(board));
+            }
+            run_micro("is_safe/" + level, opt, [&](long long n)
+                      {
+                long long safe = 0;
+                for (long long i = 0; i < n; ++i)
+                {
+                    unsigned int const idx = static_cast<unsigned int>(i % 81);
+                    safe += games[static_cast<std::size_t>(i / 81) % games.size()]->is_safe(idx, static_cast<char>('1' + (i / 9) % 9));
+                }
+                sink = safe; });
+            // the row, column and box masks of the boards, as the kernels scan them
+            std::vector<std::array<uint16_t, 27>> masks;
+            for (auto const &board : boards)
+            {
+                std::array<uint16_t, 27> used{};
+                for (unsigned int i = 0; i < 81; ++i)
+                {
+                    uint16_t const bit = sudoku::bit(board[i]);
+                    used[i / 9] |= bit;
+                    used[9 + i % 9] |= bit;
+                    used[18 + (i / 27) * 3 + (i % 9) / 3] |= bit;
+                }
+                masks.push_back(used);
+            }
+            for (propagate::kernel k : opt.kernels)
+            {
+                propagate::select(k);
+                run_micro("scan/" + level + "/" + propagate::name(k), opt, [&](long long n)
+                          {
+                    propagate::scan_result scan;
+                    long long singles = 0;
+                    for (long long i = 0; i < n; ++i)
+                    {
+                        std::size_t const b = static_cast<std::size_t>(i) % boards.size();
+                        propagate::scan(masks[b].data(), masks[b].data() + 9, masks[b].data() + 18, boards[b].data(), scan);
+                        singles += scan.naked[0] + scan.contradiction;
+                    }
+                    sink = singles; });
+            }
+            for (auto const &solver : opt.solvers)
+            {
+                for (propagate::kernel k : kernels_for(solver.second, opt))
+                {
+                    propagate::select(k);
+                    std::string const suffix = "/" + level + "/" + solver.first + kernel_suffix(solver.second, k);
+                    game.set_search_mode(solver.second);
+                    for (auto &g : games)
+                    {
+                        g->set_search_mode(solver.second);
+                    }
+                    run_micro("find_free_cell" + suffix, opt, [&](long long n)
+                              {
+                        long long found = 0;
+                        unsigned int row, col;
+                        for (long long i = 0; i < n; ++i)
+                        {
+                            found += games[static_cast<std::size_t>(i) % games.size()]->find_free_cell(row, col);
+                        }
+                        sink = found; });
+                    run_micro("solve_single" + suffix, opt, [&](long long n)
+                              {
+                        long long solved = 0;
+                        for (long long i = 0; i < n; ++i)
+                        {
+                            game.assign(boards[static_cast<std::size_t>(i) % boards.size()]);
+                            solved += game.solve_single();
+                        }
+                        sink = solved; });
+                    run_micro("has_one_clear_solution" + suffix, opt, [&](long long n)
+                              {
+                        long long unique = 0;
+                        for (long long i = 0; i < n; ++i)
+                        {
+                            game.assign(boards[static_cast<std::size_t>(i) % boards.size()]);
+                            unique += game.has_one_clear_solution();
+                        }
+                        sink = unique; });
+                    run_micro("solution_count" + suffix, opt, [&](long long n)
+                              {
+                        long long count = 0;
+                        for (long long i = 0; i < n; ++i)
+                        {
+                            game.assign(boards[static_cast<std::size_t>(i) % boards.size()]);
+                            count += game.solution_count();
+                        }
+                        sink = count; });
+                    // per board, checked LANES at a time
+                    batch_solver batch(solver.second);
+                    std::vector<uint8_t> n_solutions(boards.size());
+                    run_micro("unique_batch" + suffix, opt, [&](long long n)
+                              {
+                        long long unique = 0;
+                        for (long long done = 0; done < n;)
+                        {
+                            std::size_t const count = static_cast<std::size_t>(std::min<long long>(n - done, static_cast<long long>(boards.size())));
+                            batch.unique_batch(std::span<sudoku::board_t const>(boards.data(), count), n_solutions);
+                            unique += std::count(n_solutions.begin(), n_solutions.begin() + static_cast<std::ptrdiff_t>(count), uint8_t{1});
+                            done += static_cast<long long>(count);
+                        }
+                        sink = unique; });
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Run a generator thread for `macro_time` seconds and report its throughput and heap allocations.
+     *
+     */
+    void run_macro(std::string const &name, options const &opt, algorithm_t const &algorithm, int difficulty, sudoku::search_mode search)
+    {
+        if (!std::regex_search(name, opt.filter))
+        {
+            return;
+        }
+        board_sink sink;
+        sudoku::rng_t rng(SEED);
+        std::unique_ptr<grid_pool> pool;
+        if (algorithm.uses_pool)
+        {
+            pool = std::make_unique<grid_pool>(1, search, SEED);
+            sink.pool = pool.get();
+        }
+        std::atomic<bool> running{true};
+        std::atomic<bool> finished{false};
+        long long n_produced = 0;
+        long long n_valid = 0;
+        // the generators chat on stdout
+        null_buffer discard;
+        auto *cout_buf = std::cout.rdbuf(&discard);
+        auto const t0 = clock_t_::now();
+        std::thread generator([&]
+                              {
+            algorithm.generator(difficulty, search, rng, sink, running);
+            finished.store(true); });
+        found_board result;
+        while (std::chrono::duration<double>(clock_t_::now() - t0).count() < opt.macro_time)
+        {
+            if (sink.queue.try_pop(result))
+            {
+                ++n_produced;
+                n_valid += result.complete;
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        running.store(false);
+        // keep draining, so the generator doesn't block on a full queue while finishing its board
+        while (!finished.load())
+        {
+            while (sink.queue.try_pop(result))
+            {
+            }
+            std::this_thread::yield();
+        }
+        generator.join();
+        if (pool)
+        {
+            pool->stop();
+        }
+        double const elapsed = std::chrono::duration<double>(clock_t_::now() - t0).count();
+        // the first game pays for setting up the generator
+        uint64_t const n_games = sink.perf.n_games.load();
+        double const allocs_per_game = n_games > 1 ? static_cast<double>(sink.perf.n_allocs.load()) / static_cast<double>(n_games - 1) : 0.0;
+        std::cout.rdbuf(cout_buf);
+        std::cout << std::left << std::setw(52) << name
+                  << std::right << std::setw(10) << std::fixed << std::setprecision(1) << (static_cast<double>(n_valid) / elapsed) << " valid/s"
+                  << std::setw(10) << std::setprecision(1) << (static_cast<double>(n_produced) / elapsed) << " total/s"
+                  << std::setw(10) << std::setprecision(3) << allocs_per_game << " allocs/game\n"
+                  << std::flush;
+    }
+
+    void run_macro_benchmarks(options const &opt)
+    {
+        static const std::vector<int> DIFFICULTIES{45, 55, 60};
+        std::vector<std::string> names;
+        for (auto const &a : ALGORITHMS)
+        {
+            // the adaptive generator just runs the others
+            if (!a.second.adaptive)
+            {
+                names.push_back(a.first);
+            }
+        }
+        std::sort(names.begin(), names.end());
+        for (auto const &name : names)
+        {
+            for (int difficulty : DIFFICULTIES)
+            {
+                for (auto const &solver : opt.solvers)
+                {
+                    for (propagate::kernel k : kernels_for(solver.second, opt))
+                    {
+                        propagate::select(k);
+                        run_macro(name + "/" + std::to_string(difficulty) + "/" + solver.first + kernel_suffix(solver.second, k),
+                                  opt, ALGORITHMS.at(name), difficulty, solver.second);
+                    }
+                }
+            }
+        }
+    }
+
+    void usage()
+    {
+        std::cout << "USAGE:\n\n"
+                     "  sudoku_bench [--filter REGEX] [--min-time SECONDS] [--macro-time SECONDS]\n"
+                     "               [--solver mrv|dlx|backtrack] [--corpus FILE] [--no-macro]\n"
+                     "               [--kernel all|scalar|sse4.1|avx2|neon]\n\n"
+                     "Micro benchmarks run on the boards of the corpus, grouped by level.\n"
+                     "Macro benchmarks run each generator algorithm at several difficulties.\n"
+                     "The mrv solver runs with the candidate kernel given, by default with\n"
+                     "the fastest one the CPU supports (here: " << propagate::name(propagate::best()) << ").\n\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options opt;
+    using argparser = argparser::argparser;
+    argparser parser(argc, argv);
+    parser
+        .reg({"-?", "--help"}, argparser::no_argument, [](std::string const &)
+             {
+                usage();
+                exit(EXIT_SUCCESS); })
+        .reg({"--filter"}, argparser::required_argument, [&opt](std::string const &val)
+             { opt.filter = std::regex(val); })
+        .reg({"--min-time"}, argparser::required_argument, [&opt](std::string const &val)
+             { opt.min_time = std::stod(val); })
+        .reg({"--macro-time"}, argparser::required_argument, [&opt](std::string const &val)
+             { opt.macro_time = std::stod(val); })
+        .reg({"--no-macro"}, argparser::no_argument, [&opt](std::string const &)
+             { opt.run_macro = false; })
+        .reg({"--corpus"}, argparser::required_argument, [&opt](std::string const &val)
+             { opt.corpus_filename = val; })
+        .reg({"--solver"}, argparser::required_argument, [&opt](std::string const &val)
+             {
+                auto it = std::find_if(opt.solvers.begin(), opt.solvers.end(), [&val](auto const &s)
+                                       { return s.first == val; });
+                if (it == opt.solvers.end())
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid solver: " << val << "\n\n";
+                    exit(EXIT_FAILURE);
+                }
+                opt.solvers = {*it}; })
+        .reg({"--kernel"}, argparser::required_argument, [&opt](std::string const &val)
+             {
+                opt.kernels.clear();
+                propagate::kernel k;
+                if (val == "all")
+                {
+                    for (unsigned int i = 0; i < static_cast<unsigned int>(propagate::kernel::KERNEL_COUNT); ++i)
+                    {
+                        if (propagate::available(static_cast<propagate::kernel>(i)))
+                        {
+                            opt.kernels.push_back(static_cast<propagate::kernel>(i));
+                        }
+                    }
+                }
+                else if (!propagate::from_name(val, k))
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid kernel: " << val << "\n\n";
+                    exit(EXIT_FAILURE);
+                }
+                else if (!propagate::available(k))
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m kernel not supported on this machine: " << val << "\n\n";
+                    exit(EXIT_FAILURE);
+                }
+                else
+                {
+                    opt.kernels.push_back(k);
+                } });
+    try
+    {
+        parser();
+    }
+    catch (::argparser::argument_required_exception const &e)
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m " << e.what() << "\n\n";
+        usage();
+        return EXIT_FAILURE;
+    }
+    print_header();
+    run_micro_benchmarks(opt);
+    if (opt.run_macro)
+    {
+        std::cout << '\n';
+        run_macro_benchmarks(opt);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __LIBSUDOKU_H__
+#define __LIBSUDOKU_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Version of the API declared here.
+ *
+ * Functions and types only ever get added to this header; once there, their
+ * meaning doesn't change, so code written against an older version keeps
+ * working.
+ */
+#define SUDOKU_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief A reusable workspace for solving, grading and generating, with a random number stream of its own.
+     *
+     * Creating a context sets up everything the functions below need, so
+     * calls on it don't allocate memory. A context must not be used by two
+     * threads at the same time; keep one per thread.
+     */
+    typedef struct sudoku_context sudoku_context;
+
+    enum sudoku_status
+    {
+        SUDOKU_OK = 0,
+        /**
+         * @brief The board isn't 81 cells of '1' to '9', '0' or '.', or contradicts itself.
+         */
+        SUDOKU_INVALID_BOARD = -1,
+        SUDOKU_INVALID_ARGUMENT = -2,
+        /**
+         * @brief `sudoku_generate()` gave up after the number of attempts it was given.
+         */
+        SUDOKU_GAVE_UP = -3
+    };
+
+    enum sudoku_solver
+    {
+        /**
+         * @brief Branch on the empty cell with the fewest candidates (the default).
+         */
+        SUDOKU_SOLVER_MRV = 0,
+        /**
+         * @brief Branch on the first empty cell in row-major order.
+         */
+        SUDOKU_SOLVER_BACKTRACK = 1,
+        /**
+         * @brief Knuth's Dancing Links.
+         */
+        SUDOKU_SOLVER_DLX = 2
+    };
+
+    /**
+     * @brief How hard a board is for a human (see `sudoku_grade()`).
+     *
+     * `technique` is the hardest technique needed, numbered from 1 (hidden
+     * single) to 13 (the board can't be solved without guessing), or 0 if
+     * the board is already solved; `technique_name` names it. `solved` is
+     * 0 if the grader's techniques didn't get the board solved.
+     */
+    typedef struct sudoku_rating
+    {
+        double rating;
+        int technique;
+        char const *technique_name;
+        int solved;
+    } sudoku_rating;
+
+    int sudoku_api_version(void);
+
+    /**
+     * @brief Create a context whose random number stream starts at `seed`.
+     *
+     * @return the context, or NULL if there's no memory left
+     */
+    sudoku_context *sudoku_context_new(uint64_t seed);
+
+    void sudoku_context_free(sudoku_context *ctx);
+
+    /**
+     * @brief Select the solver, one of `sudoku_solver`.
+     *
+     */
+    int sudoku_context_set_solver(sudoku_context *ctx, int solver);
+
+    /**
+     * @brief Solve a board.
+     *
+     * Boards are 81 chars, row by row, each one '1' to '9', or '0' or '.'
+     * for an empty cell; they don't need to be null-terminated.
+     *
+     * @param solution receives the first solution, null-terminated, if there's any; room for 82 chars, or NULL
+     * @return the number of solutions, counting stops at 2; or a negative `sudoku_status`
+     */
+    int sudoku_solve(sudoku_context *ctx, char const *board, char *solution);
+
+    /**
+     * @brief Check if a board has exactly one solution.
+     *
+     * @return 1 if it has, 0 if not, or a negative `sudoku_status`
+     */
+    int sudoku_is_unique(sudoku_context *ctx, char const *board);
+
+    /**
+     * @brief Rate a board by the techniques a human needs to solve it.
+     *
+     * Ratings roughly follow the Sudoku Explainer scale, from 1.5 (hidden
+     * single) to 10 (needs guessing).
+     *
+     * @return `SUDOKU_OK`, or a negative `sudoku_status`
+     */
+    int sudoku_grade(sudoku_context *ctx, char const *board, sudoku_rating *rating);
+
+    /**
+     * @brief Generate a board that has exactly one solution and `empty_cells` empty cells, from 0 to 64.
+     *
+     * Boards rated below `min_rating` are dropped. Gives up after
+     * `max_attempts` solved grids that didn't yield such a board; 0 for
+     * no limit.
+     *
+     * @param board receives the board, null-terminated; room for 82 chars
+     * @return `SUDOKU_OK`, or a negative `sudoku_status`
+     */
+    int sudoku_generate(sudoku_context *ctx, int empty_cells, double min_rating, unsigned int max_attempts, char *board);
+
+#ifdef __cplusplus
+}
+
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace libsudoku
+{
+    /**
+     * @brief Owns a `sudoku_context`, throwing `std::invalid_argument` for invalid boards.
+     *
+     * A generator that gives up throws `std::runtime_error` instead.
+     */
+    class context
+    {
+    public:
+        explicit context(uint64_t seed = 0)
+            : ctx_(sudoku_context_new(seed))
+        {
+            if (ctx_ == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+        }
+
+        ~context()
+        {
+            sudoku_context_free(ctx_);
+        }
+
+        context(context &&other) noexcept
+            : ctx_(std::exchange(other.ctx_, nullptr))
+        {
+        }
+
+        context &operator=(context &&other) noexcept
+        {
+            std::swap(ctx_, other.ctx_);
+            return *this;
+        }
+
+        context(context const &) = delete;
+        context &operator=(context const &) = delete;
+
+        void set_solver(sudoku_solver solver)
+        {
+            check(sudoku_context_set_solver(ctx_, solver));
+        }
+
+        /**
+         * @return the number of solutions, up to 2, the first one in `solution`
+         */
+        int solve(std::string_view board, std::string &solution)
+        {
+            char buffer[82];
+            int const n = check(sudoku_solve(ctx_, valid(board), buffer));
+            if (n > 0)
+            {
+                solution.assign(buffer, 81);
+            }
+            return n;
+        }
+
+        bool is_unique(std::string_view board)
+        {
+            return check(sudoku_is_unique(ctx_, valid(board))) == 1;
+        }
+
+        sudoku_rating grade(std::string_view board)
+        {
+            sudoku_rating rating;
+            check(sudoku_grade(ctx_, valid(board), &rating));
+            return rating;
+        }
+
+        /**
+         * @brief Generate a board, see `sudoku_generate()`; with no limit on the attempts.
+         *
+         */
+        std::string generate(int empty_cells, double min_rating = 0)
+        {
+            char buffer[82];
+            check(sudoku_generate(ctx_, empty_cells, min_rating, 0, buffer));
+            return std::string(buffer, 81);
+        }
+
+        inline sudoku_context *get() const
+        {
+            return ctx_;
+        }
+
+    private:
+        static char const *valid(std::string_view board)
+        {
+            if (board.size() < 81)
+            {
+                throw std::invalid_argument("board must have 81 cells");
+            }
+            return board.data();
+        }
+
+        static int check(int rc)
+        {
+            if (rc == SUDOKU_INVALID_BOARD)
+            {
+                throw std::invalid_argument("invalid board");
+            }
+            if (rc == SUDOKU_GAVE_UP)
+            {
+                throw std::runtime_error("search gave up");
+            }
+            if (rc < 0)
+            {
+                throw std::invalid_argument("invalid argument");
+            }
+            return rc;
+        }
+
+        sudoku_context *ctx_;
+    };
+}
+#endif
+
+#endif // __LIBSUDOKU_H__
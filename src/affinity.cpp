@@ -0,0 +1,252 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifdef _MSC_VER
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "affinity.hpp"
+
+namespace affinity
+{
+    namespace
+    {
+#ifdef __linux__
+        /**
+         * @brief Parse a CPU list like "0-15,32-47".
+         *
+         */
+        std::vector<unsigned int> parse_cpu_list(std::string const &list)
+        {
+            std::vector<unsigned int> cpus;
+            std::istringstream in(list);
+            std::string range;
+            while (std::getline(in, range, ','))
+            {
+                if (range.empty() || range.find_first_not_of("0123456789-\r\n") != std::string::npos)
+                {
+                    continue;
+                }
+                std::size_t const dash = range.find('-');
+                unsigned long const first = std::stoul(range.substr(0, dash));
+                unsigned long const last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                for (unsigned long id = first; id <= last; ++id)
+                {
+                    cpus.push_back(static_cast<unsigned int>(id));
+                }
+            }
+            return cpus;
+        }
+#endif
+
+        std::vector<unsigned int> all_cpus()
+        {
+            std::vector<unsigned int> cpus;
+            unsigned int const n = std::max(1U, std::thread::hardware_concurrency());
+            for (unsigned int id = 0; id < n; ++id)
+            {
+                cpus.push_back(id);
+            }
+            return cpus;
+        }
+    }
+
+    bool parse(std::string const &name, placement &result)
+    {
+        if (name == "none")
+        {
+            result = placement::none;
+        }
+        else if (name == "compact")
+        {
+            result = placement::compact;
+        }
+        else if (name == "scatter")
+        {
+            result = placement::scatter;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+#ifdef __linux__
+    std::vector<std::vector<unsigned int>> numa_nodes()
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool const restricted = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        auto is_allowed = [&](unsigned int id)
+        {
+            return !restricted || (id < CPU_SETSIZE && CPU_ISSET(id, &allowed));
+        };
+        std::vector<std::pair<unsigned int, std::vector<unsigned int>>> nodes;
+        std::error_code ec;
+        for (auto const &entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec))
+        {
+            std::string const name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+            {
+                continue;
+            }
+            std::ifstream in(entry.path() / "cpulist");
+            std::string list;
+            std::getline(in, list);
+            std::vector<unsigned int> cpus = parse_cpu_list(list);
+            cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](unsigned int id)
+                                      { return !is_allowed(id); }),
+                       cpus.end());
+            if (!cpus.empty())
+            {
+                nodes.emplace_back(static_cast<unsigned int>(std::stoul(name.substr(4))), std::move(cpus));
+            }
+        }
+        std::sort(nodes.begin(), nodes.end());
+        std::vector<std::vector<unsigned int>> result;
+        for (auto &node : nodes)
+        {
+            result.push_back(std::move(node.second));
+        }
+        if (result.empty())
+        {
+            // no NUMA information, e.g. in a container without /sys
+            std::vector<unsigned int> cpus;
+            for (unsigned int id = 0; id < CPU_SETSIZE; ++id)
+            {
+                if (restricted && CPU_ISSET(id, &allowed))
+                {
+                    cpus.push_back(id);
+                }
+            }
+            result.push_back(cpus.empty() ? all_cpus() : cpus);
+        }
+        return result;
+    }
+
+    bool pin_current_thread(unsigned int id)
+    {
+        if (id >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(id, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+#elif defined(_MSC_VER)
+    std::vector<std::vector<unsigned int>> numa_nodes()
+    {
+        std::vector<std::vector<unsigned int>> result;
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest))
+        {
+            for (ULONG node = 0; node <= highest; ++node)
+            {
+                ULONGLONG mask = 0;
+                if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) || mask == 0)
+                {
+                    continue;
+                }
+                std::vector<unsigned int> cpus;
+                for (unsigned int id = 0; id < 64; ++id)
+                {
+                    if ((mask >> id) & 1ULL)
+                    {
+                        cpus.push_back(id);
+                    }
+                }
+                result.push_back(cpus);
+            }
+        }
+        if (result.empty())
+        {
+            result.push_back(all_cpus());
+        }
+        return result;
+    }
+
+    bool pin_current_thread(unsigned int id)
+    {
+        return id < 64 && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1ULL << id)) != 0;
+    }
+#else
+    std::vector<std::vector<unsigned int>> numa_nodes()
+    {
+        return {all_cpus()};
+    }
+
+    bool pin_current_thread(unsigned int)
+    {
+        // e.g. macOS only takes affinity hints, not hard pinning
+        return false;
+    }
+#endif
+
+    std::vector<cpu> cpu_order(placement how)
+    {
+        std::vector<cpu> order;
+        if (how == placement::none)
+        {
+            return order;
+        }
+        std::vector<std::vector<unsigned int>> const nodes = numa_nodes();
+        if (how == placement::compact)
+        {
+            for (std::size_t node = 0; node < nodes.size(); ++node)
+            {
+                for (unsigned int id : nodes[node])
+                {
+                    order.push_back(cpu{id, static_cast<unsigned int>(node)});
+                }
+            }
+            return order;
+        }
+        std::size_t longest = 0;
+        for (auto const &cpus : nodes)
+        {
+            longest = std::max(longest, cpus.size());
+        }
+        for (std::size_t i = 0; i < longest; ++i)
+        {
+            for (std::size_t node = 0; node < nodes.size(); ++node)
+            {
+                if (i < nodes[node].size())
+                {
+                    order.push_back(cpu{nodes[node][i], static_cast<unsigned int>(node)});
+                }
+            }
+        }
+        return order;
+    }
+}
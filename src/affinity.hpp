@@ -0,0 +1,93 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __AFFINITY_HPP__
+#define __AFFINITY_HPP__
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Where threads run: the NUMA nodes, the CPUs on each, and pinning threads to them.
+ *
+ * On Linux the topology comes from /sys/devices/system/node, restricted to
+ * the CPUs the process may run on; on Windows from the NUMA API, for the
+ * first 64 logical processors. Elsewhere all CPUs count as one node and
+ * threads can't be pinned.
+ */
+namespace affinity
+{
+    /**
+     * @brief How to spread threads over the CPUs when pinning them.
+     *
+     * `compact` fills one node after the other, so threads share caches
+     * and memory with as few others as possible on other nodes; `scatter`
+     * takes a CPU from each node in turn, spreading memory bandwidth.
+     */
+    enum class placement
+    {
+        none,
+        compact,
+        scatter
+    };
+
+    /**
+     * @brief A CPU, and the index of its node in `numa_nodes()`.
+     *
+     */
+    struct cpu
+    {
+        unsigned int id;
+        unsigned int node;
+    };
+
+    /**
+     * @brief Parse a placement given on the command line.
+     *
+     * @return false if `name` isn't one of "none", "compact" or "scatter"
+     */
+    bool parse(std::string const &name, placement &result);
+
+    /**
+     * @brief The CPUs the process may run on, grouped by NUMA node.
+     *
+     */
+    std::vector<std::vector<unsigned int>> numa_nodes();
+
+    /**
+     * @brief The CPUs in the order to hand them out to threads.
+     *
+     * Thread `i` goes to `cpu_order()[i % size()]`. Empty for `placement::none`.
+     */
+    std::vector<cpu> cpu_order(placement how);
+
+    /**
+     * @brief Pin the calling thread to the CPU `id`.
+     *
+     * Memory the thread touches first after that is allocated on the CPU's node.
+     *
+     * @return false if the thread couldn't be pinned
+     */
+    bool pin_current_thread(unsigned int id);
+}
+
+#endif // __AFFINITY_HPP__
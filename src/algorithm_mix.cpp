@@ -0,0 +1,204 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "algorithm_mix.hpp"
+
+std::vector<std::string> const algorithm_mix::DEFAULT{"prefill", "prefill-single", "mincheck"};
+
+bool algorithm_mix::parse(std::string const &list, std::vector<std::string> &names, std::string &error)
+{
+    names.clear();
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ','))
+    {
+        auto const algorithm = ALGORITHMS.find(name);
+        if (algorithm == ALGORITHMS.end() || algorithm->second.uses_pool || algorithm->second.adaptive)
+        {
+            error = name;
+            return false;
+        }
+        if (std::find(names.begin(), names.end(), name) == names.end())
+        {
+            names.push_back(name);
+        }
+    }
+    if (names.empty())
+    {
+        error = list;
+        return false;
+    }
+    return true;
+}
+
+algorithm_mix::algorithm_mix(std::vector<std::string> const &names, unsigned int thread_count)
+    : n_slots_(thread_count), slots_(std::make_unique<slot[]>(thread_count)), valid_marks_(thread_count, 0)
+{
+    for (std::string const &name : names)
+    {
+        candidates_.push_back(candidate{name, &ALGORITHMS.at(name)});
+    }
+    for (unsigned int i = 0; i < n_slots_; ++i)
+    {
+        slots_[i].candidate.store(static_cast<unsigned int>(i % candidates_.size()), std::memory_order_relaxed);
+    }
+    next_explored_ = n_slots_ % candidates_.size();
+}
+
+algorithm_t const &algorithm_mix::start(unsigned int slot)
+{
+    // set before reading the assignment, so clearing it after a new assignment is never lost
+    slots_[slot].running.store(true);
+    if (stopped_.load())
+    {
+        slots_[slot].running.store(false);
+    }
+    return *candidates_[slots_[slot].candidate.load()].algorithm;
+}
+
+void algorithm_mix::measure(std::vector<std::unique_ptr<board_sink>> const &sinks, double dt)
+{
+    std::vector<unsigned long long> n_valid(candidates_.size(), 0);
+    std::vector<unsigned int> n_threads(candidates_.size(), 0);
+    for (unsigned int i = 0; i < n_slots_ && i < sinks.size(); ++i)
+    {
+        unsigned long long const n = sinks[i]->perf.n_valid.load(std::memory_order_relaxed);
+        unsigned int const c = slots_[i].candidate.load(std::memory_order_relaxed);
+        n_valid[c] += n - valid_marks_[i];
+        valid_marks_[i] = n;
+        ++n_threads[c];
+    }
+    if (dt <= 0)
+    {
+        return;
+    }
+    for (std::size_t c = 0; c < candidates_.size(); ++c)
+    {
+        if (n_threads[c] == 0)
+        {
+            continue;
+        }
+        candidate &cand = candidates_[c];
+        double const thread_seconds = n_threads[c] * dt;
+        double const rate = static_cast<double>(n_valid[c]) / thread_seconds;
+        cand.rate = cand.rate < 0 ? rate : (1 - SMOOTHING) * cand.rate + SMOOTHING * rate;
+        cand.thread_seconds += thread_seconds;
+        cand.n_valid += n_valid[c];
+    }
+}
+
+void algorithm_mix::rebalance(std::vector<std::unique_ptr<board_sink>> const &sinks, double dt)
+{
+    measure(sinks, dt);
+    assign();
+}
+
+void algorithm_mix::assign()
+{
+    std::size_t best = 0;
+    bool untried = false;
+    for (std::size_t c = 0; c < candidates_.size(); ++c)
+    {
+        untried = untried || candidates_[c].rate < 0;
+        if (candidates_[c].rate > candidates_[best].rate)
+        {
+            best = c;
+        }
+    }
+    unsigned int n_explorers = 0;
+    if (candidates_.size() > 1)
+    {
+        n_explorers = n_slots_ / 8;
+        if (n_explorers == 0 && (untried || round_ % EXPLORE_PERIOD == EXPLORE_PERIOD - 1))
+        {
+            n_explorers = 1;
+        }
+    }
+    for (unsigned int i = 0; i < n_slots_; ++i)
+    {
+        std::size_t c = best;
+        if (i >= n_slots_ - n_explorers)
+        {
+            auto const next_untried = std::find_if(candidates_.begin(), candidates_.end(), [](candidate const &cand)
+                                                   { return cand.rate < 0; });
+            if (next_untried != candidates_.end())
+            {
+                c = static_cast<std::size_t>(next_untried - candidates_.begin());
+            }
+            else
+            {
+                do
+                {
+                    next_explored_ = (next_explored_ + 1) % candidates_.size();
+                } while (next_explored_ == best);
+                c = next_explored_;
+            }
+        }
+        if (slots_[i].candidate.load(std::memory_order_relaxed) != c)
+        {
+            slots_[i].candidate.store(static_cast<unsigned int>(c));
+            slots_[i].running.store(false);
+        }
+    }
+    ++round_;
+}
+
+void algorithm_mix::stop()
+{
+    stopped_.store(true);
+    for (unsigned int i = 0; i < n_slots_; ++i)
+    {
+        slots_[i].running.store(false);
+    }
+}
+
+std::string algorithm_mix::names() const
+{
+    std::string result;
+    for (candidate const &cand : candidates_)
+    {
+        result += (result.empty() ? "" : ",") + cand.name;
+    }
+    return result;
+}
+
+void algorithm_mix::print_summary(std::ostream &out) const
+{
+    double total = 0;
+    for (candidate const &cand : candidates_)
+    {
+        total += cand.thread_seconds;
+    }
+    out << "  algorithm mix:\n";
+    for (candidate const &cand : candidates_)
+    {
+        out << "    " << std::left << std::setw(18) << cand.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(6) << (total > 0 ? 100 * cand.thread_seconds / total : 0.0) << " % of thread time, "
+            << std::setw(10) << (cand.thread_seconds > 0 ? static_cast<double>(cand.n_valid) / cand.thread_seconds : 0.0)
+            << " valid/s per thread\n";
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,156 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __ALGORITHM_MIX_HPP__
+#define __ALGORITHM_MIX_HPP__
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "generators.hpp"
+
+/**
+ * @brief Spreads the generator threads of an adaptive run over several algorithms.
+ *
+ * Each thread runs the algorithm its slot is assigned to (see
+ * `adaptive_generator_thread()`). Every `REBALANCE_INTERVAL` seconds the
+ * thread that started the run calls `rebalance()`, which measures how many
+ * valid boards per second each algorithm has yielded per thread since the
+ * last call, smoothed over time, and moves all threads to the best one,
+ * except for one in eight that keep trying the others in turn, so the
+ * mix follows when another algorithm starts doing better. With fewer than
+ * eight threads, one of them tries another algorithm every
+ * `EXPLORE_PERIOD`-th interval instead.
+ * Algorithms not measured yet are tried first.
+ *
+ * A thread moved to another algorithm finishes the board it's working
+ * on, then sets up the new algorithm, which allocates a bit of memory.
+ */
+class algorithm_mix
+{
+public:
+    static constexpr double REBALANCE_INTERVAL = 2.0;
+    static constexpr unsigned int EXPLORE_PERIOD = 4;
+    static constexpr double SMOOTHING = 0.5;
+
+    /**
+     * @brief The algorithms an adaptive run chooses from unless told otherwise.
+     *
+     */
+    static std::vector<std::string> const DEFAULT;
+
+    /**
+     * @brief Parse a comma-separated list of algorithms.
+     *
+     * Algorithms that dig grids from a `grid_pool` can't take part.
+     *
+     * @return false if `list` names an algorithm that can't take part, reported in `error`
+     */
+    static bool parse(std::string const &list, std::vector<std::string> &names, std::string &error);
+
+    /**
+     * @brief Assign `thread_count` threads to `names` in turn.
+     *
+     * @param names algorithms in `ALGORITHMS` that can take part (see `parse()`)
+     */
+    algorithm_mix(std::vector<std::string> const &names, unsigned int thread_count);
+    algorithm_mix(algorithm_mix const &) = delete;
+    algorithm_mix &operator=(algorithm_mix const &) = delete;
+
+    /**
+     * @brief Called by the generator thread in `slot` before it runs an algorithm.
+     *
+     * @return the algorithm to run until `running(slot)` is cleared
+     */
+    algorithm_t const &start(unsigned int slot);
+
+    inline std::atomic<bool> const &running(unsigned int slot) const
+    {
+        return slots_[slot].running;
+    }
+
+    /**
+     * @brief Count what each algorithm yielded in the last `dt` seconds.
+     *
+     * @param sinks the sinks of the threads in the slots, in order
+     */
+    void measure(std::vector<std::unique_ptr<board_sink>> const &sinks, double dt);
+
+    /**
+     * @brief `measure()`, then move threads to the algorithms they should run now.
+     *
+     */
+    void rebalance(std::vector<std::unique_ptr<board_sink>> const &sinks, double dt);
+
+    /**
+     * @brief Make all threads return from their algorithm, and never start another.
+     *
+     */
+    void stop();
+
+    /**
+     * @brief The algorithms taking part, separated by commas.
+     *
+     */
+    std::string names() const;
+
+    /**
+     * @brief Print each algorithm's share of the threads' time and its yield.
+     *
+     */
+    void print_summary(std::ostream &out) const;
+
+private:
+    struct alignas(CACHE_LINE_SIZE) slot
+    {
+        std::atomic<unsigned int> candidate{0};
+        std::atomic<bool> running{true};
+    };
+
+    struct candidate
+    {
+        std::string name;
+        algorithm_t const *algorithm;
+        /**
+         * @brief Valid boards per second and thread, smoothed; negative until measured.
+         *
+         */
+        double rate{-1};
+        double thread_seconds{0};
+        unsigned long long n_valid{0};
+    };
+
+    void assign();
+
+    std::vector<candidate> candidates_;
+    unsigned int n_slots_;
+    std::unique_ptr<slot[]> slots_;
+    std::atomic<bool> stopped_{false};
+    std::vector<unsigned long long> valid_marks_;
+    unsigned int round_{0};
+    std::size_t next_explored_{0};
+};
+
+#endif // __ALGORITHM_MIX_HPP__
@@ -0,0 +1,52 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __ALLOC_COUNTER_HPP__
+#define __ALLOC_COUNTER_HPP__
+
+#include <cstdint>
+
+/**
+ * @brief Counts the heap allocations each thread makes.
+ *
+ * alloc_hooks.cpp replaces the global `operator new` and `operator delete`
+ * with ones that count every allocation, including those of the standard
+ * library, in a counter of the allocating thread. Only programs that link
+ * alloc_hooks.cpp count; in others, e.g. those using libsudoku, the count
+ * stays 0, and their allocator is left alone.
+ */
+namespace alloc_counter
+{
+    /**
+     * @brief Number of heap allocations the calling thread has made so far.
+     *
+     */
+    uint64_t thread_allocations();
+
+    /**
+     * @brief Count an allocation of the calling thread.
+     *
+     */
+    void count_allocation();
+}
+
+#endif // __ALLOC_COUNTER_HPP__
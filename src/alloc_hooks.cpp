@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.hpp"
+
+namespace
+{
+    inline void *allocate(std::size_t size)
+    {
+        alloc_counter::count_allocation();
+        void *p = std::malloc(size == 0 ? 1 : size);
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    inline void *allocate(std::size_t size, std::align_val_t alignment)
+    {
+        alloc_counter::count_allocation();
+        std::size_t const align = static_cast<std::size_t>(alignment);
+        // aligned_alloc() wants a multiple of the alignment
+        std::size_t const rounded = (size == 0 ? align : (size + align - 1) / align * align);
+#ifdef _MSC_VER
+        void *p = _aligned_malloc(rounded, align);
+#else
+        void *p = std::aligned_alloc(align, rounded);
+#endif
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    inline void deallocate_aligned(void *p)
+    {
+#ifdef _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (std::bad_alloc const &)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, alignment);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    deallocate_aligned(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    deallocate_aligned(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    deallocate_aligned(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    deallocate_aligned(p);
+}
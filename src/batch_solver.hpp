@@ -0,0 +1,308 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __BATCH_SOLVER_HPP__
+#define __BATCH_SOLVER_HPP__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief Solves many independent boards in lockstep.
+ *
+ * Each of the `LANES` lanes runs the resumable search of a board of its
+ * own (see `basic_sudoku::step()`), and the lanes take turns visiting one
+ * node each. The lanes' boards, masks and stacks don't depend on each
+ * other, so the CPU can overlap one lane's cache misses and mispredicted
+ * branches with another lane's work. A lane done with its board takes the
+ * next one, until all boards are through.
+ *
+ * Results go to caller-provided spans, and the lanes keep their stacks in
+ * place, so a call doesn't allocate. Each board gets the same answer as
+ * the corresponding single-board call. `search_mode::dlx` can't step, so
+ * it solves the boards one after another.
+ *
+ * A batch solver is a reusable workspace; keep one per thread.
+ */
+template <unsigned int N>
+class basic_batch_solver
+{
+public:
+    typedef basic_sudoku<N> game_t;
+    typedef typename game_t::board_t board_t;
+
+    static constexpr unsigned int LANES = 8;
+
+    explicit basic_batch_solver(sudoku_base::search_mode mode = sudoku_base::search_mode::mrv)
+    {
+        for (lane &l : lanes_)
+        {
+            l.game.set_search_mode(mode);
+        }
+    }
+
+    basic_batch_solver(basic_batch_solver const &) = delete;
+    basic_batch_solver &operator=(basic_batch_solver const &) = delete;
+
+    /**
+     * @brief Abort all searches when `flag` is set (see `basic_sudoku::set_abort_flag()`).
+     *
+     * What an aborted search of a board stands for is told for each call.
+     */
+    inline void set_abort_flag(std::atomic<bool> const *flag)
+    {
+        for (lane &l : lanes_)
+        {
+            l.game.set_abort_flag(flag);
+        }
+    }
+
+    /**
+     * @brief Limit the nodes the search of each board may visit (see `basic_sudoku::set_node_limit()`).
+     *
+     * A board whose search hits the limit counts as aborted.
+     *
+     * @param limit the number of nodes, or 0 for no limit
+     */
+    inline void set_node_limit(uint64_t limit)
+    {
+        node_limit_ = limit;
+    }
+
+    /**
+     * @brief Get the solver work of all lanes since the last call (see `basic_sudoku::take_counters()`).
+     *
+     */
+    sudoku_base::search_counters take_counters()
+    {
+        sudoku_base::search_counters total;
+        total.n_unique_checks = n_searches_;
+        n_searches_ = 0;
+        for (lane &l : lanes_)
+        {
+            sudoku_base::search_counters const c = l.game.take_counters();
+            total.n_nodes += c.n_nodes;
+            total.n_is_safe += c.n_is_safe;
+            total.n_unique_checks += c.n_unique_checks;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Count the solutions of each board, up to two.
+     *
+     * A board whose search has been aborted counts as having more than one solution.
+     *
+     * @param boards the boards to check
+     * @param[out] n_solutions per board 0, 1, or 2 for more than one solution;
+     *             at least as many entries as there are boards
+     */
+    void unique_batch(std::span<board_t const> boards, std::span<uint8_t> n_solutions)
+    {
+        assert(n_solutions.size() >= boards.size());
+        std::fill(n_solutions.begin(), n_solutions.begin() + static_cast<std::ptrdiff_t>(boards.size()), uint8_t{0});
+        if (lanes_[0].game.get_search_mode() == sudoku_base::search_mode::dlx)
+        {
+            game_t &game = lanes_[0].game;
+            for (std::size_t i = 0; i < boards.size(); ++i)
+            {
+                game.assign(boards[i]);
+                int n = 0;
+                game.count_solutions_limited(n);
+                n_solutions[i] = static_cast<uint8_t>(std::min(n, 2));
+            }
+            return;
+        }
+        run(
+            boards.size(), [&boards](std::size_t i) -> board_t const &
+            { return boards[i]; },
+            [&n_solutions](game_t const &, std::size_t i)
+            { return ++n_solutions[i] < 2; },
+            [&n_solutions](std::size_t i)
+            { n_solutions[i] = 2; });
+    }
+
+    /**
+     * @brief Solve each board.
+     *
+     * The solution of a board is the one `basic_sudoku::solve_single()`
+     * finds. A board whose search has been aborted counts as unsolved.
+     *
+     * @param[in,out] boards the boards to solve, replaced by their solutions if they have any
+     * @param[out] solved per board true if it has been solved; at least as many entries as there are boards
+     */
+    void solve_batch(std::span<board_t> boards, std::span<bool> solved)
+    {
+        assert(solved.size() >= boards.size());
+        std::fill(solved.begin(), solved.begin() + static_cast<std::ptrdiff_t>(boards.size()), false);
+        if (lanes_[0].game.get_search_mode() == sudoku_base::search_mode::dlx)
+        {
+            game_t &game = lanes_[0].game;
+            for (std::size_t i = 0; i < boards.size(); ++i)
+            {
+                game.assign(boards[i]);
+                solved[i] = game.solve_single();
+                if (solved[i])
+                {
+                    boards[i] = game.board();
+                }
+            }
+            return;
+        }
+        run(
+            boards.size(), [&boards](std::size_t i) -> board_t const &
+            { return boards[i]; },
+            [&boards, &solved](game_t const &game, std::size_t i)
+            {
+                boards[i] = game.board();
+                solved[i] = true;
+                return false; },
+            [](std::size_t) {});
+    }
+
+    /**
+     * @brief Check if any of the boards has a solution.
+     *
+     * All searches stop at the first solution found, so this is the
+     * batched form of calling `basic_sudoku::has_solution()` until one
+     * returns true. An aborted search counts as having found a solution,
+     * so that `basic_digger` leaves the cell filled.
+     *
+     * @param boards the boards to check
+     */
+    bool any_solvable(std::span<board_t const> boards)
+    {
+        if (lanes_[0].game.get_search_mode() == sudoku_base::search_mode::dlx)
+        {
+            game_t &game = lanes_[0].game;
+            for (board_t const &board : boards)
+            {
+                game.assign(board);
+                if (game.has_solution())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        bool found = false;
+        run(
+            boards.size(), [&boards](std::size_t i) -> board_t const &
+            { return boards[i]; },
+            [&found](game_t const &, std::size_t)
+            {
+                found = true;
+                return false; },
+            [&found](std::size_t)
+            { found = true; },
+            &found);
+        return found;
+    }
+
+private:
+    struct lane
+    {
+        game_t game;
+        std::size_t board{0};
+        bool busy{false};
+    };
+
+    /**
+     * @brief Search boards 0 to `n` - 1, `LANES` at a time.
+     *
+     * @param n the number of boards
+     * @param board_at returns board `i`
+     * @param on_solution called with the lane's game and the board index
+     *        for each solution; return false to stop searching that board
+     * @param on_aborted called with the board index if its search has been aborted
+     * @param stop_all if not null, stop all searches once it's true
+     */
+    template <typename BoardAt, typename OnSolution, typename OnAborted>
+    void run(std::size_t n, BoardAt &&board_at, OnSolution &&on_solution, OnAborted &&on_aborted, bool const *stop_all = nullptr)
+    {
+        std::size_t next = 0;
+        unsigned int active = 0;
+        auto load = [&](lane &l)
+        {
+            l.busy = next < n && (stop_all == nullptr || !*stop_all);
+            if (!l.busy)
+            {
+                return;
+            }
+            l.board = next++;
+            l.game.assign(board_at(l.board));
+            // 0 lifts a limit set before
+            l.game.set_node_limit(node_limit_);
+            l.game.start_search();
+            ++n_searches_;
+            ++active;
+        };
+        for (lane &l : lanes_)
+        {
+            load(l);
+        }
+        while (active > 0)
+        {
+            for (lane &l : lanes_)
+            {
+                if (!l.busy)
+                {
+                    continue;
+                }
+                auto const result = l.game.step();
+                bool more = result == game_t::step_result::running;
+                if (result == game_t::step_result::solution)
+                {
+                    more = on_solution(l.game, l.board);
+                }
+                else if (result == game_t::step_result::aborted)
+                {
+                    on_aborted(l.board);
+                }
+                if (more && (stop_all == nullptr || !*stop_all))
+                {
+                    continue;
+                }
+                l.game.end_search();
+                --active;
+                load(l);
+            }
+        }
+    }
+
+    std::array<lane, LANES> lanes_;
+    uint64_t node_limit_{0};
+    /**
+     * @brief Searches started in lanes since the last `take_counters()`, reported as uniqueness checks
+     *
+     */
+    uint64_t n_searches_{0};
+};
+
+typedef basic_batch_solver<3> batch_solver;
+
+#endif // __BATCH_SOLVER_HPP__
@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __BINARY_IO_HPP__
+#define __BINARY_IO_HPP__
+
+#include <bit>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Writes little-endian integers, doubles and length-prefixed strings to a stream.
+ *
+ */
+class binary_writer
+{
+public:
+    explicit binary_writer(std::ostream &os)
+        : os_(os)
+    {
+    }
+
+    void put(uint64_t n, unsigned int bytes = sizeof(uint64_t))
+    {
+        for (unsigned int i = 0; i < bytes; ++i)
+        {
+            os_.put(static_cast<char>((n >> (8 * i)) & 0xffU));
+        }
+    }
+
+    void put(double x)
+    {
+        put(std::bit_cast<uint64_t>(x));
+    }
+
+    void put(std::string const &str)
+    {
+        put(str.size(), sizeof(uint32_t));
+        os_.write(str.data(), static_cast<std::streamsize>(str.size()));
+    }
+
+private:
+    std::ostream &os_;
+};
+
+/**
+ * @brief Reads what `binary_writer` wrote.
+ *
+ */
+class binary_reader
+{
+public:
+    explicit binary_reader(std::istream &is)
+        : is_(is)
+    {
+    }
+
+    uint64_t get(unsigned int bytes = sizeof(uint64_t))
+    {
+        uint64_t n = 0;
+        for (unsigned int i = 0; i < bytes; ++i)
+        {
+            n |= static_cast<uint64_t>(static_cast<uint8_t>(is_.get())) << (8 * i);
+        }
+        return n;
+    }
+
+    double get_double()
+    {
+        return std::bit_cast<double>(get());
+    }
+
+    std::string get_string()
+    {
+        std::string str(get(sizeof(uint32_t)), '\0');
+        is_.read(str.data(), static_cast<std::streamsize>(str.size()));
+        return str;
+    }
+
+private:
+    std::istream &is_;
+};
+
+#endif // __BINARY_IO_HPP__
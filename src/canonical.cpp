@@ -0,0 +1,368 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include "canonical.hpp"
+
+namespace
+{
+    typedef symmetry::line_order_t line_order_t;
+    typedef std::array<uint8_t, 81> grid_t;
+    typedef std::array<uint8_t, 10> labels_t;
+
+    /**
+     * @brief Search state for one board.
+     *
+     * `grid_` points to the (possibly transposed) board with 0 for empty
+     * cells. `cur_` holds the board being built, `best_` the smallest
+     * board found so far. The first row is built cell by cell while
+     * choosing the column order, the other rows line by line. Both
+     * searches keep bands and stacks intact and cut a branch as soon as
+     * it compares greater than `best_`.
+     */
+    class canonicalizer
+    {
+    public:
+        explicit canonicalizer(sudoku::board_t const &board)
+        {
+            for (unsigned int i = 0; i < 81U; ++i)
+            {
+                assert(board[i] >= sudoku::EMPTY && board[i] <= '9');
+                uint8_t const v = static_cast<uint8_t>(board[i] - sudoku::EMPTY);
+                grids_[0][i] = v;
+                grids_[1][(i % 9) * 9 + i / 9] = v;
+            }
+            // greater than any real cell value
+            best_.fill(10);
+        }
+
+        symmetry run()
+        {
+            for (grid_ = grids_.data(); grid_ != grids_.data() + grids_.size(); ++grid_)
+            {
+                for (unsigned int r0 = 0; r0 < 9U; ++r0)
+                {
+                    row0_ = r0;
+                    rows_[0] = static_cast<uint8_t>(r0);
+                    used_rows_ = static_cast<uint16_t>(1U << r0);
+                    used_bands_ = static_cast<uint8_t>(1U << (r0 / 3));
+                    band_ = r0 / 3U;
+                    used_cols_ = 0;
+                    used_stacks_ = 0;
+                    extend_cols(0, labels_t{}, 1, true);
+                }
+            }
+            // digits not on the board get the remaining labels
+            labels_t digits = best_labels_;
+            uint8_t next = static_cast<uint8_t>(1 + std::count_if(digits.begin() + 1, digits.end(), [](uint8_t l)
+                                                                  { return l != 0; }));
+            for (unsigned int d = 1; d < 10U; ++d)
+            {
+                if (digits[d] == 0)
+                {
+                    digits[d] = next++;
+                }
+            }
+            symmetry result;
+            result.digits = digits;
+            // the search reorders the transposed grid, `symmetry` transposes after reordering
+            result.transpose = best_transposed_;
+            result.rows = best_transposed_ ? best_cols_ : best_rows_;
+            result.cols = best_transposed_ ? best_rows_ : best_cols_;
+            return result;
+        }
+
+    private:
+        /**
+         * @brief Relabel a cell value, assigning the next label to digits not seen yet.
+         *
+         */
+        static inline uint8_t relabel(uint8_t v, labels_t &labels, uint8_t &next)
+        {
+            if (v != 0)
+            {
+                if (labels[v] == 0)
+                {
+                    labels[v] = next++;
+                }
+                v = labels[v];
+            }
+            return v;
+        }
+
+        /**
+         * @brief Choose the column for position `pos` of the first row.
+         *
+         * @param tied true if `cur_` equals `best_` in all cells before `pos`
+         */
+        void extend_cols(unsigned int pos, labels_t const &labels, uint8_t next, bool tied)
+        {
+            if (pos == 9)
+            {
+                extend(1, labels, next, tied);
+                return;
+            }
+            unsigned int const saved_stack = stack_;
+            for (unsigned int stack = 0; stack < 3U; ++stack)
+            {
+                if (pos % 3 == 0 ? (used_stacks_ & (1U << stack)) != 0 : stack != saved_stack)
+                {
+                    continue;
+                }
+                for (unsigned int col = stack * 3; col < stack * 3 + 3; ++col)
+                {
+                    if (used_cols_ & (1U << col))
+                    {
+                        continue;
+                    }
+                    labels_t col_labels = labels;
+                    uint8_t col_next = next;
+                    uint8_t const v = relabel((*grid_)[row0_ * 9 + col], col_labels, col_next);
+                    if (tied && v > best_[pos])
+                    {
+                        continue;
+                    }
+                    cur_[pos] = v;
+                    cols_[pos] = static_cast<uint8_t>(col);
+                    unsigned long long const improvements = n_improvements_;
+                    used_cols_ = static_cast<uint16_t>(used_cols_ | (1U << col));
+                    used_stacks_ = static_cast<uint8_t>(used_stacks_ | (1U << stack));
+                    stack_ = stack;
+                    extend_cols(pos + 1, col_labels, col_next, tied && v == best_[pos]);
+                    used_cols_ = static_cast<uint16_t>(used_cols_ & ~(1U << col));
+                    if (pos % 3 == 0)
+                    {
+                        used_stacks_ = static_cast<uint8_t>(used_stacks_ & ~(1U << stack));
+                    }
+                    stack_ = saved_stack;
+                    if (n_improvements_ != improvements)
+                    {
+                        // `best_` now continues the cells before, so compare against it again
+                        tied = true;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Write `row` of the grid as row `pos` of `cur_`, relabelling digits on the fly.
+         *
+         * If `tied`, i.e. `cur_` equals `best_` in all rows above, the row is
+         * compared to the best board's row.
+         *
+         * @return false if the row compares greater, so the branch can be cut
+         */
+        inline bool place_row(unsigned int pos, unsigned int row, labels_t &labels, uint8_t &next, bool tied, bool &less)
+        {
+            uint8_t const *src = grid_->data() + row * 9;
+            uint8_t *dst = cur_.data() + pos * 9;
+            uint8_t const *ref = best_.data() + pos * 9;
+            for (unsigned int c = 0; c < 9U; ++c)
+            {
+                uint8_t const v = relabel(src[cols_[c]], labels, next);
+                dst[c] = v;
+                if (tied && !less)
+                {
+                    if (v > ref[c])
+                    {
+                        return false;
+                    }
+                    less = v < ref[c];
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Choose the row for position `pos`.
+         *
+         * @param tied true if `cur_` equals `best_` in all rows before `pos`
+         */
+        void extend(unsigned int pos, labels_t const &labels, uint8_t next, bool tied)
+        {
+            if (pos == 9)
+            {
+                if (!tied)
+                {
+                    best_ = cur_;
+                    best_rows_ = rows_;
+                    best_cols_ = cols_;
+                    best_labels_ = labels;
+                    best_transposed_ = grid_ != grids_.data();
+                    ++n_improvements_;
+                }
+                return;
+            }
+            unsigned int const saved_band = band_;
+            for (unsigned int band = 0; band < 3U; ++band)
+            {
+                if (pos % 3 == 0 ? (used_bands_ & (1U << band)) != 0 : band != saved_band)
+                {
+                    continue;
+                }
+                for (unsigned int row = band * 3; row < band * 3 + 3; ++row)
+                {
+                    if (used_rows_ & (1U << row))
+                    {
+                        continue;
+                    }
+                    labels_t row_labels = labels;
+                    uint8_t row_next = next;
+                    bool less = false;
+                    if (!place_row(pos, row, row_labels, row_next, tied, less))
+                    {
+                        continue;
+                    }
+                    rows_[pos] = static_cast<uint8_t>(row);
+                    unsigned long long const improvements = n_improvements_;
+                    used_rows_ = static_cast<uint16_t>(used_rows_ | (1U << row));
+                    used_bands_ = static_cast<uint8_t>(used_bands_ | (1U << band));
+                    band_ = band;
+                    extend(pos + 1, row_labels, row_next, tied && !less);
+                    used_rows_ = static_cast<uint16_t>(used_rows_ & ~(1U << row));
+                    if (pos % 3 == 0)
+                    {
+                        used_bands_ = static_cast<uint8_t>(used_bands_ & ~(1U << band));
+                    }
+                    band_ = saved_band;
+                    if (n_improvements_ != improvements)
+                    {
+                        // `best_` now continues the rows above, so compare against it again
+                        tied = true;
+                    }
+                }
+            }
+        }
+
+        std::array<grid_t, 2> grids_;
+        grid_t const *grid_{nullptr};
+        line_order_t rows_{};
+        line_order_t cols_{};
+        grid_t cur_;
+        grid_t best_;
+        line_order_t best_rows_{};
+        line_order_t best_cols_{};
+        labels_t best_labels_{};
+        bool best_transposed_{false};
+        unsigned int row0_{0};
+        uint16_t used_rows_{0};
+        uint16_t used_cols_{0};
+        uint8_t used_bands_{0};
+        uint8_t used_stacks_{0};
+        unsigned int band_{0};
+        unsigned int stack_{0};
+        unsigned long long n_improvements_{0};
+    };
+}
+
+symmetry canonical_symmetry(sudoku::board_t const &board)
+{
+    return canonicalizer(board).run();
+}
+
+sudoku::board_t canonical_form(sudoku::board_t const &board)
+{
+    return canonical_symmetry(board).apply(board);
+}
+
+namespace
+{
+    inline void mix(uint64_t &h, uint64_t v)
+    {
+        h = (h ^ v) * 0x100000001b3ULL;
+    }
+
+    /**
+     * @brief Sorted counts within each group of three lines, groups sorted, as one number.
+     *
+     */
+    uint64_t line_signature(std::array<uint8_t, 9> const &counts)
+    {
+        std::array<uint32_t, 3> groups;
+        for (unsigned int g = 0; g < 3U; ++g)
+        {
+            std::array<uint8_t, 3> c{counts[3 * g], counts[3 * g + 1], counts[3 * g + 2]};
+            std::sort(c.begin(), c.end());
+            groups[g] = (uint32_t{c[0]} << 8) | (uint32_t{c[1]} << 4) | c[2];
+        }
+        std::sort(groups.begin(), groups.end());
+        return (uint64_t{groups[0]} << 24) | (uint64_t{groups[1]} << 12) | groups[2];
+    }
+}
+
+uint64_t symmetry_fingerprint(sudoku::board_t const &board)
+{
+    std::array<uint8_t, 9> rows{};
+    std::array<uint8_t, 9> cols{};
+    std::array<uint8_t, 9> boxes{};
+    std::array<uint8_t, 10> digits{};
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        assert(board[i] >= sudoku::EMPTY && board[i] <= '9');
+        if (board[i] != sudoku::EMPTY)
+        {
+            ++rows[i / 9];
+            ++cols[i % 9];
+            ++boxes[(i / 27) * 3 + (i % 9) / 3];
+            ++digits[static_cast<unsigned int>(board[i] - sudoku::EMPTY)];
+        }
+    }
+    // per given: the unordered pair of row and column count, plus the box count
+    std::array<uint16_t, 81> cells;
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        if (board[i] != sudoku::EMPTY)
+        {
+            uint16_t const r = rows[i / 9];
+            uint16_t const c = cols[i % 9];
+            uint16_t const b = boxes[(i / 27) * 3 + (i % 9) / 3];
+            cells[n++] = static_cast<uint16_t>((std::min(r, c) << 8) | (std::max(r, c) << 4) | b);
+        }
+    }
+    std::sort(cells.begin(), cells.begin() + n);
+    std::sort(digits.begin() + 1, digits.end());
+    std::sort(boxes.begin(), boxes.end());
+    uint64_t const row_sig = line_signature(rows);
+    uint64_t const col_sig = line_signature(cols);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    // transposition swaps rows and columns
+    mix(h, std::min(row_sig, col_sig));
+    mix(h, std::max(row_sig, col_sig));
+    for (unsigned int d = 1; d < 10U; ++d)
+    {
+        mix(h, digits[d]);
+    }
+    for (uint8_t b : boxes)
+    {
+        mix(h, b);
+    }
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        mix(h, cells[i]);
+    }
+    return h;
+}
@@ -0,0 +1,72 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __CANONICAL_HPP__
+#define __CANONICAL_HPP__
+
+#include <cstdint>
+
+#include "sudoku.hpp"
+#include "symmetry.hpp"
+
+/**
+ * @brief Map a board to the representative of its equivalence class.
+ *
+ * Two boards are equivalent if one can be turned into the other by
+ * relabelling digits, permuting rows within bands, columns within stacks,
+ * bands, stacks, and by transposition. The representative is the
+ * lexicographically smallest board of the class, empty cells counting
+ * as the smallest value and digits relabelled 1, 2, ... in the order of
+ * their first appearance.
+ *
+ * The search tries all column orders for each candidate first row, but
+ * only follows those yielding the smallest first row, and cuts every
+ * row order as soon as it compares greater than the best board so far.
+ *
+ * @param board the board to canonicalize; each cell a digit or `sudoku::EMPTY`
+ * @return sudoku::board_t the representative
+ */
+sudoku::board_t canonical_form(sudoku::board_t const &board);
+
+/**
+ * @brief Find the transformation that maps a board to its `canonical_form()`.
+ *
+ * @param board the board to canonicalize
+ * @return symmetry the transformation
+ */
+symmetry canonical_symmetry(sudoku::board_t const &board);
+
+/**
+ * @brief Hash of features that don't change under the symmetries of `canonical_form()`.
+ *
+ * Equivalent boards always have the same fingerprint, so boards with
+ * different fingerprints need not be canonicalized to tell them apart.
+ * It combines the number of givens per digit, row, column and box, as
+ * well as the per-given row/column/box counts, each as a sorted multiset.
+ * Takes a small fraction of the time `canonical_form()` does.
+ *
+ * @param board the board; each cell a digit or `sudoku::EMPTY`
+ * @return uint64_t the fingerprint
+ */
+uint64_t symmetry_fingerprint(sudoku::board_t const &board);
+
+#endif // __CANONICAL_HPP__
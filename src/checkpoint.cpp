@@ -0,0 +1,216 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+
+#include "binary_io.hpp"
+#include "checkpoint.hpp"
+#include "util.hpp"
+
+namespace
+{
+    /**
+     * @brief Call `f` with each counter of a generator thread, always in the same order.
+     *
+     */
+    template <typename Sink, typename F>
+    void for_each_counter(Sink &sink, F &&f)
+    {
+        f(sink.perf.n_games);
+        f(sink.perf.n_valid);
+        f(sink.perf.n_nodes);
+        f(sink.perf.n_is_safe);
+        f(sink.perf.n_unique_checks);
+        f(sink.perf.n_discarded);
+        f(sink.perf.n_allocs);
+        for (auto &nanos : sink.perf.phase_nanos)
+        {
+            f(nanos);
+        }
+        f(sink.n_duplicates);
+        f(sink.n_too_easy);
+        f(sink.dig.n_grids);
+        f(sink.dig.n_abandoned);
+        f(sink.dig.n_cells_skipped);
+        f(sink.dig.n_failed_removals);
+    }
+}
+
+void checkpoint::capture(std::vector<std::unique_ptr<board_sink>> const &sinks)
+{
+    threads.clear();
+    for (auto const &sink : sinks)
+    {
+        thread_state state;
+        state.rng = sink->rng->state();
+        for_each_counter(*sink, [&state](auto const &counter)
+                         { state.counters.push_back(counter.load(std::memory_order_relaxed)); });
+        threads.push_back(std::move(state));
+    }
+}
+
+void checkpoint::restore(std::vector<std::unique_ptr<board_sink>> &sinks) const
+{
+    for (std::size_t i = 0; i < threads.size() && i < sinks.size(); ++i)
+    {
+        board_sink &sink = *sinks[i];
+        sink.rng->set_state(threads[i].rng);
+        std::size_t c = 0;
+        for_each_counter(sink, [this, i, &c](auto &counter)
+                         {
+            if (c < threads[i].counters.size())
+            {
+                counter.store(threads[i].counters[c], std::memory_order_relaxed);
+            }
+            ++c; });
+    }
+}
+
+bool checkpoint::save(std::string const &filename, dedup_set *seen) const
+{
+    std::string const tmp_filename = filename + ".tmp";
+    {
+        std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+        binary_writer w(out);
+        out.write(MAGIC.data(), static_cast<std::streamsize>(MAGIC.size()));
+        w.put(algorithm_id, 1);
+        w.put(static_cast<uint64_t>(difficulty), sizeof(uint32_t));
+        w.put(static_cast<uint64_t>(search), 1);
+        w.put(seed);
+        w.put(out_filename);
+        w.put(dedup, 1);
+        w.put(expand, sizeof(uint32_t));
+        w.put(min_rating);
+        w.put(prune, 1);
+        w.put(digs_per_grid, sizeof(uint32_t));
+        w.put(grid_threads, sizeof(uint32_t));
+        w.put(grid_cache);
+        w.put(mix);
+        w.put(static_cast<uint64_t>(count));
+        w.put(time_limit);
+        w.put(n_resumes, sizeof(uint32_t));
+        w.put(elapsed);
+        w.put(out_size);
+        w.put(static_cast<uint64_t>(n_games_valid));
+        w.put(static_cast<uint64_t>(n_games_produced));
+        w.put(threads.size(), sizeof(uint32_t));
+        for (thread_state const &state : threads)
+        {
+            for (uint64_t s : state.rng)
+            {
+                w.put(s);
+            }
+            w.put(state.counters.size(), sizeof(uint32_t));
+            for (uint64_t n : state.counters)
+            {
+                w.put(n);
+            }
+        }
+        w.put(seen != nullptr ? seen->size() : 0);
+        if (seen != nullptr)
+        {
+            seen->for_each([&out, &w](uint64_t fingerprint, packed_board const &packed, uint64_t canonical)
+                           {
+                w.put(fingerprint);
+                w.put(canonical);
+                out.write(reinterpret_cast<char const *>(packed.data.data()), static_cast<std::streamsize>(packed.data.size())); });
+        }
+        out.close();
+        if (!out.good() || !util::sync_file(tmp_filename))
+        {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_filename, filename, ec);
+    return !ec && util::sync_directory_of(filename);
+}
+
+bool checkpoint::load(std::string const &filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    std::array<char, 4> magic{};
+    in.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    if (!in.good() || magic != MAGIC)
+    {
+        return false;
+    }
+    binary_reader r(in);
+    algorithm_id = static_cast<uint8_t>(r.get(1));
+    difficulty = static_cast<int>(r.get(sizeof(uint32_t)));
+    search = static_cast<sudoku::search_mode>(r.get(1));
+    seed = r.get();
+    out_filename = r.get_string();
+    dedup = r.get(1) != 0;
+    expand = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+    min_rating = r.get_double();
+    prune = r.get(1) != 0;
+    digs_per_grid = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+    grid_threads = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+    grid_cache = r.get_string();
+    mix = r.get_string();
+    count = static_cast<long long>(r.get());
+    time_limit = r.get_double();
+    n_resumes = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+    elapsed = r.get_double();
+    out_size = r.get();
+    n_games_valid = static_cast<long long>(r.get());
+    n_games_produced = static_cast<long long>(r.get());
+    uint64_t const n_threads = r.get(sizeof(uint32_t));
+    threads.clear();
+    for (uint64_t i = 0; i < n_threads && in.good(); ++i)
+    {
+        thread_state state;
+        for (uint64_t &s : state.rng)
+        {
+            s = r.get();
+        }
+        state.counters.resize(r.get(sizeof(uint32_t)));
+        for (uint64_t &n : state.counters)
+        {
+            n = r.get();
+        }
+        threads.push_back(std::move(state));
+    }
+    seen_offset_ = static_cast<uint64_t>(in.tellg());
+    return in.good() && !threads.empty();
+}
+
+bool checkpoint::load_seen(std::string const &filename, dedup_set &seen) const
+{
+    std::ifstream in(filename, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(seen_offset_));
+    binary_reader r(in);
+    uint64_t const n = r.get();
+    packed_board packed;
+    for (uint64_t i = 0; i < n && in.good(); ++i)
+    {
+        uint64_t const fingerprint = r.get();
+        uint64_t const canonical = r.get();
+        in.read(reinterpret_cast<char *>(packed.data.data()), static_cast<std::streamsize>(packed.data.size()));
+        seen.restore(fingerprint, packed, canonical);
+    }
+    return in.good();
+}
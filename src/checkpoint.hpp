@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __CHECKPOINT_HPP__
+#define __CHECKPOINT_HPP__
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dedup_set.hpp"
+#include "generators.hpp"
+#include "sudoku.hpp"
+
+/**
+ * @brief Everything needed to resume a generator run where it left off.
+ *
+ * A checkpoint holds the settings of the run, and as of the moment it was
+ * taken, the state of each generator thread's random number stream and
+ * its counters, the writer's totals, how large the output file was, and
+ * the boards in the `dedup_set`. It must be taken while the generator
+ * threads are paused between two boards and everything they delivered so
+ * far has been written (see `pause_gate`).
+ *
+ * Checkpoints are binary, little-endian files, written atomically: the
+ * checkpoint goes to a temporary file first, which is synced to disk and
+ * then replaces the previous one, so a crash never leaves a torn
+ * checkpoint behind. The output file is synced before, so the boards the
+ * checkpoint counts as written are on disk, too.
+ */
+struct checkpoint
+{
+    /**
+     * @brief Magic bytes at the start of a checkpoint file.
+     *
+     */
+    static constexpr std::array<char, 4> MAGIC{'S', 'D', 'C', '3'};
+
+    /**
+     * @brief What a generator thread has done so far, and where its random number stream is.
+     *
+     */
+    struct thread_state
+    {
+        sudoku::rng_t::state_type rng;
+        std::vector<uint64_t> counters;
+    };
+
+    uint8_t algorithm_id{0};
+    int difficulty{0};
+    sudoku::search_mode search{sudoku::search_mode::mrv};
+    uint64_t seed{0};
+    std::string out_filename;
+    bool dedup{true};
+    unsigned int expand{0};
+    double min_rating{0};
+    bool prune{false};
+    unsigned int digs_per_grid{8};
+    unsigned int grid_threads{1};
+    std::string grid_cache;
+    /**
+     * @brief The algorithms an adaptive run chooses from, separated by commas.
+     *
+     */
+    std::string mix;
+    long long count{0};
+    double time_limit{0};
+
+    /**
+     * @brief How often the run has been resumed before.
+     *
+     */
+    unsigned int n_resumes{0};
+    double elapsed{0};
+    uint64_t out_size{0};
+    long long n_games_valid{0};
+    long long n_games_produced{0};
+    std::vector<thread_state> threads;
+
+    /**
+     * @brief Take the state of each generator thread from its sink.
+     *
+     */
+    void capture(std::vector<std::unique_ptr<board_sink>> const &sinks);
+
+    /**
+     * @brief Put the state of each generator thread back into its sink.
+     *
+     * @param sinks as many sinks as there are threads in the checkpoint
+     */
+    void restore(std::vector<std::unique_ptr<board_sink>> &sinks) const;
+
+    /**
+     * @brief Write the checkpoint, atomically replacing `filename`.
+     *
+     * @param seen the boards to save for deduplication, if any
+     * @return false if it couldn't be written
+     */
+    bool save(std::string const &filename, dedup_set *seen) const;
+
+    /**
+     * @brief Read a checkpoint, except for the boards saved for deduplication.
+     *
+     * @return false if the file can't be read or isn't a checkpoint
+     */
+    bool load(std::string const &filename);
+
+    /**
+     * @brief Read the boards saved for deduplication.
+     *
+     * @return false if the file can't be read or isn't a checkpoint
+     */
+    bool load_seen(std::string const &filename, dedup_set &seen) const;
+
+private:
+    /**
+     * @brief Where the boards saved for deduplication start in the file
+     *
+     */
+    uint64_t seen_offset_{0};
+};
+
+#endif // __CHECKPOINT_HPP__
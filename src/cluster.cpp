@@ -0,0 +1,477 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <sstream>
+
+#include "binary_io.hpp"
+#include "cluster.hpp"
+#include "symmetry.hpp"
+
+namespace cluster
+{
+    std::string job::encode() const
+    {
+        std::ostringstream out;
+        binary_writer w(out);
+        w.put(worker, sizeof(uint32_t));
+        w.put(algorithm_id, 1);
+        w.put(static_cast<uint64_t>(difficulty), sizeof(uint32_t));
+        w.put(static_cast<uint64_t>(search), 1);
+        w.put(seed);
+        w.put(first_stream, sizeof(uint32_t));
+        w.put(static_cast<uint64_t>(quota));
+        w.put(dedup, 1);
+        w.put(expand, sizeof(uint32_t));
+        w.put(min_rating);
+        w.put(prune, 1);
+        w.put(digs_per_grid, sizeof(uint32_t));
+        w.put(grid_threads, sizeof(uint32_t));
+        w.put(mix);
+        return out.str();
+    }
+
+    bool job::decode(std::string const &payload)
+    {
+        std::istringstream in(payload);
+        binary_reader r(in);
+        worker = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+        algorithm_id = static_cast<uint8_t>(r.get(1));
+        difficulty = static_cast<int>(r.get(sizeof(uint32_t)));
+        search = static_cast<sudoku::search_mode>(r.get(1));
+        seed = r.get();
+        first_stream = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+        quota = static_cast<long long>(r.get());
+        dedup = r.get(1) != 0;
+        expand = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+        min_rating = r.get_double();
+        prune = r.get(1) != 0;
+        digs_per_grid = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+        grid_threads = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+        mix = r.get_string();
+        return !in.fail();
+    }
+
+    std::string worker_stats::encode() const
+    {
+        std::ostringstream out;
+        binary_writer w(out);
+        w.put(n_games);
+        w.put(n_valid);
+        w.put(elapsed);
+        return out.str();
+    }
+
+    bool worker_stats::decode(std::string const &payload)
+    {
+        std::istringstream in(payload);
+        binary_reader r(in);
+        n_games = r.get();
+        n_valid = r.get();
+        elapsed = r.get_double();
+        return !in.fail();
+    }
+
+    bool send_message(net::connection &conn, message type, std::string const &payload)
+    {
+        if (payload.size() > MAX_PAYLOAD)
+        {
+            return false;
+        }
+        std::string frame;
+        frame.reserve(5 + payload.size());
+        frame.push_back(static_cast<char>(type));
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            frame.push_back(static_cast<char>((payload.size() >> (8 * i)) & 0xffU));
+        }
+        frame += payload;
+        return conn.write_all(frame.data(), frame.size());
+    }
+
+    bool receive_message(net::connection &conn, message &type, std::string &payload)
+    {
+        std::array<char, 5> header;
+        if (!conn.read_exact(header.data(), header.size()))
+        {
+            return false;
+        }
+        type = static_cast<message>(static_cast<uint8_t>(header[0]));
+        std::size_t size = 0;
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            size |= static_cast<std::size_t>(static_cast<uint8_t>(header[1 + i])) << (8 * i);
+        }
+        if (size > MAX_PAYLOAD)
+        {
+            return false;
+        }
+        payload.resize(size);
+        return size == 0 || conn.read_exact(payload.data(), size);
+    }
+
+    uplink::~uplink()
+    {
+        if (receiver_.joinable())
+        {
+            finishing_.store(true);
+            conn_.shutdown();
+            receiver_.join();
+        }
+    }
+
+    bool uplink::connect(std::string const &host, std::string const &port, unsigned int threads, std::string &error)
+    {
+        conn_ = net::connection::connect(host, port, error);
+        if (!conn_.is_open())
+        {
+            return false;
+        }
+        std::ostringstream hello;
+        binary_writer w(hello);
+        w.put(PROTOCOL_VERSION, sizeof(uint32_t));
+        w.put(threads, sizeof(uint32_t));
+        message type;
+        std::string payload;
+        if (!send_message(conn_, message::hello, hello.str()) || !receive_message(conn_, type, payload) || type != message::job || !job_.decode(payload))
+        {
+            error = "the coordinator at " + host + ":" + port + " didn't hand out a job";
+            conn_.close();
+            return false;
+        }
+        receiver_ = std::thread([this]()
+                                {
+            message type;
+            std::string payload;
+            while (receive_message(conn_, type, payload))
+            {
+                if (type == message::stop)
+                {
+                    stopped_.store(true);
+                }
+            }
+            if (!finishing_.load())
+            {
+                lost_.store(true);
+            }
+            stopped_.store(true); });
+        return true;
+    }
+
+    void uplink::write(sudoku::board_t const &board, uint8_t difficulty, uint8_t generator)
+    {
+        std::array<uint8_t, board_record::SIZE> record;
+        board_record{board, difficulty, generator}.pack(record.data());
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch_.append(reinterpret_cast<char const *>(record.data()), record.size());
+        if (batch_.size() >= BATCH_SIZE * board_record::SIZE)
+        {
+            send_batch();
+        }
+    }
+
+    void uplink::report(worker_stats const &stats)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        send_batch();
+        send(message::stats, stats.encode());
+    }
+
+    void uplink::finish(worker_stats const &stats)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            send_batch();
+            send(message::stats, stats.encode());
+            finishing_.store(true);
+            send(message::bye, std::string());
+        }
+        // wait for the coordinator to close its end, so nothing sent gets lost
+        conn_.shutdown_send();
+        if (receiver_.joinable())
+        {
+            receiver_.join();
+        }
+        conn_.close();
+    }
+
+    void uplink::send_batch()
+    {
+        if (!batch_.empty())
+        {
+            send(message::boards, batch_);
+            batch_.clear();
+        }
+    }
+
+    void uplink::send(message type, std::string const &payload)
+    {
+        if (!lost_.load(std::memory_order_relaxed) && !send_message(conn_, type, payload))
+        {
+            lost_.store(true);
+            stopped_.store(true);
+        }
+    }
+
+    coordinator::coordinator(job const &settings, long long quota, corpus_writer &corpus, dedup_set *seen)
+        : settings_(settings), quota_(quota), corpus_(corpus), seen_(seen), expand_(seen != nullptr ? settings.expand : 0)
+    {
+        if (expand_ > 0)
+        {
+            // the variants are made here from stream 0, the workers' threads draw from the others
+            settings_.expand = 0;
+            rng_ = sudoku::rng_t::stream(settings.seed, next_stream_++);
+        }
+    }
+
+    coordinator::~coordinator()
+    {
+        stop(0);
+    }
+
+    bool coordinator::start(std::string const &host, std::string const &port, std::string &error)
+    {
+        if (!listener_.listen(host, port, error))
+        {
+            return false;
+        }
+        acceptor_ = std::thread(&coordinator::accept_loop, this);
+        return true;
+    }
+
+    void coordinator::accept_loop()
+    {
+        while (!stopping_.load())
+        {
+            net::connection conn = listener_.accept(100);
+            std::lock_guard<std::mutex> lock(mutex_);
+            reap();
+            if (!conn.is_open())
+            {
+                continue;
+            }
+            workers_.emplace_back(std::make_shared<worker>());
+            worker &w = *workers_.back();
+            w.info.address = conn.peer();
+            w.conn = std::move(conn);
+            w.thread = std::thread(&coordinator::serve, this, std::ref(w));
+        }
+    }
+
+    /**
+     * Called with `mutex_` held. Only workers whose `serve()` is over are
+     * taken out, so joining them doesn't wait, and `save()` may still hold
+     * on to one it's telling to stop.
+     */
+    void coordinator::reap()
+    {
+        for (auto it = workers_.begin(); it != workers_.end();)
+        {
+            if ((*it)->done.load())
+            {
+                (*it)->thread.join();
+                finished_.push_back((*it)->info);
+                it = workers_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void coordinator::serve(worker &w)
+    {
+        message type;
+        std::string payload;
+        if (receive_message(w.conn, type, payload) && type == message::hello)
+        {
+            std::istringstream hello(payload);
+            binary_reader r(hello);
+            uint64_t const version = r.get(sizeof(uint32_t));
+            unsigned int const threads = static_cast<unsigned int>(r.get(sizeof(uint32_t)));
+            if (!hello.fail() && version == PROTOCOL_VERSION && threads > 0)
+            {
+                job j = settings_;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    j.worker = next_worker_++;
+                    j.first_stream = next_stream_;
+                    next_stream_ += threads;
+                    long long const missing = quota_ - static_cast<long long>(n_saved_.load());
+                    long long const per_board = 1 + static_cast<long long>(expand_);
+                    j.quota = quota_ > 0 ? std::max(1LL, (missing + per_board - 1) / per_board) : 0;
+                    w.info.threads = threads;
+                    w.info.connected = true;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(w.send_mutex);
+                    send_message(w.conn, message::job, j.encode());
+                }
+                if (stopping_.load() || quota_reached())
+                {
+                    tell_to_stop(w);
+                }
+                while (receive_message(w.conn, type, payload) && type != message::bye)
+                {
+                    if (type == message::boards && !save(w, payload))
+                    {
+                        // not a worker of ours, or a broken one
+                        break;
+                    }
+                    else if (type == message::stats)
+                    {
+                        worker_stats stats;
+                        if (stats.decode(payload))
+                        {
+                            std::lock_guard<std::mutex> lock(mutex_);
+                            w.info.stats = stats;
+                        }
+                    }
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            w.info.connected = false;
+        }
+        w.conn.shutdown();
+        w.done.store(true);
+    }
+
+    /**
+     * Nothing of a batch is saved unless all its records are valid (see `board_record::valid()`).
+     */
+    bool coordinator::save(worker &w, std::string const &records)
+    {
+        if (records.size() % board_record::SIZE != 0)
+        {
+            return false;
+        }
+        for (std::size_t offset = 0; offset < records.size(); offset += board_record::SIZE)
+        {
+            if (!board_record::unpack(reinterpret_cast<uint8_t const *>(records.data() + offset)).valid())
+            {
+                return false;
+            }
+        }
+        std::vector<std::shared_ptr<worker>> to_stop;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bool const reached_before = quota_reached();
+            for (std::size_t offset = 0; offset + board_record::SIZE <= records.size(); offset += board_record::SIZE)
+            {
+                ++w.info.n_received;
+                if (quota_reached())
+                {
+                    continue;
+                }
+                board_record const rec = board_record::unpack(reinterpret_cast<uint8_t const *>(records.data() + offset));
+                if (seen_ != nullptr && !seen_->insert(rec.board))
+                {
+                    ++w.info.n_duplicates;
+                    continue;
+                }
+                corpus_.write(rec.board, rec.difficulty, rec.generator);
+                ++w.info.n_saved;
+                n_saved_.fetch_add(1, std::memory_order_relaxed);
+                for (unsigned int i = 0; i < expand_ && !quota_reached(); ++i)
+                {
+                    corpus_.write(symmetry::random(rng_).apply(rec.board), rec.difficulty, rec.generator);
+                    ++w.info.n_saved;
+                    n_saved_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if (!reached_before && quota_reached())
+            {
+                to_stop = workers_;
+            }
+        }
+        // a slow worker mustn't hold up the others while they're told to stop
+        for (auto &other : to_stop)
+        {
+            tell_to_stop(*other);
+        }
+        return true;
+    }
+
+    void coordinator::tell_to_stop(worker &w)
+    {
+        std::lock_guard<std::mutex> lock(w.send_mutex);
+        if (!w.told_to_stop)
+        {
+            w.told_to_stop = true;
+            send_message(w.conn, message::stop, std::string());
+        }
+    }
+
+    void coordinator::stop(double timeout)
+    {
+        stopping_.store(true);
+        if (acceptor_.joinable())
+        {
+            acceptor_.join();
+        }
+        listener_.close();
+        std::vector<std::shared_ptr<worker>> to_stop;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            to_stop = workers_;
+        }
+        for (auto &w : to_stop)
+        {
+            tell_to_stop(*w);
+        }
+        // with the acceptor gone, the list of workers doesn't change anymore
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+        for (auto &w : workers_)
+        {
+            while (!w->done.load() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            if (!w->done.load())
+            {
+                w->conn.shutdown();
+            }
+            if (w->thread.joinable())
+            {
+                w->thread.join();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        corpus_.flush();
+    }
+
+    std::vector<coordinator::worker_info> coordinator::workers()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<worker_info> result = finished_;
+        for (auto const &w : workers_)
+        {
+            result.push_back(w->info);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,316 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __CLUSTER_HPP__
+#define __CLUSTER_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "corpus.hpp"
+#include "dedup_set.hpp"
+#include "net.hpp"
+#include "sudoku.hpp"
+
+/**
+ * @brief Generating on many machines: workers that generate, and a coordinator that collects.
+ *
+ * Workers connect to the coordinator over TCP and say how many threads
+ * they run. The coordinator answers with a `job`: the settings of the
+ * run, the numbers of the random number streams the worker's threads
+ * are to use, and how many valid boards are still missing. The worker
+ * then generates just like a single machine would, but hands the valid
+ * boards to its `uplink` instead of writing them, which sends them to
+ * the coordinator in batches of `board_record`s. The coordinator drops
+ * boards equivalent to one it got before, from whichever worker, writes
+ * the others to its output file, and tells all workers to stop once
+ * enough have arrived. Variants of `--expand` are equivalent to their
+ * original by construction, so with deduplication the coordinator makes
+ * them itself, after the original passed, instead of the workers.
+ *
+ * Messages are framed by a byte for their type and the length of their
+ * payload as a 32-bit number, little-endian like everything else.
+ * There's no authentication, so coordinators belong in trusted networks.
+ */
+namespace cluster
+{
+    static constexpr uint32_t PROTOCOL_VERSION = 1;
+    static constexpr std::size_t MAX_PAYLOAD = 16U << 20;
+
+    enum class message : uint8_t
+    {
+        /**
+         * @brief Worker to coordinator: protocol version and number of threads.
+         */
+        hello = 1,
+        /**
+         * @brief Coordinator to worker: the `job`.
+         */
+        job,
+        /**
+         * @brief Worker to coordinator: valid boards, as `board_record`s.
+         */
+        boards,
+        /**
+         * @brief Worker to coordinator: the worker's `worker_stats`.
+         */
+        stats,
+        /**
+         * @brief Coordinator to worker: stop generating.
+         */
+        stop,
+        /**
+         * @brief Worker to coordinator: all boards and the final stats have been sent.
+         */
+        bye
+    };
+
+    /**
+     * @brief What a worker is to generate.
+     *
+     * The worker's threads draw from the random number streams
+     * `first_stream` and on, derived from `seed`, so no two threads in
+     * the cluster draw the same numbers. `quota` is how many valid boards
+     * the coordinator still needs; 0 if there's no limit.
+     */
+    struct job
+    {
+        unsigned int worker{0};
+        uint8_t algorithm_id{0};
+        int difficulty{0};
+        sudoku::search_mode search{sudoku::search_mode::mrv};
+        uint64_t seed{0};
+        unsigned int first_stream{0};
+        long long quota{0};
+        bool dedup{true};
+        unsigned int expand{0};
+        double min_rating{0};
+        bool prune{false};
+        unsigned int digs_per_grid{8};
+        unsigned int grid_threads{1};
+        std::string mix;
+
+        std::string encode() const;
+        bool decode(std::string const &payload);
+    };
+
+    /**
+     * @brief What a worker reports about the boards it generated.
+     *
+     */
+    struct worker_stats
+    {
+        uint64_t n_games{0};
+        uint64_t n_valid{0};
+        double elapsed{0};
+
+        std::string encode() const;
+        bool decode(std::string const &payload);
+    };
+
+    /**
+     * @brief Send a message of `type` with `payload` over `conn`.
+     *
+     */
+    bool send_message(net::connection &conn, message type, std::string const &payload);
+
+    /**
+     * @brief Receive a message from `conn`.
+     *
+     * @return false if the connection closed, broke, or the message is larger than `MAX_PAYLOAD`
+     */
+    bool receive_message(net::connection &conn, message &type, std::string &payload);
+
+    /**
+     * @brief The worker's end of the connection to the coordinator.
+     *
+     * `write()` is called by the writer thread, `report()` by the thread
+     * that started the run, and a thread of its own waits for the
+     * coordinator to tell it to stop. If the connection breaks, the run
+     * stops as if told so, and `lost()` returns true.
+     */
+    class uplink
+    {
+    public:
+        static constexpr std::size_t BATCH_SIZE = 256;
+
+        uplink() = default;
+        ~uplink();
+        uplink(uplink const &) = delete;
+        uplink &operator=(uplink const &) = delete;
+
+        /**
+         * @brief Connect to the coordinator, offering `threads` threads, and wait for the job.
+         *
+         * @return false if it failed, with the reason in `error`
+         */
+        bool connect(std::string const &host, std::string const &port, unsigned int threads, std::string &error);
+
+        inline job const &get_job() const
+        {
+            return job_;
+        }
+
+        /**
+         * @brief Queue a valid board to be sent, sending a batch once `BATCH_SIZE` are queued.
+         *
+         */
+        void write(sudoku::board_t const &board, uint8_t difficulty, uint8_t generator);
+
+        /**
+         * @brief Send the boards queued so far, followed by `stats`.
+         *
+         */
+        void report(worker_stats const &stats);
+
+        /**
+         * @brief `report()`, then say goodbye and close the connection.
+         *
+         */
+        void finish(worker_stats const &stats);
+
+        inline bool stopped() const
+        {
+            return stopped_.load(std::memory_order_relaxed);
+        }
+
+        inline bool lost() const
+        {
+            return lost_.load();
+        }
+
+    private:
+        void send_batch();
+        void send(message type, std::string const &payload);
+
+        net::connection conn_;
+        job job_;
+        std::mutex mutex_;
+        std::string batch_;
+        std::atomic<bool> stopped_{false};
+        std::atomic<bool> lost_{false};
+        std::atomic<bool> finishing_{false};
+        std::thread receiver_;
+    };
+
+    /**
+     * @brief Hands out jobs to the workers that connect, and collects their boards.
+     *
+     * Valid boards go to `corpus`, unless `seen` is set and already holds an
+     * equivalent one. If `seen` is set, each board written is followed by
+     * `settings.expand` variants made here, and the workers' jobs ask for
+     * none. Once `quota` boards have been written (if not 0), all
+     * workers are told to stop, and later boards are dropped.
+     */
+    class coordinator
+    {
+    public:
+        /**
+         * @brief What's known about a worker.
+         *
+         */
+        struct worker_info
+        {
+            std::string address;
+            unsigned int threads{0};
+            bool connected{false};
+            unsigned long long n_received{0};
+            unsigned long long n_saved{0};
+            unsigned long long n_duplicates{0};
+            worker_stats stats;
+        };
+
+        coordinator(job const &settings, long long quota, corpus_writer &corpus, dedup_set *seen);
+        ~coordinator();
+        coordinator(coordinator const &) = delete;
+        coordinator &operator=(coordinator const &) = delete;
+
+        /**
+         * @brief Start accepting workers at `port` on the interface `host`, or on all if empty.
+         *
+         * @return false if it failed, with the reason in `error`
+         */
+        bool start(std::string const &host, std::string const &port, std::string &error);
+
+        /**
+         * @brief Tell all workers to stop, and wait up to `timeout` seconds for their last boards.
+         *
+         */
+        void stop(double timeout = 10);
+
+        inline bool quota_reached() const
+        {
+            return quota_ > 0 && n_saved_.load(std::memory_order_relaxed) >= static_cast<unsigned long long>(quota_);
+        }
+
+        inline unsigned long long saved() const
+        {
+            return n_saved_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief What's known about all workers so far, those that left included.
+         *
+         */
+        std::vector<worker_info> workers();
+
+    private:
+        struct worker
+        {
+            net::connection conn;
+            std::mutex send_mutex;
+            bool told_to_stop{false};
+            worker_info info;
+            std::atomic<bool> done{false};
+            std::thread thread;
+        };
+
+        void accept_loop();
+        void reap();
+        void serve(worker &w);
+        bool save(worker &w, std::string const &records);
+        void tell_to_stop(worker &w);
+
+        job settings_;
+        long long quota_;
+        corpus_writer &corpus_;
+        dedup_set *seen_;
+        unsigned int expand_;
+        sudoku::rng_t rng_;
+        net::listener listener_;
+        std::atomic<bool> stopping_{false};
+        std::atomic<unsigned long long> n_saved_{0};
+        std::mutex mutex_;
+        std::vector<std::shared_ptr<worker>> workers_;
+        std::vector<worker_info> finished_;
+        unsigned int next_worker_{0};
+        unsigned int next_stream_{0};
+        std::thread acceptor_;
+    };
+}
+
+#endif // __CLUSTER_HPP__
@@ -0,0 +1,150 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <filesystem>
+
+#include "corpus.hpp"
+
+void board_record::pack(uint8_t *dst) const
+{
+    dst[0] = difficulty;
+    packed_board const packed = packed_board::pack(board);
+    std::copy(packed.data.begin(), packed.data.end(), dst + 1);
+    dst[packed_board::SIZE] |= static_cast<uint8_t>(generator & 0xfU);
+}
+
+board_record board_record::unpack(uint8_t const *src)
+{
+    board_record rec;
+    rec.difficulty = src[0];
+    packed_board packed;
+    std::copy(src + 1, src + 1 + packed_board::SIZE, packed.data.begin());
+    rec.generator = packed.data.back() & 0xfU;
+    packed.data.back() &= 0xf0U;
+    rec.board = packed.unpack();
+    return rec;
+}
+
+bool board_record::valid() const
+{
+    uint16_t rows[9] = {0};
+    uint16_t cols[9] = {0};
+    uint16_t boxes[9] = {0};
+    unsigned int n_empty = 0;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        char const c = board[i];
+        if (c == sudoku::EMPTY)
+        {
+            ++n_empty;
+            continue;
+        }
+        if (c < '1' || c > '9')
+        {
+            return false;
+        }
+        uint16_t const bit = static_cast<uint16_t>(1U << (c - '1'));
+        unsigned int const box = (i / 27) * 3 + (i % 9) / 3;
+        if (((rows[i / 9] | cols[i % 9] | boxes[box]) & bit) != 0)
+        {
+            return false;
+        }
+        rows[i / 9] |= bit;
+        cols[i % 9] |= bit;
+        boxes[box] |= bit;
+    }
+    return n_empty == difficulty;
+}
+
+bool parse_board(char const *begin, char const *end, sudoku::board_t &board)
+{
+    std::size_t n = 0;
+    for (char const *p = begin; p != end; ++p)
+    {
+        if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        {
+            continue;
+        }
+        if (((*p < '0' || *p > '9') && *p != '.') || n == board.size())
+        {
+            return false;
+        }
+        board[n++] = *p == '.' ? sudoku::EMPTY : *p;
+    }
+    return n == board.size();
+}
+
+corpus_writer::format corpus_writer::format_for(std::string const &filename)
+{
+    return std::filesystem::path(filename).extension() == ".sdk"
+               ? format::binary
+               : format::text;
+}
+
+corpus_writer::corpus_writer(std::string const &filename, std::size_t batch_size)
+    : format_(format_for(filename)), batch_size_(batch_size), last_flush_(std::chrono::steady_clock::now())
+{
+    std::error_code ec;
+    bool const fresh = !std::filesystem::exists(filename, ec) || std::filesystem::file_size(filename, ec) == 0;
+    out_.open(filename, std::ios::binary | std::ios::app);
+    buffer_.reserve(batch_size_ + board_record::SIZE + 82);
+    if (fresh && format_ == format::binary)
+    {
+        buffer_.insert(buffer_.end(), MAGIC.begin(), MAGIC.end());
+    }
+}
+
+corpus_writer::~corpus_writer()
+{
+    flush();
+}
+
+void corpus_writer::write(sudoku::board_t const &board, uint8_t difficulty, uint8_t generator)
+{
+    if (format_ == format::binary)
+    {
+        std::array<uint8_t, board_record::SIZE> packed;
+        board_record{board, difficulty, generator}.pack(packed.data());
+        buffer_.insert(buffer_.end(), packed.begin(), packed.end());
+    }
+    else
+    {
+        buffer_.insert(buffer_.end(), board.begin(), board.end());
+        buffer_.push_back('\n');
+    }
+    if (buffer_.size() >= batch_size_ || std::chrono::steady_clock::now() - last_flush_ > std::chrono::seconds(1))
+    {
+        flush();
+    }
+}
+
+void corpus_writer::flush()
+{
+    if (!buffer_.empty())
+    {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.flush();
+        buffer_.clear();
+    }
+    last_flush_ = std::chrono::steady_clock::now();
+}
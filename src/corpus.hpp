@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __CORPUS_HPP__
+#define __CORPUS_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "packed_board.hpp"
+#include "sudoku.hpp"
+
+/**
+ * @brief Compact binary representation of a generated board.
+ *
+ * A record takes `SIZE` bytes: the first byte holds the difficulty,
+ * followed by the `packed_board`, whose otherwise unused last nibble
+ * holds the id of the generator that produced the board.
+ */
+struct board_record
+{
+    static constexpr std::size_t SIZE = 1 + packed_board::SIZE;
+
+    sudoku::board_t board;
+    uint8_t difficulty;
+    uint8_t generator;
+
+    /**
+     * @brief Serialize the record.
+     *
+     * @param[out] dst buffer with room for at least `SIZE` bytes
+     */
+    void pack(uint8_t *dst) const;
+
+    /**
+     * @brief Deserialize a record.
+     *
+     * @param src buffer holding `SIZE` bytes
+     * @return board_record
+     */
+    static board_record unpack(uint8_t const *src);
+
+    /**
+     * @brief Check a record read from a file or the network before it's used.
+     *
+     * @return true if each cell holds a digit or is empty, no row, column
+     *         or box holds a digit twice, and `difficulty` is the number of
+     *         empty cells
+     */
+    bool valid() const;
+};
+
+/**
+ * @brief Read a board of 81 digits, '.' or '0' for an empty cell, ignoring spaces, tabs and line breaks.
+ *
+ * @return false if there's anything else, or a different number of digits
+ */
+bool parse_board(char const *begin, char const *end, sudoku::board_t &board);
+
+/**
+ * @brief Appends boards to a single corpus file, writing in large batches.
+ *
+ * Two formats are supported: `text` writes one 81-char line per board,
+ * `binary` writes a 4-byte magic followed by `board_record`s. The format
+ * is derived from the file name: `.sdk` means binary.
+ */
+class corpus_writer
+{
+public:
+    enum class format
+    {
+        text,
+        binary
+    };
+
+    /**
+     * @brief Magic bytes at the start of a binary corpus file.
+     *
+     */
+    static constexpr std::array<char, 4> MAGIC{'S', 'D', 'K', '1'};
+
+    /**
+     * @brief Open a corpus file for appending.
+     *
+     * @param filename the file to append to; created if missing
+     * @param batch_size write to disk when that many bytes are pending
+     */
+    explicit corpus_writer(std::string const &filename, std::size_t batch_size = 1U << 20);
+    ~corpus_writer();
+
+    corpus_writer(corpus_writer const &) = delete;
+    corpus_writer &operator=(corpus_writer const &) = delete;
+
+    /**
+     * @brief Queue a board for writing.
+     *
+     * Pending data is written when the batch is full, or when it has been
+     * pending for more than a second.
+     */
+    void write(sudoku::board_t const &board, uint8_t difficulty, uint8_t generator);
+
+    /**
+     * @brief Write all pending data to disk.
+     *
+     */
+    void flush();
+
+    inline bool good() const
+    {
+        return out_.good();
+    }
+
+    inline format get_format() const
+    {
+        return format_;
+    }
+
+    static format format_for(std::string const &filename);
+
+private:
+    std::ofstream out_;
+    format format_;
+    std::size_t batch_size_;
+    std::vector<char> buffer_;
+    std::chrono::time_point<std::chrono::steady_clock> last_flush_;
+};
+
+#endif // __CORPUS_HPP__
@@ -0,0 +1,331 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "corpus_index.hpp"
+
+namespace
+{
+    /**
+     * @brief Boards read before they're graded together.
+     *
+     */
+    constexpr std::size_t BATCH_SIZE = 1U << 16;
+    constexpr std::size_t CHUNK_SIZE = 64;
+    /**
+     * @brief Records collected per bucket before they're written to the index.
+     *
+     */
+    constexpr std::size_t BUCKET_BUFFER = 256;
+
+    void put_le(std::vector<char> &out, uint64_t n, unsigned int bytes)
+    {
+        for (unsigned int i = 0; i < bytes; ++i)
+        {
+            out.push_back(static_cast<char>((n >> (8 * i)) & 0xffU));
+        }
+    }
+
+    uint64_t get_le(uint8_t const *p, unsigned int bytes)
+    {
+        uint64_t n = 0;
+        for (unsigned int i = 0; i < bytes; ++i)
+        {
+            n |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return n;
+    }
+
+    inline uint8_t empty_count(sudoku::board_t const &board)
+    {
+        return static_cast<uint8_t>(std::count(board.begin(), board.end(), sudoku::EMPTY));
+    }
+
+    /**
+     * @brief Call `on_board` with each board of a corpus (see `corpus_index::build()`).
+     *
+     * Boards read from text get their number of empty cells as difficulty
+     * and 0 as generator id. Boards that aren't valid (see
+     * `board_record::valid()`) are counted in `n_skipped`.
+     *
+     * @return false if the corpus can't be read
+     */
+    template <typename OnBoard>
+    bool for_each_board(std::string const &input, OnBoard &&on_board, unsigned long long &n_skipped)
+    {
+        board_record rec;
+        std::error_code ec;
+        if (std::filesystem::is_directory(input, ec))
+        {
+            for (auto const &entry : std::filesystem::directory_iterator(input, ec))
+            {
+                if (!entry.is_regular_file(ec) || entry.path().extension() != ".txt")
+                {
+                    continue;
+                }
+                std::ifstream fin(entry.path(), std::ios::binary);
+                std::string const text{std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>()};
+                if (!parse_board(text.data(), text.data() + text.size(), rec.board))
+                {
+                    ++n_skipped;
+                    continue;
+                }
+                rec.difficulty = empty_count(rec.board);
+                rec.generator = 0;
+                if (!rec.valid())
+                {
+                    ++n_skipped;
+                    continue;
+                }
+                on_board(rec);
+            }
+            return !ec;
+        }
+        util::mapped_file file(input);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        char const *pos = file.data();
+        char const *const end = pos + file.size();
+        if (file.size() >= corpus_writer::MAGIC.size() && std::equal(corpus_writer::MAGIC.begin(), corpus_writer::MAGIC.end(), pos))
+        {
+            pos += corpus_writer::MAGIC.size();
+            for (; static_cast<std::size_t>(end - pos) >= board_record::SIZE; pos += board_record::SIZE)
+            {
+                rec = board_record::unpack(reinterpret_cast<uint8_t const *>(pos));
+                if (!rec.valid())
+                {
+                    ++n_skipped;
+                    continue;
+                }
+                on_board(rec);
+            }
+            // a record cut short, e.g. by a crash while writing
+            n_skipped += pos != end;
+            return true;
+        }
+        while (pos < end)
+        {
+            char const *eol = std::find(pos, end, '\n');
+            if (parse_board(pos, eol, rec.board))
+            {
+                rec.difficulty = empty_count(rec.board);
+                rec.generator = 0;
+                if (rec.valid())
+                {
+                    on_board(rec);
+                }
+                else
+                {
+                    ++n_skipped;
+                }
+            }
+            else if (std::any_of(pos, eol, [](char c)
+                                 { return c != ' ' && c != '\t' && c != '\r'; }))
+            {
+                ++n_skipped;
+            }
+            pos = eol == end ? end : eol + 1;
+        }
+        return true;
+    }
+}
+
+bool corpus_index::query::matches(unsigned int bucket) const
+{
+    double const r = grader::rating(static_cast<grader::technique>(bucket % TECHNIQUES));
+    return (empty_cells < 0 || bucket / TECHNIQUES == static_cast<unsigned int>(empty_cells)) && r >= min_rating && r <= max_rating;
+}
+
+bool corpus_index::build(std::string const &input, std::string const &filename, unsigned int thread_count, build_result &result)
+{
+    // pass 1: grade the boards and keep them in a spill file in input order,
+    // pass 2: scatter them from there into their buckets
+    std::string const spill_filename = filename + ".tmp";
+    std::ofstream spill(spill_filename, std::ios::binary | std::ios::trunc);
+    if (!spill.good())
+    {
+        return false;
+    }
+    thread_count = std::max(1U, thread_count);
+    std::vector<grader> graders(thread_count);
+    std::vector<board_record> batch;
+    batch.reserve(BATCH_SIZE);
+    std::vector<uint16_t> buckets;
+    std::array<uint64_t, BUCKETS> counts{};
+    std::vector<char> packed(BATCH_SIZE * board_record::SIZE);
+    auto grade_batch = [&]()
+    {
+        std::size_t const n = batch.size();
+        std::size_t const base = buckets.size();
+        buckets.resize(base + n);
+        std::atomic<std::size_t> next{0};
+        auto worker = [&](grader &rater)
+        {
+            std::size_t first;
+            while ((first = next.fetch_add(CHUNK_SIZE, std::memory_order_relaxed)) < n)
+            {
+                std::size_t const last = std::min(first + CHUNK_SIZE, n);
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    sudoku::board_t const &board = batch[i].board;
+                    buckets[base + i] = static_cast<uint16_t>(bucket_of(empty_count(board), rater.grade(board).hardest));
+                    batch[i].pack(reinterpret_cast<uint8_t *>(packed.data()) + i * board_record::SIZE);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back(worker, std::ref(graders[i]));
+        }
+        worker(graders.front());
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        for (std::size_t i = base; i < base + n; ++i)
+        {
+            ++counts[buckets[i]];
+        }
+        spill.write(packed.data(), static_cast<std::streamsize>(n * board_record::SIZE));
+        batch.clear();
+    };
+    result = build_result{};
+    bool const readable = for_each_board(
+        input, [&](board_record const &rec)
+        {
+            batch.push_back(rec);
+            if (batch.size() == BATCH_SIZE)
+            {
+                grade_batch();
+            } },
+        result.n_skipped);
+    grade_batch();
+    spill.close();
+    if (!readable || !spill.good())
+    {
+        std::filesystem::remove(spill_filename);
+        return false;
+    }
+    result.n_indexed = buckets.size();
+
+    std::vector<char> header;
+    header.reserve(HEADER_SIZE);
+    header.insert(header.end(), MAGIC.begin(), MAGIC.end());
+    put_le(header, EMPTY_COUNTS, sizeof(uint32_t));
+    put_le(header, TECHNIQUES, sizeof(uint32_t));
+    put_le(header, board_record::SIZE, sizeof(uint32_t));
+    std::array<uint64_t, BUCKETS> cursor;
+    uint64_t n_before = 0;
+    for (unsigned int b = 0; b < BUCKETS; ++b)
+    {
+        put_le(header, n_before, sizeof(uint64_t));
+        cursor[b] = n_before;
+        n_before += counts[b];
+    }
+    put_le(header, n_before, sizeof(uint64_t));
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    {
+        util::mapped_file spilled(spill_filename);
+        std::vector<std::vector<char>> pending(BUCKETS);
+        auto write_bucket = [&](unsigned int b)
+        {
+            out.seekp(static_cast<std::streamoff>(HEADER_SIZE + cursor[b] * board_record::SIZE));
+            out.write(pending[b].data(), static_cast<std::streamsize>(pending[b].size()));
+            cursor[b] += pending[b].size() / board_record::SIZE;
+            pending[b].clear();
+        };
+        for (std::size_t i = 0; i < buckets.size(); ++i)
+        {
+            std::vector<char> &p = pending[buckets[i]];
+            char const *rec = spilled.data() + i * board_record::SIZE;
+            p.insert(p.end(), rec, rec + board_record::SIZE);
+            if (p.size() == BUCKET_BUFFER * board_record::SIZE)
+            {
+                write_bucket(buckets[i]);
+            }
+        }
+        for (unsigned int b = 0; b < BUCKETS; ++b)
+        {
+            if (!pending[b].empty())
+            {
+                write_bucket(b);
+            }
+        }
+    }
+    out.close();
+    std::filesystem::remove(spill_filename);
+    return out.good();
+}
+
+corpus_index::corpus_index(std::string const &filename)
+    : file_(filename, false)
+{
+    if (!file_.is_open() || file_.size() < HEADER_SIZE || !std::equal(MAGIC.begin(), MAGIC.end(), file_.data()))
+    {
+        return;
+    }
+    uint8_t const *data = reinterpret_cast<uint8_t const *>(file_.data());
+    uint8_t const *dims = data + MAGIC.size();
+    if (get_le(dims, sizeof(uint32_t)) != EMPTY_COUNTS ||
+        get_le(dims + sizeof(uint32_t), sizeof(uint32_t)) != TECHNIQUES ||
+        get_le(dims + 2 * sizeof(uint32_t), sizeof(uint32_t)) != board_record::SIZE)
+    {
+        return;
+    }
+    first_ = dims + 3 * sizeof(uint32_t);
+    records_ = data + HEADER_SIZE;
+    if (first(0) != 0)
+    {
+        return;
+    }
+    for (unsigned int b = 0; b < BUCKETS; ++b)
+    {
+        if (first(b + 1) < first(b))
+        {
+            return;
+        }
+    }
+    valid_ = file_.size() - HEADER_SIZE == size() * board_record::SIZE;
+}
+
+uint64_t corpus_index::count(query const &q) const
+{
+    uint64_t n = 0;
+    for (unsigned int b = 0; b < BUCKETS; ++b)
+    {
+        if (q.matches(b))
+        {
+            n += count(b);
+        }
+    }
+    return n;
+}
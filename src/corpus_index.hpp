@@ -0,0 +1,218 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __CORPUS_INDEX_HPP__
+#define __CORPUS_INDEX_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "corpus.hpp"
+#include "grader.hpp"
+#include "util.hpp"
+
+/**
+ * @brief Read-only corpus of boards, bucketed by number of empty cells and rating.
+ *
+ * An index file holds the boards of a corpus as `board_record`s, sorted
+ * into one bucket per number of empty cells and hardest technique needed
+ * (see `grader`). A small table of where each bucket starts comes first,
+ * so the file can be memory-mapped and used as is: the records of a
+ * bucket are contiguous, and picking one at random takes the same time
+ * however large the corpus is.
+ *
+ * Layout, all numbers little-endian: the 4-byte `MAGIC`, the number of
+ * empty cell counts, techniques and bytes per record as 32-bit numbers,
+ * then for each of the `BUCKETS` buckets, plus one, the 64-bit number of
+ * records before it, and finally the records.
+ */
+class corpus_index
+{
+public:
+    /**
+     * @brief Magic bytes at the start of an index file.
+     *
+     */
+    static constexpr std::array<char, 4> MAGIC{'S', 'D', 'I', '1'};
+    static constexpr unsigned int EMPTY_COUNTS = 82;
+    static constexpr unsigned int TECHNIQUES = static_cast<unsigned int>(grader::technique::unsolved) + 1;
+    static constexpr unsigned int BUCKETS = EMPTY_COUNTS * TECHNIQUES;
+    static constexpr std::size_t HEADER_SIZE = MAGIC.size() + 3 * sizeof(uint32_t) + (BUCKETS + 1) * sizeof(uint64_t);
+
+    static constexpr unsigned int bucket_of(unsigned int empty_cells, grader::technique hardest)
+    {
+        return empty_cells * TECHNIQUES + static_cast<unsigned int>(hardest);
+    }
+
+    /**
+     * @brief Which boards a query picks from.
+     *
+     * `empty_cells` < 0 matches any number of empty cells. The rating is
+     * that of the hardest technique needed (see `grader::rating()`).
+     */
+    struct query
+    {
+        int empty_cells{-1};
+        double min_rating{0};
+        double max_rating{10};
+
+        bool matches(unsigned int bucket) const;
+    };
+
+    /**
+     * @brief What building an index did.
+     *
+     */
+    struct build_result
+    {
+        unsigned long long n_indexed{0};
+        unsigned long long n_skipped{0};
+    };
+
+    /**
+     * @brief Build an index file from a corpus.
+     *
+     * The corpus may be a binary corpus file (see `corpus_writer`), a
+     * text file with one board per line, or a directory of text files
+     * holding one board each. Lines and files that don't hold a board of
+     * 81 digits are skipped. Boards are graded in `thread_count` threads.
+     * Besides the bucket of each board, only a batch of them is held in
+     * memory; the rest waits in a temporary file next to the index.
+     *
+     * @param input the corpus
+     * @param filename the index file to write
+     * @param thread_count number of threads grading boards
+     * @param[out] result how many boards have been indexed and skipped
+     * @return false if the corpus can't be read or the index can't be written
+     */
+    static bool build(std::string const &input, std::string const &filename, unsigned int thread_count, build_result &result);
+
+    /**
+     * @brief Map an index file.
+     *
+     * @param filename the index file
+     */
+    explicit corpus_index(std::string const &filename);
+
+    corpus_index(corpus_index const &) = delete;
+    corpus_index &operator=(corpus_index const &) = delete;
+
+    /**
+     * @brief Check if the file could be mapped and is a well-formed index.
+     *
+     */
+    inline bool is_open() const
+    {
+        return valid_;
+    }
+
+    /**
+     * @brief Number of boards in the index.
+     *
+     */
+    inline uint64_t size() const
+    {
+        return first(BUCKETS);
+    }
+
+    /**
+     * @brief Number of boards in a bucket.
+     *
+     */
+    inline uint64_t count(unsigned int bucket) const
+    {
+        return first(bucket + 1) - first(bucket);
+    }
+
+    /**
+     * @brief Number of boards a query picks from.
+     *
+     */
+    uint64_t count(query const &q) const;
+
+    /**
+     * @brief Get the `i`-th record of a bucket, in place in the mapped file.
+     *
+     * @return uint8_t const* `board_record::SIZE` bytes
+     */
+    inline uint8_t const *record(unsigned int bucket, uint64_t i) const
+    {
+        return records_ + (first(bucket) + i) * board_record::SIZE;
+    }
+
+    /**
+     * @brief Pick one of the boards a query matches at random.
+     *
+     * Every matching board is equally likely. Takes time proportional to
+     * the number of buckets, not to the number of boards.
+     *
+     * @param q the query
+     * @param rng random number generator
+     * @param[out] bucket the bucket of the board
+     * @return uint8_t const* the board's record in the mapped file, or nullptr if no board matches
+     */
+    template <typename Rng>
+    uint8_t const *pick(query const &q, Rng &rng, unsigned int &bucket) const
+    {
+        uint64_t const n = count(q);
+        if (n == 0)
+        {
+            return nullptr;
+        }
+        uint64_t i = rng() % n;
+        for (bucket = 0; bucket < BUCKETS; ++bucket)
+        {
+            if (!q.matches(bucket))
+            {
+                continue;
+            }
+            uint64_t const n_bucket = count(bucket);
+            if (i < n_bucket)
+            {
+                break;
+            }
+            i -= n_bucket;
+        }
+        return record(bucket, i);
+    }
+
+private:
+    inline uint64_t first(unsigned int bucket) const
+    {
+        uint8_t const *p = first_ + bucket * sizeof(uint64_t);
+        uint64_t n = 0;
+        for (unsigned int i = 0; i < sizeof(uint64_t); ++i)
+        {
+            n |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return n;
+    }
+
+    util::mapped_file file_;
+    uint8_t const *first_{nullptr};
+    uint8_t const *records_{nullptr};
+    bool valid_{false};
+};
+
+#endif // __CORPUS_INDEX_HPP__
@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __DEDUP_SET_HPP__
+#define __DEDUP_SET_HPP__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+
+#include "canonical.hpp"
+#include "packed_board.hpp"
+#include "spsc_queue.hpp"
+#include "sudoku.hpp"
+
+/**
+ * @brief Thread-safe set of boards that treats equivalent boards as equal.
+ *
+ * Boards are keyed by their `symmetry_fingerprint()` and spread over
+ * `SHARDS` independently locked shards, so generator threads rarely
+ * contend. The expensive `canonical_form()` is only computed if the
+ * fingerprint of a new board has been seen before, which for distinct
+ * boards is rare. Each entry keeps a 64-bit hash of its board's canonical
+ * form once it has been computed, so on a collision only the new board
+ * is canonicalized, and each board in the set at most once.
+ *
+ * Each shard takes its nodes from a pool of its own, guarded by the
+ * shard's lock, which gets memory from the heap in ever larger chunks.
+ * So as the set grows the generator threads allocate ever more rarely,
+ * instead of once per board.
+ */
+class dedup_set
+{
+public:
+    static constexpr std::size_t SHARDS = 64;
+
+    /**
+     * @brief Stands in for a canonical hash that hasn't been computed yet.
+     *
+     */
+    static constexpr uint64_t UNKNOWN = 0;
+
+    /**
+     * @brief Insert a board unless an equivalent one is in the set already.
+     *
+     * @param board the board
+     * @return true if the board was inserted
+     * @return false if it's a duplicate
+     */
+    bool insert(sudoku::board_t const &board)
+    {
+        uint64_t const fingerprint = symmetry_fingerprint(board);
+        shard &s = shards_[static_cast<std::size_t>(fingerprint >> 32) % SHARDS];
+        entry e{packed_board::pack(board), UNKNOWN};
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto const range = s.boards.equal_range(fingerprint);
+        if (range.first != range.second)
+        {
+            e.canonical = canonical_hash(e.board.unpack());
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second.board == e.board)
+                {
+                    return false;
+                }
+                if (it->second.canonical == UNKNOWN)
+                {
+                    it->second.canonical = canonical_hash(it->second.board.unpack());
+                }
+                if (it->second.canonical == e.canonical)
+                {
+                    return false;
+                }
+            }
+            n_collisions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        s.boards.emplace(fingerprint, e);
+        return true;
+    }
+
+    /**
+     * @brief Insert a board saved from another set, trusting it's no duplicate (see `for_each()`).
+     *
+     */
+    void restore(uint64_t fingerprint, packed_board const &packed, uint64_t canonical)
+    {
+        shard &s = shards_[static_cast<std::size_t>(fingerprint >> 32) % SHARDS];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.boards.emplace(fingerprint, entry{packed, canonical});
+    }
+
+    /**
+     * @brief Call `visit` with the fingerprint, packed board and canonical hash of each board in the set.
+     *
+     * The canonical hash is `UNKNOWN` if it hasn't been computed yet.
+     * Each shard is locked while it's visited.
+     */
+    template <typename Visitor>
+    void for_each(Visitor &&visit)
+    {
+        for (auto &s : shards_)
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            for (auto const &entry : s.boards)
+            {
+                visit(entry.first, entry.second.board, entry.second.canonical);
+            }
+        }
+    }
+
+    std::size_t size()
+    {
+        std::size_t n = 0;
+        for (auto &s : shards_)
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            n += s.boards.size();
+        }
+        return n;
+    }
+
+    /**
+     * @brief Number of distinct boards that shared a fingerprint with another.
+     *
+     */
+    inline unsigned long long collisions() const
+    {
+        return n_collisions_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct entry
+    {
+        packed_board board;
+        uint64_t canonical;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) shard
+    {
+        std::mutex mutex;
+        std::pmr::unsynchronized_pool_resource arena;
+        std::pmr::unordered_multimap<uint64_t, entry> boards{&arena};
+    };
+
+    /**
+     * @brief Hash of a board's `canonical_form()`, never `UNKNOWN`.
+     *
+     */
+    static uint64_t canonical_hash(sudoku::board_t const &board)
+    {
+        uint64_t const h = static_cast<uint64_t>(packed_board::pack(canonical_form(board)).hash());
+        return h == UNKNOWN ? 1 : h;
+    }
+
+    std::array<shard, SHARDS> shards_;
+    std::atomic<unsigned long long> n_collisions_{0};
+};
+
+#endif // __DEDUP_SET_HPP__
@@ -0,0 +1,278 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __DIGGER_HPP__
+#define __DIGGER_HPP__
+
+#include <array>
+#include <atomic>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief Counters on how much digging work was done and skipped.
+ *
+ * Shared between a digger and whoever reports on it; only the digger writes.
+ */
+struct dig_stats
+{
+    std::atomic<unsigned long long> n_grids{0};
+    std::atomic<unsigned long long> n_abandoned{0};
+    std::atomic<unsigned long long> n_cells_skipped{0};
+    std::atomic<unsigned long long> n_failed_removals{0};
+};
+
+/**
+ * @brief Clears cells of a Sudoku with one clear solution while keeping the solution unique.
+ *
+ * Instead of counting the solutions after each removal, the digger takes
+ * advantage of the solution being known: if the board was unique before a
+ * cell was cleared, any other solution must differ in that very cell. So
+ * putting each of the cell's other candidates in turn and looking for a
+ * single solution suffices.
+ *
+ * A digger is meant to live as long as its generator thread and be reused
+ * for every board.
+ *
+ * Digging stops as soon as fewer cells are left to try than still need
+ * to be cleared. With pruning enabled (see `set_pruning()`), the digger also learns how many
+ * failed removals the grids that reached their target had along the way,
+ * and abandons a grid once it fails more often than 99 % of those did.
+ * To keep that estimate honest, every `PROBE_INTERVAL`-th grid is dug
+ * without pruning, and only such grids feed the statistics.
+ *
+ * Works on boards of any size (see `basic_sudoku`); `digger` digs 9x9 ones.
+ */
+template <unsigned int N>
+class basic_digger
+{
+public:
+    typedef basic_sudoku<N> game_t;
+    typedef typename game_t::board_t board_t;
+    typedef typename game_t::mask_t mask_t;
+
+    static constexpr unsigned int PROBE_INTERVAL = 16;
+    static constexpr unsigned int MIN_SAMPLES = 64;
+
+    explicit basic_digger(sudoku_base::search_mode mode = sudoku_base::search_mode::mrv)
+    {
+        game_.set_search_mode(mode);
+    }
+
+    /**
+     * @brief Abandon grids that likely won't reach their target, judging from earlier ones; off by default.
+     *
+     * Measurements so far show no clear gain over the bound check alone,
+     * which is always on.
+     */
+    inline void set_pruning(bool enabled)
+    {
+        pruning_ = enabled;
+    }
+
+    /**
+     * @brief Abort the uniqueness checks when `flag` is set.
+     *
+     * Boards dug while the flag is set must be discarded.
+     */
+    inline void set_abort_flag(std::atomic<bool> const *flag)
+    {
+        game_.set_abort_flag(flag);
+    }
+
+    /**
+     * @brief Limit the nodes each uniqueness check may visit (see `basic_sudoku::set_node_limit()`).
+     *
+     * A check that hits the limit counts as if it had found another
+     * solution, so the cell stays filled and the board stays unique.
+     *
+     * @param limit the number of nodes, or 0 for no limit
+     */
+    inline void set_node_limit(uint64_t limit)
+    {
+        node_limit_ = limit;
+    }
+
+    /**
+     * @brief Count grids and skipped work in `stats`, if not null.
+     *
+     */
+    inline void set_stats(dig_stats *stats)
+    {
+        stats_ = stats;
+    }
+
+    /**
+     * @brief Get the solver work done since the last call (see `sudoku::take_counters()`).
+     *
+     */
+    inline sudoku_base::search_counters take_counters()
+    {
+        return game_.take_counters();
+    }
+
+    /**
+     * @brief Start digging on a new board.
+     *
+     * @param board a board with one clear solution, usually a fully solved one
+     */
+    inline void start(board_t const &board)
+    {
+        game_.assign(board);
+    }
+
+    /**
+     * @brief Try to clear a cell.
+     *
+     * @param idx index of the cell to clear
+     * @return true if the cell has been cleared and the board still has one clear solution
+     * @return false if the cell had to be restored (or was empty in the first place)
+     */
+    bool try_clear(unsigned int idx)
+    {
+        char const digit = game_.at(idx);
+        if (digit == game_t::EMPTY)
+        {
+            return false;
+        }
+        game_.set(idx, game_t::EMPTY);
+        mask_t others = static_cast<mask_t>(game_.candidates(idx) & ~game_t::bit(digit));
+        while (others != 0)
+        {
+            game_.set(idx, game_t::digit(static_cast<unsigned int>(std::countr_zero(others))));
+            if (node_limit_ != 0)
+            {
+                game_.set_node_limit(node_limit_);
+            }
+            if (game_.has_solution())
+            {
+                game_.set(idx, digit);
+                return false;
+            }
+            others &= static_cast<mask_t>(others - 1);
+        }
+        game_.set(idx, game_t::EMPTY);
+        return true;
+    }
+
+    /**
+     * @brief Clear cells in the given order until enough are empty.
+     *
+     * @param order indexes of the cells to try
+     * @param empty_cells number of cells to clear
+     * @return int number of cells which could not be cleared, 0 on success
+     */
+    template <typename Container>
+    int dig(Container const &order, int empty_cells)
+    {
+        bool const probe = ++n_grids_ % PROBE_INTERVAL == 0 || n_samples_ < MIN_SAMPLES;
+        int const budget = pruning_ && !probe ? failure_budget_ : static_cast<int>(game_t::CELLS);
+        int cells_left = static_cast<int>(order.size());
+        int failures = 0;
+        for (auto it = order.begin(); empty_cells > 0 && it != order.end(); ++it)
+        {
+            if (cells_left < empty_cells || failures > budget)
+            {
+                // the target is out of reach or, judging from earlier grids, unlikely
+                if (stats_ != nullptr)
+                {
+                    stats_->n_abandoned.fetch_add(1, std::memory_order_relaxed);
+                    stats_->n_cells_skipped.fetch_add(static_cast<unsigned long long>(cells_left), std::memory_order_relaxed);
+                }
+                break;
+            }
+            --cells_left;
+            if (game_.at(*it) == game_t::EMPTY)
+            {
+                continue;
+            }
+            if (try_clear(*it))
+            {
+                --empty_cells;
+            }
+            else
+            {
+                ++failures;
+            }
+        }
+        if (stats_ != nullptr)
+        {
+            stats_->n_grids.fetch_add(1, std::memory_order_relaxed);
+            stats_->n_failed_removals.fetch_add(static_cast<unsigned long long>(failures), std::memory_order_relaxed);
+        }
+        if (probe && empty_cells == 0)
+        {
+            learn(failures);
+        }
+        return empty_cells;
+    }
+
+    /**
+     * @brief Get the board dug out so far.
+     *
+     * @return board_t const&
+     */
+    inline board_t const &board() const
+    {
+        return game_.board();
+    }
+
+    inline game_t const &game() const
+    {
+        return game_;
+    }
+
+private:
+    /**
+     * @brief Record the failures of a grid that reached its target, and update the budget.
+     *
+     */
+    void learn(int failures)
+    {
+        ++failures_seen_[static_cast<std::size_t>(failures)];
+        ++n_samples_;
+        unsigned int const quantile = n_samples_ - n_samples_ / 100;
+        unsigned int n = 0;
+        for (std::size_t f = 0; f < failures_seen_.size(); ++f)
+        {
+            n += failures_seen_[f];
+            if (n >= quantile)
+            {
+                failure_budget_ = static_cast<int>(f);
+                break;
+            }
+        }
+    }
+
+    game_t game_;
+    bool pruning_{false};
+    dig_stats *stats_{nullptr};
+    uint64_t node_limit_{0};
+    unsigned long long n_grids_{0};
+    unsigned int n_samples_{0};
+    int failure_budget_{static_cast<int>(game_t::CELLS)};
+    std::array<unsigned int, game_t::CELLS + 1> failures_seen_{};
+};
+
+typedef basic_digger<3> digger;
+
+#endif // __DIGGER_HPP__
@@ -0,0 +1,339 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __DLX_HPP__
+#define __DLX_HPP__
+
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Sudoku solver based on Knuth's Algorithm X with Dancing Links.
+ *
+ * The Sudoku is modelled as an exact-cover problem with 729 rows (one per
+ * digit per cell) and 324 columns (cell, row-digit, column-digit and
+ * box-digit constraints). The matrix is built once, and a search covers
+ * the givens' rows only to uncover them afterwards, so the links are
+ * pristine again after every call. Thus one instance can be reused for
+ * any number of boards without allocating. Use `dlx::local()` to get the
+ * instance belonging to the calling thread.
+ */
+class dlx
+{
+public:
+    typedef std::array<char, 81> board_t;
+
+    dlx()
+    {
+        build();
+    }
+
+    dlx(dlx const &) = delete;
+    dlx &operator=(dlx const &) = delete;
+
+    /**
+     * @brief Get the solver instance of the calling thread.
+     *
+     * @return dlx&
+     */
+    static dlx &local()
+    {
+        thread_local dlx instance;
+        return instance;
+    }
+
+    /**
+     * @brief Get the thread's instance for streaming enumerations.
+     *
+     * `sudoku::solve()` enumerates with this instance, so that its visitor
+     * can run checks on `local()` while the enumeration is suspended.
+     *
+     * @return dlx&
+     */
+    static dlx &local_enumerator()
+    {
+        thread_local dlx instance;
+        return instance;
+    }
+
+    /**
+     * @brief Search for solutions of a board.
+     *
+     * @param board the board, with '1' to '9' for givens and anything else for empty cells
+     * @param limit stop after this many solutions
+     * @param on_solution called with every solution found as `bool(board_t const &)`;
+     *        return false to stop the search
+     * @return int number of solutions found, at most `limit`
+     */
+    template <typename Visitor>
+    int search(board_t const &board, int limit, Visitor &&on_solution)
+    {
+        unsigned int n_given = 0;
+        bool consistent = true;
+        for (unsigned int i = 0; i < 81U; ++i)
+        {
+            if (board[i] < '1' || board[i] > '9')
+            {
+                continue;
+            }
+            uint16_t const row = static_cast<uint16_t>(i * 9 + static_cast<unsigned int>(board[i] - '1'));
+            if (!select(row))
+            {
+                consistent = false;
+                break;
+            }
+            given_[n_given++] = row;
+        }
+        found_ = 0;
+        limit_ = limit;
+        board_ = &board;
+        if (consistent)
+        {
+            search(0, on_solution);
+        }
+        while (n_given > 0)
+        {
+            unselect(given_[--n_given]);
+        }
+        return found_;
+    }
+
+    /**
+     * @brief Count solutions of a board.
+     *
+     * @param board the board to solve
+     * @param limit stop counting when this number is reached
+     * @return int number of solutions found, at most `limit`
+     */
+    inline int count(board_t const &board, int limit)
+    {
+        return search(board, limit, [](board_t const &)
+                      { return true; });
+    }
+
+    /**
+     * @brief Find the first solution of a board.
+     *
+     * @param[in,out] board the board to solve, replaced by its solution if there's one
+     * @return true if a solution has been found
+     * @return false otherwise
+     */
+    inline bool solve_single(board_t &board)
+    {
+        board_t solution;
+        if (search(board, 1, [&solution](board_t const &b)
+                   { solution = b; return true; }) == 0)
+        {
+            return false;
+        }
+        board = solution;
+        return true;
+    }
+
+private:
+    static constexpr unsigned int N_COLUMNS = 4U * 81U;
+    static constexpr unsigned int N_ROWS = 9U * 81U;
+    static constexpr unsigned int N_NODES = 1U + N_COLUMNS + 4U * N_ROWS;
+    static constexpr uint16_t ROOT = 0;
+
+    struct node
+    {
+        uint16_t left;
+        uint16_t right;
+        uint16_t up;
+        uint16_t down;
+        uint16_t column;
+        uint16_t row;
+    };
+
+    void build()
+    {
+        for (uint16_t c = 0; c <= N_COLUMNS; ++c)
+        {
+            node &n = nodes_[c];
+            n.left = static_cast<uint16_t>(c == 0 ? N_COLUMNS : c - 1);
+            n.right = static_cast<uint16_t>(c == N_COLUMNS ? 0 : c + 1);
+            n.up = c;
+            n.down = c;
+            n.column = c;
+            n.row = 0;
+            size_[c] = 0;
+        }
+        uint16_t next = static_cast<uint16_t>(N_COLUMNS + 1);
+        for (unsigned int r = 0; r < N_ROWS; ++r)
+        {
+            unsigned int const cell = r / 9;
+            unsigned int const digit = r % 9;
+            unsigned int const row = cell / 9;
+            unsigned int const col = cell % 9;
+            unsigned int const box = (row / 3) * 3 + col / 3;
+            std::array<unsigned int, 4> const columns{
+                1 + cell,
+                1 + 81 + row * 9 + digit,
+                1 + 162 + col * 9 + digit,
+                1 + 243 + box * 9 + digit};
+            uint16_t const first = next;
+            for (unsigned int k = 0; k < 4; ++k)
+            {
+                uint16_t const idx = next++;
+                uint16_t const c = static_cast<uint16_t>(columns[k]);
+                node &n = nodes_[idx];
+                n.left = static_cast<uint16_t>(k == 0 ? first + 3 : idx - 1);
+                n.right = static_cast<uint16_t>(k == 3 ? first : idx + 1);
+                n.column = c;
+                n.row = static_cast<uint16_t>(r);
+                n.up = nodes_[c].up;
+                n.down = c;
+                nodes_[nodes_[c].up].down = idx;
+                nodes_[c].up = idx;
+                ++size_[c];
+            }
+            row_first_[r] = first;
+        }
+    }
+
+    inline void cover(uint16_t c)
+    {
+        nodes_[nodes_[c].right].left = nodes_[c].left;
+        nodes_[nodes_[c].left].right = nodes_[c].right;
+        for (uint16_t i = nodes_[c].down; i != c; i = nodes_[i].down)
+        {
+            for (uint16_t j = nodes_[i].right; j != i; j = nodes_[j].right)
+            {
+                nodes_[nodes_[j].down].up = nodes_[j].up;
+                nodes_[nodes_[j].up].down = nodes_[j].down;
+                --size_[nodes_[j].column];
+            }
+        }
+    }
+
+    inline void uncover(uint16_t c)
+    {
+        for (uint16_t i = nodes_[c].up; i != c; i = nodes_[i].up)
+        {
+            for (uint16_t j = nodes_[i].left; j != i; j = nodes_[j].left)
+            {
+                ++size_[nodes_[j].column];
+                nodes_[nodes_[j].down].up = j;
+                nodes_[nodes_[j].up].down = j;
+            }
+        }
+        nodes_[nodes_[c].right].left = c;
+        nodes_[nodes_[c].left].right = c;
+    }
+
+    /**
+     * @brief Take a given's row into the partial solution.
+     *
+     * @param row the row to select
+     * @return false if the given clashes with an earlier one, true otherwise
+     */
+    bool select(uint16_t row)
+    {
+        uint16_t const first = row_first_[row];
+        uint16_t j = first;
+        do
+        {
+            uint16_t const c = nodes_[j].column;
+            if (nodes_[nodes_[c].right].left != c)
+            {
+                // column already covered by another given
+                return false;
+            }
+            j = nodes_[j].right;
+        } while (j != first);
+        cover(nodes_[first].column);
+        for (j = nodes_[first].right; j != first; j = nodes_[j].right)
+        {
+            cover(nodes_[j].column);
+        }
+        return true;
+    }
+
+    void unselect(uint16_t row)
+    {
+        uint16_t const first = row_first_[row];
+        for (uint16_t j = nodes_[first].left; j != first; j = nodes_[j].left)
+        {
+            uncover(nodes_[j].column);
+        }
+        uncover(nodes_[first].column);
+    }
+
+    template <typename Visitor>
+    void search(unsigned int depth, Visitor &on_solution)
+    {
+        if (nodes_[ROOT].right == ROOT)
+        {
+            board_t solution = *board_;
+            for (unsigned int k = 0; k < depth; ++k)
+            {
+                solution[chosen_[k] / 9] = static_cast<char>('1' + chosen_[k] % 9);
+            }
+            ++found_;
+            if (!on_solution(solution))
+            {
+                limit_ = found_;
+            }
+            return;
+        }
+        // choose the column with the fewest rows left
+        uint16_t c = nodes_[ROOT].right;
+        for (uint16_t j = nodes_[c].right; j != ROOT && size_[c] > 1; j = nodes_[j].right)
+        {
+            if (size_[j] < size_[c])
+            {
+                c = j;
+            }
+        }
+        if (size_[c] == 0)
+        {
+            return;
+        }
+        cover(c);
+        for (uint16_t r = nodes_[c].down; r != c && found_ < limit_; r = nodes_[r].down)
+        {
+            chosen_[depth] = nodes_[r].row;
+            for (uint16_t j = nodes_[r].right; j != r; j = nodes_[j].right)
+            {
+                cover(nodes_[j].column);
+            }
+            search(depth + 1, on_solution);
+            for (uint16_t j = nodes_[r].left; j != r; j = nodes_[j].left)
+            {
+                uncover(nodes_[j].column);
+            }
+        }
+        uncover(c);
+    }
+
+    std::array<node, N_NODES> nodes_;
+    std::array<uint16_t, N_COLUMNS + 1> size_;
+    std::array<uint16_t, N_ROWS> row_first_;
+    std::array<uint16_t, 81> chosen_;
+    std::array<uint16_t, 81> given_;
+    board_t const *board_{nullptr};
+    int found_{0};
+    int limit_{0};
+};
+
+#endif // __DLX_HPP__
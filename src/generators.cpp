@@ -0,0 +1,353 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+#include "algorithm_mix.hpp"
+#include "alloc_counter.hpp"
+#include "digger.hpp"
+#include "generators.hpp"
+#include "logging.hpp"
+
+std::unordered_map<std::string, algorithm_t> const ALGORITHMS = {
+    {"prefill", {&prefill_generator_thread, 1}},
+    {"prefill-single", {&prefill_single_generator_thread, 2}},
+    {"mincheck", {&mincheck_generator_thread, 3}},
+    {"incremental-fill", {&incremental_fill_generator_thread, 4}},
+    {"grid-pool", {&grid_pool_generator_thread, 5, true}},
+    {"adaptive", {&adaptive_generator_thread, 6, false, true}}};
+
+namespace
+{
+    inline void push_board(board_queue &queue, found_board const &result)
+    {
+        while (!queue.try_push(result))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Hand a board over to the writer thread.
+     *
+     * Never blocks on other generator threads, only waits if the writer lags
+     * so far behind that the thread's own queue is full. Valid boards rated
+     * too easy, or that duplicate an earlier one, are dropped if the sink
+     * is set up to do so.
+     * Variants made by `--expand` are equivalent to the original by
+     * construction, so they bypass deduplication.
+     */
+    void deliver(board_sink &sink, sudoku::board_t const &board, int empty_cells, bool complete)
+    {
+        if (sink.abort != nullptr && sink.abort->load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        // the first board pays for the thread's setup, the ones after it are the steady state
+        uint64_t const n_allocs = alloc_counter::thread_allocations();
+        if (sink.counting_allocs)
+        {
+            perf_counters::add(sink.perf.n_allocs, n_allocs - sink.alloc_mark);
+        }
+        sink.counting_allocs = true;
+        sink.alloc_mark = n_allocs;
+        perf_counters::add(sink.perf.n_games, 1);
+        if (!complete)
+        {
+            perf_counters::add(sink.perf.n_discarded, 1);
+        }
+        if (complete && sink.min_rating > 0 && sink.rater.grade(board).rating < sink.min_rating)
+        {
+            sink.n_too_easy.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (complete && sink.seen != nullptr && !sink.seen->insert(board))
+        {
+            sink.n_duplicates.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        push_board(sink.queue, found_board{packed_board::pack(board), empty_cells, complete, sink.generator_id});
+        if (complete)
+        {
+            auto const now = std::chrono::steady_clock::now();
+            sink.valid_micros.record(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - sink.last_valid).count()));
+            sink.last_valid = now;
+            perf_counters::add(sink.perf.n_valid, 1 + sink.expand);
+            perf_counters::add(sink.perf.n_games, sink.expand);
+            for (unsigned int i = 0; i < sink.expand; ++i)
+            {
+                sudoku::board_t const variant = symmetry::random(*sink.rng).apply(board);
+                push_board(sink.queue, found_board{packed_board::pack(variant), empty_cells, true, sink.generator_id});
+            }
+        }
+    }
+}
+
+/**
+ * @brief Hand a board over to the writer thread (see `deliver()`), then pause if the sink's `pause_gate` asks to.
+ *
+ */
+void board_found(board_sink &sink, sudoku::board_t const &board, int empty_cells, bool complete)
+{
+    deliver(sink, board, empty_cells, complete);
+    if (sink.gate != nullptr && sink.gate->requested())
+    {
+        sink.gate->wait(sink.abort);
+    }
+}
+
+void incremental_fill_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running)
+{
+    sudoku game(rng);
+    game.set_search_mode(search);
+    game.set_abort_flag(sink.abort);
+    digger dig(search);
+    dig.set_abort_flag(sink.abort);
+    dig.set_pruning(sink.prune);
+    dig.set_stats(&sink.dig);
+    std::array<unsigned int, 81U> unvisited;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        unvisited[i] = i;
+    }
+    phase_clock clock(sink.perf);
+    while (running.load(std::memory_order_relaxed))
+    {
+        game.random_fill();
+        clock.lap(perf_counters::prefill);
+        logging::message(logging::verbose) << "Trying ...\n"
+                                           << game << "\n";
+        // visit cells in random order until all are visited
+        // or the desired amount of empty cells is reached
+        std::shuffle(unvisited.begin(), unvisited.end(), rng);
+        dig.start(game.board());
+        int const empty_cells = dig.dig(unvisited, std::max(0, difficulty - game.empty_count()));
+        const bool complete = empty_cells == 0;
+        clock.lap(perf_counters::dig);
+        board_found(sink, dig.board(), empty_cells, complete);
+        sink.perf.add(game.take_counters());
+        sink.perf.add(dig.take_counters());
+        game.reset();
+        clock.lap(perf_counters::output);
+    }
+}
+
+/**
+ * @brief This Sudoku generator produces valid minimal boards with the specified number of empty cells.
+ *
+ * Each board is then checked if it has one clear solution. If there's no clear solution, the process repeats.
+ */
+void mincheck_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running)
+{
+    sudoku game(rng);
+    game.set_search_mode(search);
+    game.set_abort_flag(sink.abort);
+    std::array<unsigned int, 81U> unvisited;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        unvisited[i] = i;
+    }
+    phase_clock clock(sink.perf);
+    while (running.load(std::memory_order_relaxed))
+    {
+        std::shuffle(unvisited.begin(), unvisited.end(), rng);
+        unsigned int unvisited_idx = 0;
+        int num_placed = 81 - difficulty;
+        while (num_placed > 0)
+        {
+            unsigned int visit_idx = unvisited.at(unvisited_idx);
+            char num = '1' + static_cast<char>(rng() % 9);
+            if (game.is_safe(visit_idx, num))
+            {
+                game.set(visit_idx, num);
+                --num_placed;
+            }
+            ++unvisited_idx;
+            if (unvisited_idx == 81)
+            {
+                unvisited_idx = 0;
+                std::shuffle(unvisited.begin(), unvisited.end(), rng);
+            }
+        }
+        clock.lap(perf_counters::prefill);
+        bool const complete = game.has_one_clear_solution();
+        clock.lap(perf_counters::solve);
+        board_found(sink, game.board(), 0, complete);
+        sink.perf.add(game.take_counters());
+        game.reset();
+        clock.lap(perf_counters::output);
+    }
+}
+
+/**
+ * @brief This Sudoku generator fills three independent 3x3 blocks with random numbers.
+ *
+ * The board is then solved. For each solution the generator tries to clear as many cells as required by the difficulty level.
+ * If enough cells could be cleared the board is valid, otherwise disposed of.
+ */
+void prefill_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running)
+{
+    sudoku game(rng);
+    game.set_search_mode(search);
+    game.set_abort_flag(sink.abort);
+    digger dig(search);
+    dig.set_abort_flag(sink.abort);
+    dig.set_pruning(sink.prune);
+    dig.set_stats(&sink.dig);
+    std::array<unsigned int, 81U> unvisited;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        unvisited[i] = i;
+    }
+    phase_clock clock(sink.perf);
+    while (running.load(std::memory_order_relaxed))
+    {
+        prefill_diagonal(game);
+        clock.lap(perf_counters::prefill);
+        // dig out each solution as soon as it's found
+        long long n_solutions = 0;
+        game.solve([&](sudoku::board_t const &board)
+                   {
+            ++n_solutions;
+            clock.lap(perf_counters::solve);
+            if (logging::enabled(logging::verbose))
+            {
+                // boards only print as part of a `sudoku`
+                logging::message(logging::verbose) << "Trying ...\n"
+                                                   << sudoku(board) << "\n";
+            }
+            // visit cells in random order until all are visited
+            // or the desired amount of empty cells is reached
+            std::shuffle(unvisited.begin(), unvisited.end(), rng);
+            dig.start(board);
+            int const empty_cells = dig.dig(unvisited, difficulty);
+            const bool complete = empty_cells == 0;
+            clock.lap(perf_counters::dig);
+            board_found(sink, dig.board(), empty_cells, complete);
+            sink.perf.add(dig.take_counters());
+            clock.lap(perf_counters::output);
+            return running.load(std::memory_order_relaxed); });
+        clock.lap(perf_counters::solve);
+        logging::message(logging::verbose) << "# solutions: " << n_solutions << "\n\n";
+        sink.perf.add(game.take_counters());
+        game.reset();
+    }
+}
+
+/**
+ * @brief This Sudoku generator fills three independent 3x3 blocks with random numbers.
+ *
+ * The board is then solved. For the first solution the generator tries to clear as many cells as required by the difficulty level.
+ * If enough cells could be cleared the board is valid, otherwise disposed of.
+ */
+void prefill_single_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running)
+{
+    sudoku game(rng);
+    game.set_search_mode(search);
+    game.set_abort_flag(sink.abort);
+    digger dig(search);
+    dig.set_abort_flag(sink.abort);
+    dig.set_pruning(sink.prune);
+    dig.set_stats(&sink.dig);
+    std::array<unsigned int, 81U> unvisited;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        unvisited[i] = i;
+    }
+    phase_clock clock(sink.perf);
+    while (running.load(std::memory_order_relaxed))
+    {
+        prefill_diagonal(game);
+        clock.lap(perf_counters::prefill);
+        // generate first solution
+        game.solve_single();
+        clock.lap(perf_counters::solve);
+        logging::message(logging::verbose) << "Trying ...\n"
+                                           << game << '\n';
+
+        // visit cells in random order until all are visited
+        // or the desired amount of empty cells is reached
+        std::shuffle(unvisited.begin(), unvisited.end(), rng);
+        dig.start(game.board());
+        int const empty_cells = dig.dig(unvisited, difficulty);
+        const bool complete = empty_cells == 0;
+        clock.lap(perf_counters::dig);
+        board_found(sink, dig.board(), empty_cells, complete);
+        sink.perf.add(game.take_counters());
+        sink.perf.add(dig.take_counters());
+        game.reset();
+        clock.lap(perf_counters::output);
+    }
+}
+
+/**
+ * @brief This Sudoku generator digs puzzles out of solved grids taken from a `grid_pool`.
+ *
+ * Each grid is dug out several times, each time clearing cells in a different random order.
+ */
+void grid_pool_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running)
+{
+    digger dig(search);
+    dig.set_abort_flag(sink.abort);
+    dig.set_pruning(sink.prune);
+    dig.set_stats(&sink.dig);
+    std::array<unsigned int, 81U> unvisited;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        unvisited[i] = i;
+    }
+    sudoku::board_t grid;
+    phase_clock clock(sink.perf);
+    while (running.load(std::memory_order_relaxed) && sink.pool->take(grid, running))
+    {
+        // waiting for the pool counts as solving, as that's what the producers do meanwhile
+        clock.lap(perf_counters::solve);
+        for (unsigned int i = 0; i < sink.digs_per_grid && running.load(std::memory_order_relaxed); ++i)
+        {
+            std::shuffle(unvisited.begin(), unvisited.end(), rng);
+            dig.start(grid);
+            int const empty_cells = dig.dig(unvisited, difficulty);
+            clock.lap(perf_counters::dig);
+            board_found(sink, dig.board(), empty_cells, empty_cells == 0);
+            sink.perf.add(dig.take_counters());
+            clock.lap(perf_counters::output);
+        }
+    }
+}
+
+/**
+ * @brief This Sudoku generator runs whichever of the other generators its sink's `algorithm_mix` assigns it to.
+ *
+ * When the assignment changes, the generator running returns after its
+ * current board, and the one assigned now starts.
+ */
+void adaptive_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running)
+{
+    while (running.load(std::memory_order_relaxed))
+    {
+        algorithm_t const &algorithm = sink.mix->start(sink.mix_slot);
+        sink.generator_id = algorithm.id;
+        algorithm.generator(difficulty, search, rng, sink, sink.mix->running(sink.mix_slot));
+    }
+}
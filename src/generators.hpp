@@ -0,0 +1,326 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __GENERATORS_HPP__
+#define __GENERATORS_HPP__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dedup_set.hpp"
+#include "digger.hpp"
+#include "grader.hpp"
+#include "grid_pool.hpp"
+#include "packed_board.hpp"
+#include "perf_counters.hpp"
+#include "spsc_queue.hpp"
+#include "sudoku.hpp"
+#include "symmetry.hpp"
+
+class algorithm_mix;
+
+/**
+ * @brief A board produced by a generator thread, waiting to be written.
+ *
+ */
+struct found_board
+{
+    packed_board board;
+    int empty_cells;
+    bool complete;
+    /**
+     * @brief The id of the algorithm that produced the board (see `algorithm_t`).
+     *
+     */
+    uint8_t generator;
+};
+
+typedef spsc_queue<found_board, 256> board_queue;
+
+/**
+ * @brief Holds the generator threads between two boards, e.g. while a checkpoint is taken.
+ *
+ * Once `request()` has been called, each generator thread waits in
+ * `board_found()` right after handing over its board, until `release()`
+ * is called or the run is aborted. Checking for a request costs one
+ * relaxed load per board.
+ */
+class pause_gate
+{
+public:
+    inline bool requested() const
+    {
+        return requested_.load(std::memory_order_relaxed);
+    }
+
+    inline void request()
+    {
+        requested_.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wait for `release()`, or until `abort` is set.
+     *
+     */
+    void wait(std::atomic<bool> const *abort)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++n_waiting_;
+        while (requested_.load(std::memory_order_relaxed) && (abort == nullptr || !abort->load(std::memory_order_relaxed)))
+        {
+            // the abort flag doesn't notify, so look at it now and then
+            released_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        --n_waiting_;
+    }
+
+    /**
+     * @brief Number of threads waiting.
+     *
+     * Once all generator threads are waiting, whatever they did before is
+     * visible to the calling thread.
+     */
+    inline unsigned int waiting()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return n_waiting_;
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requested_.store(false, std::memory_order_relaxed);
+        }
+        released_.notify_all();
+    }
+
+private:
+    std::atomic<bool> requested_{false};
+    std::mutex mutex_;
+    std::condition_variable released_;
+    unsigned int n_waiting_{0};
+};
+
+/**
+ * @brief Where a generator thread delivers its boards.
+ *
+ * Each generator thread owns one sink. If `seen` is set, valid boards
+ * equivalent to one delivered before (see `dedup_set`) are dropped and
+ * counted in `n_duplicates` instead of being queued. Each valid board
+ * that's queued is followed by `expand` randomly transformed variants
+ * (see `symmetry`), drawn from `rng`. If `min_rating` is positive, valid
+ * boards that `rater` grades below it are counted in `n_too_easy` and
+ * dropped before anything else. The generator's digger counts its work
+ * in `dig`, pruning hopeless grids if `prune` is set (see `digger`).
+ * Generators that dig grids from a `grid_pool` take them from `pool`
+ * and try `digs_per_grid` removal orders on each.
+ *
+ * The generator stamps the boards with `generator_id`. In an adaptive run
+ * it takes the algorithm to run from slot `mix_slot` of `mix`.
+ *
+ * Once `abort` is set the solvers stop early, so boards delivered after
+ * that can't be trusted and are dropped. If `gate` is set, the thread
+ * pauses there after delivering a board whenever it's requested to.
+ *
+ * The generator thread itself counts the boards it delivers, what it
+ * spends its time on, and the heap allocations it makes once it has
+ * delivered its first board, in `perf`, which can be read while it's
+ * running. The time it took to find each valid board goes to
+ * `valid_micros`, which is only to be read after the thread has finished.
+ *
+ * `rng` usually points to `thread_rng`, which sits on a cache line of its
+ * own, so drawing numbers doesn't slow down other threads.
+ */
+struct board_sink
+{
+    board_queue queue;
+    dedup_set *seen{nullptr};
+    std::atomic<unsigned long long> n_duplicates{0};
+    unsigned int expand{0};
+    sudoku::rng_t *rng{nullptr};
+    double min_rating{0};
+    grader rater;
+    std::atomic<unsigned long long> n_too_easy{0};
+    bool prune{false};
+    dig_stats dig;
+    grid_pool *pool{nullptr};
+    unsigned int digs_per_grid{8};
+    std::atomic<bool> const *abort{nullptr};
+    pause_gate *gate{nullptr};
+    uint8_t generator_id{0};
+    algorithm_mix *mix{nullptr};
+    unsigned int mix_slot{0};
+    std::chrono::steady_clock::time_point last_valid{std::chrono::steady_clock::now()};
+    latency_histogram valid_micros;
+    uint64_t alloc_mark{0};
+    bool counting_allocs{false};
+    perf_counters perf;
+    alignas(CACHE_LINE_SIZE) sudoku::rng_t thread_rng;
+};
+
+/**
+ * @brief Signature of a generator thread.
+ *
+ * A generator thread delivers the boards it produces to its sink until `running` is cleared.
+ */
+typedef std::function<void(int, sudoku::search_mode, sudoku::rng_t &, board_sink &, std::atomic<bool> const &)> generator_thread_t;
+
+/**
+ * @brief A generator and the id that tags its boards in binary corpus files.
+ *
+ * `adaptive` generators run other generators, as told by the sink's `algorithm_mix`.
+ */
+struct algorithm_t
+{
+    generator_thread_t generator;
+    uint8_t id;
+    bool uses_pool{false};
+    bool adaptive{false};
+};
+
+/**
+ * @brief All generators, by the name used to select them on the command line.
+ *
+ */
+extern std::unordered_map<std::string, algorithm_t> const ALGORITHMS;
+
+/**
+ * @brief Fill the boxes on the main diagonal with random digits.
+ *
+ * The boxes don't share rows or columns, so any filling is valid and
+ * can be completed to a solved grid.
+ */
+template <unsigned int N>
+void prefill_diagonal(basic_sudoku<N> &game)
+{
+    constexpr unsigned int SIZE = basic_sudoku<N>::SIZE;
+    for (unsigned int box = 0; box < N; ++box)
+    {
+        unsigned int num_idx = 0;
+        for (unsigned int row = box * N; row < (box + 1) * N; ++row)
+        {
+            for (unsigned int col = box * N; col < (box + 1) * N; ++col)
+            {
+                game.set(row * SIZE + col, game.guess_num(num_idx++));
+            }
+        }
+        game.shuffle_guesses();
+    }
+}
+
+/**
+ * @brief Where the generator threads for boards other than 9x9 deliver their boards.
+ *
+ * Such boards aren't graded, deduplicated or expanded; valid ones are
+ * written to `out` as one line each, under `mutex`, until `max_valid`
+ * (if not 0) have been written. Games finished after that aren't counted
+ * in `n_games`.
+ */
+struct sized_sink
+{
+    std::mutex mutex;
+    std::ostream *out{nullptr};
+    std::atomic<unsigned long long> n_games{0};
+    std::atomic<unsigned long long> n_valid{0};
+    unsigned long long max_valid{0};
+    std::atomic<bool> const *abort{nullptr};
+};
+
+/**
+ * @brief Generator for boards of any size, working like `prefill_single_generator_thread`.
+ *
+ * Solving and each uniqueness check give up after `NODE_LIMIT` nodes;
+ * a grid that can't be solved that quickly is replaced by a new one.
+ */
+template <unsigned int N>
+void sized_generator_thread(int difficulty, sudoku_base::search_mode search, sudoku_base::rng_t &rng, sized_sink &sink, std::atomic<bool> const &running)
+{
+    typedef basic_sudoku<N> game_t;
+    static constexpr uint64_t NODE_LIMIT = 1000;
+    game_t game(rng);
+    game.set_search_mode(search);
+    game.set_abort_flag(sink.abort);
+    basic_digger<N> dig(search);
+    dig.set_abort_flag(sink.abort);
+    dig.set_node_limit(NODE_LIMIT);
+    std::array<unsigned int, game_t::CELLS> unvisited;
+    for (unsigned int i = 0; i < game_t::CELLS; ++i)
+    {
+        unvisited[i] = i;
+    }
+    while (running.load(std::memory_order_relaxed))
+    {
+        prefill_diagonal(game);
+        game.set_node_limit(NODE_LIMIT);
+        if (!game.solve_single())
+        {
+            game.reset();
+            continue;
+        }
+        std::shuffle(unvisited.begin(), unvisited.end(), rng);
+        dig.start(game.board());
+        int const empty_cells = dig.dig(unvisited, difficulty);
+        game.reset();
+        if (sink.abort != nullptr && sink.abort->load(std::memory_order_relaxed))
+        {
+            break;
+        }
+        if (sink.max_valid != 0 && sink.n_valid.load(std::memory_order_relaxed) >= sink.max_valid)
+        {
+            break;
+        }
+        sink.n_games.fetch_add(1, std::memory_order_relaxed);
+        if (empty_cells == 0)
+        {
+            auto const &board = dig.board();
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            if (sink.max_valid == 0 || sink.n_valid.load(std::memory_order_relaxed) < sink.max_valid)
+            {
+                sink.n_valid.fetch_add(1, std::memory_order_relaxed);
+                sink.out->write(board.data(), static_cast<std::streamsize>(board.size()));
+                sink.out->put('\n');
+            }
+        }
+    }
+}
+
+void board_found(board_sink &sink, sudoku::board_t const &board, int empty_cells, bool complete);
+
+void incremental_fill_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running);
+void mincheck_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running);
+void prefill_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running);
+void grid_pool_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running);
+void prefill_single_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running);
+void adaptive_generator_thread(int difficulty, sudoku::search_mode search, sudoku::rng_t &rng, board_sink &sink, std::atomic<bool> const &running);
+
+#endif // __GENERATORS_HPP__
@@ -0,0 +1,650 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <bit>
+
+#include "grader.hpp"
+#include "propagate.hpp"
+
+namespace
+{
+    struct unit_tables
+    {
+        /**
+         * @brief Cells of rows 0-8, columns 9-17 and boxes 18-26.
+         *
+         */
+        std::array<std::array<uint8_t, 9>, 27> units;
+        std::array<std::array<uint8_t, 20>, 81> peers;
+        std::array<std::array<bool, 81>, 81> sees;
+    };
+
+    constexpr unit_tables make_unit_tables()
+    {
+        unit_tables t{};
+        for (unsigned int i = 0; i < 9U; ++i)
+        {
+            for (unsigned int j = 0; j < 9U; ++j)
+            {
+                t.units[i][j] = static_cast<uint8_t>(i * 9 + j);
+                t.units[9 + i][j] = static_cast<uint8_t>(j * 9 + i);
+                t.units[18 + i][j] = static_cast<uint8_t>((i / 3 * 3 + j / 3) * 9 + i % 3 * 3 + j % 3);
+            }
+        }
+        for (unsigned int a = 0; a < 81U; ++a)
+        {
+            unsigned int n = 0;
+            for (unsigned int b = 0; b < 81U; ++b)
+            {
+                bool const peer = a != b &&
+                                  (a / 9 == b / 9 || a % 9 == b % 9 ||
+                                   (a / 27 == b / 27 && a % 9 / 3 == b % 9 / 3));
+                t.sees[a][b] = peer;
+                if (peer)
+                {
+                    t.peers[a][n++] = static_cast<uint8_t>(b);
+                }
+            }
+        }
+        return t;
+    }
+
+    constexpr unit_tables TABLES = make_unit_tables();
+
+    inline unsigned int box_of(unsigned int idx)
+    {
+        return idx / 27 * 3 + idx % 9 / 3;
+    }
+}
+
+char const *grader::name(technique t)
+{
+    switch (t)
+    {
+    case technique::none:
+        return "none";
+    case technique::hidden_single:
+        return "hidden single";
+    case technique::naked_single:
+        return "naked single";
+    case technique::pointing:
+        return "pointing";
+    case technique::claiming:
+        return "claiming";
+    case technique::naked_pair:
+        return "naked pair";
+    case technique::x_wing:
+        return "X-wing";
+    case technique::hidden_pair:
+        return "hidden pair";
+    case technique::naked_triple:
+        return "naked triple";
+    case technique::swordfish:
+        return "swordfish";
+    case technique::hidden_triple:
+        return "hidden triple";
+    case technique::xy_wing:
+        return "XY-wing";
+    case technique::xy_chain:
+        return "XY-chain";
+    case technique::unsolved:
+        break;
+    }
+    return "beyond XY-chains";
+}
+
+double grader::rating(technique t)
+{
+    static constexpr std::array<double, 14> RATINGS{
+        0.0, 1.5, 2.3, 2.6, 2.8, 3.0, 3.2, 3.4, 3.6, 3.8, 4.0, 4.2, 6.5, 10.0};
+    return RATINGS[static_cast<std::size_t>(t)];
+}
+
+grader::result grader::grade(sudoku::board_t const &board)
+{
+    std::array<uint16_t, 27> used{};
+    n_empty_ = 0;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        if (board[i] != sudoku::EMPTY)
+        {
+            uint16_t const bit = sudoku::bit(board[i]);
+            used[i / 9] |= bit;
+            used[9 + i % 9] |= bit;
+            used[18 + box_of(i)] |= bit;
+        }
+    }
+    propagate::scan_result scan;
+    propagate::scan(used.data(), used.data() + 9, used.data() + 18, board.data(), scan);
+    broken_ = scan.contradiction;
+    for (unsigned int i = 0; i < 81U; ++i)
+    {
+        if (board[i] == sudoku::EMPTY)
+        {
+            cand_[i] = scan.cand[i / 9][i % 9];
+            ++n_empty_;
+        }
+        else
+        {
+            cand_[i] = 0;
+        }
+    }
+    technique hardest = technique::none;
+    while (n_empty_ > 0 && !broken_)
+    {
+        bool progress = false;
+        for (auto t = static_cast<uint8_t>(technique::hidden_single); t < static_cast<uint8_t>(technique::unsolved); ++t)
+        {
+            if (apply(static_cast<technique>(t)))
+            {
+                hardest = std::max(hardest, static_cast<technique>(t));
+                progress = true;
+                break;
+            }
+        }
+        if (!progress)
+        {
+            break;
+        }
+    }
+    bool const solved = n_empty_ == 0 && !broken_;
+    if (!solved)
+    {
+        hardest = technique::unsolved;
+    }
+    return result{hardest, rating(hardest), solved};
+}
+
+bool grader::apply(technique t)
+{
+    switch (t)
+    {
+    case technique::hidden_single:
+        return hidden_singles();
+    case technique::naked_single:
+        return naked_singles();
+    case technique::pointing:
+        return pointing();
+    case technique::claiming:
+        return claiming();
+    case technique::naked_pair:
+        return naked_subset(2);
+    case technique::x_wing:
+        return fish(2);
+    case technique::hidden_pair:
+        return hidden_subset(2);
+    case technique::naked_triple:
+        return naked_subset(3);
+    case technique::swordfish:
+        return fish(3);
+    case technique::hidden_triple:
+        return hidden_subset(3);
+    case technique::xy_wing:
+        return xy_wing();
+    case technique::xy_chain:
+        return xy_chain();
+    default:
+        return false;
+    }
+}
+
+void grader::place(unsigned int idx, uint16_t bit)
+{
+    cand_[idx] = 0;
+    --n_empty_;
+    for (uint8_t p : TABLES.peers[idx])
+    {
+        if (cand_[p] & bit)
+        {
+            cand_[p] = static_cast<uint16_t>(cand_[p] & ~bit);
+            broken_ |= cand_[p] == 0;
+        }
+    }
+}
+
+/**
+ * @brief Remove candidates from an unsolved cell.
+ *
+ * @return true if any candidate was removed
+ */
+bool grader::eliminate(unsigned int idx, uint16_t bits)
+{
+    if ((cand_[idx] & bits) == 0)
+    {
+        return false;
+    }
+    cand_[idx] = static_cast<uint16_t>(cand_[idx] & ~bits);
+    broken_ |= cand_[idx] == 0;
+    return true;
+}
+
+bool grader::hidden_singles()
+{
+    bool progress = false;
+    for (auto const &unit : TABLES.units)
+    {
+        uint16_t once = 0;
+        uint16_t twice = 0;
+        for (uint8_t idx : unit)
+        {
+            twice = static_cast<uint16_t>(twice | (once & cand_[idx]));
+            once = static_cast<uint16_t>(once | cand_[idx]);
+        }
+        uint16_t singles = static_cast<uint16_t>(once & ~twice);
+        while (singles != 0)
+        {
+            uint16_t const bit = static_cast<uint16_t>(singles & -singles);
+            singles = static_cast<uint16_t>(singles & ~bit);
+            for (uint8_t idx : unit)
+            {
+                // an earlier placement may have taken the candidate away
+                if (cand_[idx] & bit)
+                {
+                    place(idx, bit);
+                    progress = true;
+                    break;
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+bool grader::naked_singles()
+{
+    bool progress = false;
+    for (unsigned int idx = 0; idx < 81U; ++idx)
+    {
+        if (cand_[idx] != 0 && std::has_single_bit(cand_[idx]))
+        {
+            place(idx, cand_[idx]);
+            progress = true;
+        }
+    }
+    return progress;
+}
+
+bool grader::pointing()
+{
+    bool progress = false;
+    for (unsigned int b = 0; b < 9U; ++b)
+    {
+        auto const &box = TABLES.units[18 + b];
+        for (uint16_t bit = 1; bit < (1U << 9); bit = static_cast<uint16_t>(bit << 1))
+        {
+            uint16_t rows = 0;
+            uint16_t cols = 0;
+            for (uint8_t idx : box)
+            {
+                if (cand_[idx] & bit)
+                {
+                    rows = static_cast<uint16_t>(rows | (1U << (idx / 9)));
+                    cols = static_cast<uint16_t>(cols | (1U << (idx % 9)));
+                }
+            }
+            if (rows == 0)
+            {
+                continue;
+            }
+            auto const eliminate_outside_box = [&](auto const &line)
+            {
+                for (uint8_t idx : line)
+                {
+                    if (box_of(idx) != b)
+                    {
+                        progress |= eliminate(idx, bit);
+                    }
+                }
+            };
+            if (std::has_single_bit(rows))
+            {
+                eliminate_outside_box(TABLES.units[static_cast<unsigned int>(std::countr_zero(rows))]);
+            }
+            if (std::has_single_bit(cols))
+            {
+                eliminate_outside_box(TABLES.units[9 + static_cast<unsigned int>(std::countr_zero(cols))]);
+            }
+        }
+    }
+    return progress;
+}
+
+bool grader::claiming()
+{
+    bool progress = false;
+    for (unsigned int u = 0; u < 18U; ++u)
+    {
+        auto const &line = TABLES.units[u];
+        for (uint16_t bit = 1; bit < (1U << 9); bit = static_cast<uint16_t>(bit << 1))
+        {
+            uint16_t boxes = 0;
+            for (uint8_t idx : line)
+            {
+                if (cand_[idx] & bit)
+                {
+                    boxes = static_cast<uint16_t>(boxes | (1U << box_of(idx)));
+                }
+            }
+            if (boxes == 0 || !std::has_single_bit(boxes))
+            {
+                continue;
+            }
+            for (uint8_t idx : TABLES.units[18 + static_cast<unsigned int>(std::countr_zero(boxes))])
+            {
+                bool const on_line = u < 9 ? idx / 9 == u : idx % 9 == u - 9;
+                if (!on_line)
+                {
+                    progress |= eliminate(idx, bit);
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+bool grader::naked_subset(unsigned int n)
+{
+    bool progress = false;
+    for (auto const &unit : TABLES.units)
+    {
+        std::array<uint8_t, 9> cells;
+        unsigned int n_cells = 0;
+        for (uint8_t idx : unit)
+        {
+            if (cand_[idx] != 0 && std::popcount(cand_[idx]) <= static_cast<int>(n))
+            {
+                cells[n_cells++] = idx;
+            }
+        }
+        // all subsets of n cells, as index masks over `cells`
+        for (uint16_t subset = 0; subset < (1U << n_cells); ++subset)
+        {
+            if (std::popcount(subset) != static_cast<int>(n))
+            {
+                continue;
+            }
+            uint16_t digits = 0;
+            for (unsigned int i = 0; i < n_cells; ++i)
+            {
+                if (subset & (1U << i))
+                {
+                    digits = static_cast<uint16_t>(digits | cand_[cells[i]]);
+                }
+            }
+            if (std::popcount(digits) != static_cast<int>(n))
+            {
+                continue;
+            }
+            for (uint8_t idx : unit)
+            {
+                bool in_subset = false;
+                for (unsigned int i = 0; i < n_cells; ++i)
+                {
+                    in_subset |= (subset & (1U << i)) && cells[i] == idx;
+                }
+                if (!in_subset && cand_[idx] != 0)
+                {
+                    progress |= eliminate(idx, digits);
+                }
+            }
+            if (progress)
+            {
+                return true;
+            }
+        }
+    }
+    return progress;
+}
+
+bool grader::hidden_subset(unsigned int n)
+{
+    for (auto const &unit : TABLES.units)
+    {
+        // positions within the unit per digit
+        std::array<uint16_t, 9> where{};
+        for (unsigned int j = 0; j < 9U; ++j)
+        {
+            uint16_t c = cand_[unit[j]];
+            while (c != 0)
+            {
+                unsigned int const d = static_cast<unsigned int>(std::countr_zero(c));
+                c = static_cast<uint16_t>(c & (c - 1));
+                where[d] = static_cast<uint16_t>(where[d] | (1U << j));
+            }
+        }
+        // only digits with at most n places can be part of a hidden subset
+        uint16_t active = 0;
+        for (unsigned int d = 0; d < 9U; ++d)
+        {
+            if (where[d] != 0 && std::popcount(where[d]) <= static_cast<int>(n))
+            {
+                active = static_cast<uint16_t>(active | (1U << d));
+            }
+        }
+        for (uint16_t digits = active; digits != 0; digits = static_cast<uint16_t>((digits - 1) & active))
+        {
+            if (std::popcount(digits) != static_cast<int>(n))
+            {
+                continue;
+            }
+            uint16_t positions = 0;
+            for (unsigned int d = 0; d < 9U; ++d)
+            {
+                if (digits & (1U << d))
+                {
+                    positions = static_cast<uint16_t>(positions | where[d]);
+                }
+            }
+            if (std::popcount(positions) != static_cast<int>(n))
+            {
+                continue;
+            }
+            bool progress = false;
+            for (unsigned int j = 0; j < 9U; ++j)
+            {
+                if (positions & (1U << j))
+                {
+                    progress |= eliminate(unit[j], static_cast<uint16_t>(sudoku::ALL_DIGITS & ~digits));
+                }
+            }
+            if (progress)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool grader::fish(unsigned int n)
+{
+    for (uint16_t bit = 1; bit < (1U << 9); bit = static_cast<uint16_t>(bit << 1))
+    {
+        // base lines are rows, then columns
+        for (unsigned int orientation = 0; orientation < 2U; ++orientation)
+        {
+            std::array<uint16_t, 9> cover{};
+            uint16_t candidates = 0;
+            for (unsigned int line = 0; line < 9U; ++line)
+            {
+                for (unsigned int k = 0; k < 9U; ++k)
+                {
+                    unsigned int const idx = orientation == 0 ? line * 9 + k : k * 9 + line;
+                    if (cand_[idx] & bit)
+                    {
+                        cover[line] = static_cast<uint16_t>(cover[line] | (1U << k));
+                    }
+                }
+                int const count = std::popcount(cover[line]);
+                if (count >= 2 && count <= static_cast<int>(n))
+                {
+                    candidates = static_cast<uint16_t>(candidates | (1U << line));
+                }
+            }
+            for (uint16_t lines = candidates; lines != 0; lines = static_cast<uint16_t>((lines - 1) & candidates))
+            {
+                if (std::popcount(lines) != static_cast<int>(n))
+                {
+                    continue;
+                }
+                uint16_t covered = 0;
+                for (unsigned int line = 0; line < 9U; ++line)
+                {
+                    if (lines & (1U << line))
+                    {
+                        covered = static_cast<uint16_t>(covered | cover[line]);
+                    }
+                }
+                if (std::popcount(covered) != static_cast<int>(n))
+                {
+                    continue;
+                }
+                bool progress = false;
+                for (unsigned int line = 0; line < 9U; ++line)
+                {
+                    if (lines & (1U << line))
+                    {
+                        continue;
+                    }
+                    for (unsigned int k = 0; k < 9U; ++k)
+                    {
+                        if (covered & (1U << k))
+                        {
+                            progress |= eliminate(orientation == 0 ? line * 9 + k : k * 9 + line, bit);
+                        }
+                    }
+                }
+                if (progress)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool grader::xy_wing()
+{
+    for (unsigned int pivot = 0; pivot < 81U; ++pivot)
+    {
+        uint16_t const pc = cand_[pivot];
+        if (std::popcount(pc) != 2)
+        {
+            continue;
+        }
+        for (uint8_t q : TABLES.peers[pivot])
+        {
+            uint16_t const qc = cand_[q];
+            // the first pincer shares exactly one digit with the pivot
+            if (std::popcount(qc) != 2 || std::popcount(static_cast<uint16_t>(qc & pc)) != 1)
+            {
+                continue;
+            }
+            uint16_t const z = static_cast<uint16_t>(qc & ~pc);
+            // the second pincer holds z and the pivot's other digit
+            uint16_t const rc = static_cast<uint16_t>(z | (pc & ~qc));
+            for (uint8_t r : TABLES.peers[pivot])
+            {
+                if (r == q || cand_[r] != rc)
+                {
+                    continue;
+                }
+                bool progress = false;
+                for (uint8_t idx : TABLES.peers[q])
+                {
+                    if (idx != r && TABLES.sees[r][idx])
+                    {
+                        progress |= eliminate(idx, z);
+                    }
+                }
+                if (progress)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool grader::xy_chain()
+{
+    for (unsigned int start = 0; start < 81U; ++start)
+    {
+        if (std::popcount(cand_[start]) != 2)
+        {
+            continue;
+        }
+        for (uint16_t z = static_cast<uint16_t>(cand_[start] & -cand_[start]); z != 0;
+             z = static_cast<uint16_t>(cand_[start] & ~z & ~(z - 1)))
+        {
+            // if `start` isn't z, it's its other digit, which forces the next links
+            std::array<uint16_t, 81> visited{};
+            std::array<std::pair<uint8_t, uint16_t>, 162> queue;
+            unsigned int head = 0;
+            unsigned int tail = 0;
+            uint16_t const first = static_cast<uint16_t>(cand_[start] & ~z);
+            queue[tail++] = {static_cast<uint8_t>(start), first};
+            visited[start] = first;
+            while (head < tail)
+            {
+                auto const [cell, on] = queue[head++];
+                for (uint8_t next : TABLES.peers[cell])
+                {
+                    uint16_t const nc = cand_[next];
+                    if (std::popcount(nc) != 2 || (nc & on) == 0)
+                    {
+                        continue;
+                    }
+                    uint16_t const next_on = static_cast<uint16_t>(nc & ~on);
+                    if (visited[next] & next_on)
+                    {
+                        continue;
+                    }
+                    visited[next] = static_cast<uint16_t>(visited[next] | next_on);
+                    if (next_on == z && next != start)
+                    {
+                        // either end of the chain is z
+                        bool progress = false;
+                        for (uint8_t idx : TABLES.peers[start])
+                        {
+                            if (idx != next && TABLES.sees[next][idx])
+                            {
+                                progress |= eliminate(idx, z);
+                            }
+                        }
+                        if (progress)
+                        {
+                            return true;
+                        }
+                    }
+                    if (tail < queue.size())
+                    {
+                        queue[tail++] = {next, next_on};
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
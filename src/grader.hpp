@@ -0,0 +1,110 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __GRADER_HPP__
+#define __GRADER_HPP__
+
+#include <array>
+#include <cstdint>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief Rates a board by the techniques a human needs to solve it.
+ *
+ * The grader solves the board logically on bitmask candidates. In each
+ * step it applies the easiest technique that makes progress, so the
+ * hardest technique it has to use, and its rating, tell how hard the
+ * board is. Ratings roughly follow the Sudoku Explainer scale.
+ *
+ * A `grader` is a reusable workspace; keep one per thread.
+ */
+class grader
+{
+public:
+    /**
+     * @brief Solving techniques, ordered from easiest to hardest.
+     *
+     * `unsolved` means the board could not be solved with the techniques
+     * below; it needs guessing or techniques the grader doesn't know.
+     */
+    enum class technique : uint8_t
+    {
+        none,
+        hidden_single,
+        naked_single,
+        pointing,
+        claiming,
+        naked_pair,
+        x_wing,
+        hidden_pair,
+        naked_triple,
+        swordfish,
+        hidden_triple,
+        xy_wing,
+        xy_chain,
+        unsolved
+    };
+
+    struct result
+    {
+        technique hardest;
+        double rating;
+        bool solved;
+    };
+
+    /**
+     * @brief Grade a board.
+     *
+     * @param board the board; should have a unique solution
+     * @return result the hardest technique needed and its rating
+     */
+    result grade(sudoku::board_t const &board);
+
+    static char const *name(technique t);
+    static double rating(technique t);
+
+private:
+    void place(unsigned int idx, uint16_t bit);
+    bool eliminate(unsigned int idx, uint16_t bits);
+    bool apply(technique t);
+
+    bool hidden_singles();
+    bool naked_singles();
+    bool pointing();
+    bool claiming();
+    bool naked_subset(unsigned int n);
+    bool hidden_subset(unsigned int n);
+    bool fish(unsigned int n);
+    bool xy_wing();
+    bool xy_chain();
+
+    /**
+     * @brief Candidates per cell, 0 for a solved cell.
+     *
+     */
+    std::array<uint16_t, 81> cand_;
+    int n_empty_{0};
+    bool broken_{false};
+};
+
+#endif // __GRADER_HPP__
@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+
+#include "corpus.hpp"
+#include "generators.hpp"
+#include "grid_pool.hpp"
+#include "util.hpp"
+
+grid_pool::grid_pool(unsigned int producer_count, sudoku::search_mode search, uint64_t seed,
+                     std::string const &cache_filename, std::size_t capacity)
+    : capacity_(capacity), grids_(capacity)
+{
+    if (!cache_filename.empty())
+    {
+        std::ifstream fin{cache_filename};
+        std::string line;
+        board_record grid{};
+        while (std::getline(fin, line))
+        {
+            line = util::trim(line, " \t\r\n");
+            if (line.length() != 81)
+            {
+                continue;
+            }
+            std::copy(line.begin(), line.end(), grid.board.begin());
+            // only complete grids without a digit twice in a row, column or box are of any use
+            if (grid.valid())
+            {
+                cached_.push_back(grid.board);
+            }
+        }
+        n_loaded_ = cached_.size();
+        cache_.open(cache_filename, std::ios::app);
+    }
+    producers_.reserve(producer_count);
+    for (unsigned int i = 0; i < producer_count; ++i)
+    {
+        producers_.emplace_back(&grid_pool::producer, this, search, seed, i);
+    }
+}
+
+grid_pool::~grid_pool()
+{
+    stop();
+}
+
+void grid_pool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+    for (auto &producer : producers_)
+    {
+        producer.join();
+    }
+    producers_.clear();
+}
+
+bool grid_pool::take(sudoku::board_t &grid, std::atomic<bool> const &running)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cached_.empty())
+    {
+        grid = cached_.back();
+        cached_.pop_back();
+        return true;
+    }
+    while (n_grids_ == 0)
+    {
+        if (!running.load(std::memory_order_relaxed) || stopped_)
+        {
+            return false;
+        }
+        not_empty_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    grid = grids_[head_];
+    head_ = (head_ + 1) % capacity_;
+    --n_grids_;
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+void grid_pool::producer(sudoku::search_mode search, uint64_t seed, unsigned int index)
+{
+    // keep clear of the streams the generator threads use
+    sudoku::rng_t rng = sudoku::rng_t::stream(seed ^ 0x9e3779b97f4a7c15ULL, index);
+    sudoku game(rng);
+    game.set_search_mode(search);
+    while (true)
+    {
+        prefill_diagonal(game);
+        game.solve_single();
+        sudoku::board_t const grid = game.board();
+        game.reset();
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]
+                       { return stopped_ || n_grids_ < capacity_; });
+        if (stopped_)
+        {
+            return;
+        }
+        grids_[(head_ + n_grids_++) % capacity_] = grid;
+        if (cache_.is_open())
+        {
+            cache_.write(grid.data(), static_cast<std::streamsize>(grid.size()));
+            cache_.put('\n');
+        }
+        n_produced_.fetch_add(1, std::memory_order_relaxed);
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+}
@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __GRID_POOL_HPP__
+#define __GRID_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief Bounded pool of solved grids, fed by its own producer threads.
+ *
+ * Producing a solved grid (prefill plus solve) and digging puzzles out of
+ * it are decoupled: dig-out threads `take()` grids while the producers
+ * keep the pool filled up to `capacity`, blocking while it's full. The
+ * grids wait in a ring buffer allocated up front, so passing them on
+ * doesn't allocate.
+ *
+ * Grids read from the cache file are handed out before any produced
+ * ones. Produced grids are appended to the cache file, so a later run
+ * can start digging right away.
+ */
+class grid_pool
+{
+public:
+    /**
+     * @brief Start the producers.
+     *
+     * @param producer_count number of producer threads
+     * @param search search mode for solving prefilled grids
+     * @param seed seed for the producers' random number streams
+     * @param cache_filename text file with one solved grid per line; empty for no cache
+     * @param capacity maximum number of grids waiting in the pool
+     */
+    grid_pool(unsigned int producer_count, sudoku::search_mode search, uint64_t seed,
+              std::string const &cache_filename = std::string(), std::size_t capacity = 1024);
+    ~grid_pool();
+
+    grid_pool(grid_pool const &) = delete;
+    grid_pool &operator=(grid_pool const &) = delete;
+
+    /**
+     * @brief Take a grid out of the pool, waiting for one if necessary.
+     *
+     * @param[out] grid the grid
+     * @param running gives up waiting when this flag is cleared
+     * @return false if `running` was cleared before a grid became available
+     */
+    bool take(sudoku::board_t &grid, std::atomic<bool> const &running);
+
+    /**
+     * @brief Stop and join the producers.
+     *
+     */
+    void stop();
+
+    inline unsigned long long produced() const
+    {
+        return n_produced_.load(std::memory_order_relaxed);
+    }
+
+    inline unsigned long long loaded() const
+    {
+        return n_loaded_;
+    }
+
+private:
+    void producer(sudoku::search_mode search, uint64_t seed, unsigned int index);
+
+    std::size_t capacity_;
+    std::vector<sudoku::board_t> grids_;
+    std::size_t head_{0};
+    std::size_t n_grids_{0};
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    bool stopped_{false};
+    std::ofstream cache_;
+    std::vector<sudoku::board_t> cached_;
+    unsigned long long n_loaded_{0};
+    std::atomic<unsigned long long> n_produced_{0};
+    std::vector<std::thread> producers_;
+};
+
+#endif // __GRID_POOL_HPP__
@@ -0,0 +1,246 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <new>
+
+#include "libsudoku.h"
+
+#include "digger.hpp"
+#include "generators.hpp"
+#include "grader.hpp"
+#include "rng.hpp"
+#include "sudoku.hpp"
+
+/**
+ * @brief Everything the library's functions need, set up once per context.
+ *
+ * `game` generates grids from the context's own `rng`; `solver` answers
+ * `sudoku_solve()` and `sudoku_is_unique()`, so solving never disturbs a
+ * grid about to be dug.
+ */
+struct sudoku_context
+{
+    explicit sudoku_context(uint64_t seed)
+        : rng(seed), game(rng)
+    {
+        for (unsigned int i = 0; i < 81U; ++i)
+        {
+            unvisited[i] = i;
+        }
+    }
+
+    sudoku::rng_t rng;
+    sudoku game;
+    sudoku solver;
+    digger dig;
+    grader rater;
+    std::array<unsigned int, 81U> unvisited;
+};
+
+namespace
+{
+    /**
+     * @brief Read a board given as 81 chars, checking that no unit holds a digit twice.
+     *
+     * @return false if the board isn't valid
+     */
+    bool parse(char const *str, sudoku::board_t &board)
+    {
+        if (str == nullptr)
+        {
+            return false;
+        }
+        uint16_t rows[9] = {0};
+        uint16_t cols[9] = {0};
+        uint16_t boxes[9] = {0};
+        for (unsigned int i = 0; i < 81U; ++i)
+        {
+            char const c = str[i];
+            if (c == '0' || c == '.')
+            {
+                board[i] = sudoku::EMPTY;
+                continue;
+            }
+            if (c < '1' || c > '9')
+            {
+                return false;
+            }
+            uint16_t const bit = static_cast<uint16_t>(1U << (c - '1'));
+            unsigned int const row = i / 9;
+            unsigned int const col = i % 9;
+            unsigned int const box = row / 3 * 3 + col / 3;
+            if (((rows[row] | cols[col] | boxes[box]) & bit) != 0)
+            {
+                return false;
+            }
+            rows[row] |= bit;
+            cols[col] |= bit;
+            boxes[box] |= bit;
+            board[i] = c;
+        }
+        return true;
+    }
+
+    void copy_out(sudoku::board_t const &board, char *out)
+    {
+        std::copy(board.begin(), board.end(), out);
+        out[81] = '\0';
+    }
+}
+
+extern "C"
+{
+    int sudoku_api_version(void)
+    {
+        return SUDOKU_API_VERSION;
+    }
+
+    sudoku_context *sudoku_context_new(uint64_t seed)
+    {
+        return new (std::nothrow) sudoku_context(seed);
+    }
+
+    void sudoku_context_free(sudoku_context *ctx)
+    {
+        delete ctx;
+    }
+
+    int sudoku_context_set_solver(sudoku_context *ctx, int solver)
+    {
+        if (ctx == nullptr)
+        {
+            return SUDOKU_INVALID_ARGUMENT;
+        }
+        sudoku::search_mode mode;
+        switch (solver)
+        {
+        case SUDOKU_SOLVER_MRV:
+            mode = sudoku::search_mode::mrv;
+            break;
+        case SUDOKU_SOLVER_BACKTRACK:
+            mode = sudoku::search_mode::first_free;
+            break;
+        case SUDOKU_SOLVER_DLX:
+            mode = sudoku::search_mode::dlx;
+            break;
+        default:
+            return SUDOKU_INVALID_ARGUMENT;
+        }
+        ctx->game.set_search_mode(mode);
+        ctx->solver.set_search_mode(mode);
+        // the digger's mode is fixed at construction
+        ctx->dig = digger(mode);
+        return SUDOKU_OK;
+    }
+
+    int sudoku_solve(sudoku_context *ctx, char const *board, char *solution)
+    {
+        if (ctx == nullptr)
+        {
+            return SUDOKU_INVALID_ARGUMENT;
+        }
+        sudoku::board_t given;
+        if (!parse(board, given))
+        {
+            return SUDOKU_INVALID_BOARD;
+        }
+        ctx->solver.assign(given);
+        int n_solutions = 0;
+        ctx->solver.solve([&n_solutions, solution](sudoku::board_t const &found)
+                          {
+        if (n_solutions == 0 && solution != nullptr)
+        {
+            copy_out(found, solution);
+        }
+        return ++n_solutions < 2; });
+        return n_solutions;
+    }
+
+    int sudoku_is_unique(sudoku_context *ctx, char const *board)
+    {
+        if (ctx == nullptr)
+        {
+            return SUDOKU_INVALID_ARGUMENT;
+        }
+        sudoku::board_t given;
+        if (!parse(board, given))
+        {
+            return SUDOKU_INVALID_BOARD;
+        }
+        ctx->solver.assign(given);
+        return ctx->solver.has_one_clear_solution() ? 1 : 0;
+    }
+
+    int sudoku_grade(sudoku_context *ctx, char const *board, sudoku_rating *rating)
+    {
+        if (ctx == nullptr || rating == nullptr)
+        {
+            return SUDOKU_INVALID_ARGUMENT;
+        }
+        sudoku::board_t given;
+        if (!parse(board, given))
+        {
+            return SUDOKU_INVALID_BOARD;
+        }
+        grader::result const result = ctx->rater.grade(given);
+        rating->rating = result.rating;
+        rating->technique = static_cast<int>(result.hardest);
+        rating->technique_name = grader::name(result.hardest);
+        rating->solved = result.solved ? 1 : 0;
+        return SUDOKU_OK;
+    }
+
+    /**
+     * Works like the `prefill-single` generator: fill the diagonal boxes,
+     * solve, then dig the grid in a random order.
+     */
+    int sudoku_generate(sudoku_context *ctx, int empty_cells, double min_rating, unsigned int max_attempts, char *board)
+    {
+        if (ctx == nullptr || board == nullptr || empty_cells < 0 || empty_cells > 81 - static_cast<int>(sudoku::MIN_GIVENS))
+        {
+            return SUDOKU_INVALID_ARGUMENT;
+        }
+        for (unsigned int attempt = 0; max_attempts == 0 || attempt < max_attempts; ++attempt)
+        {
+            prefill_diagonal(ctx->game);
+            ctx->game.solve_single();
+            std::shuffle(ctx->unvisited.begin(), ctx->unvisited.end(), ctx->rng);
+            ctx->dig.start(ctx->game.board());
+            int const left = ctx->dig.dig(ctx->unvisited, empty_cells);
+            ctx->game.reset();
+            if (left != 0)
+            {
+                continue;
+            }
+            if (min_rating > 0 && ctx->rater.grade(ctx->dig.board()).rating < min_rating)
+            {
+                continue;
+            }
+            copy_out(ctx->dig.board(), board);
+            return SUDOKU_OK;
+        }
+        return SUDOKU_GAVE_UP;
+    }
+}
@@ -0,0 +1,313 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __LOGGING_HPP__
+#define __LOGGING_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Diagnostic messages, filtered by verbosity and buffered per thread.
+ *
+ * Messages are collected in a buffer owned by the calling thread and
+ * written to `std::clog` in whole messages, under a lock, once the buffer
+ * holds `FLUSH_SIZE` bytes or its oldest message is `FLUSH_INTERVAL` old,
+ * so threads don't garble each other's output and don't make a system
+ * call per message. A background thread, started with the first buffer,
+ * writes buffers that have grown old while their threads stayed silent.
+ * A message below the current verbosity costs one relaxed atomic load;
+ * its arguments aren't formatted.
+ */
+namespace logging
+{
+    enum level : int
+    {
+        /**
+         * @brief Always shown.
+         *
+         */
+        info = 0,
+        /**
+         * @brief Shown with `-v`, e.g. every board a generator tries.
+         *
+         */
+        verbose = 1,
+        /**
+         * @brief Shown with `-v -v`, e.g. every step of `sudoku::random_fill()`.
+         *
+         */
+        debug = 2
+    };
+
+    inline std::atomic<int> &verbosity()
+    {
+        static std::atomic<int> value{0};
+        return value;
+    }
+
+    inline void set_verbosity(int value)
+    {
+        verbosity().store(value, std::memory_order_relaxed);
+    }
+
+    inline bool enabled(level l)
+    {
+        return static_cast<int>(l) <= verbosity().load(std::memory_order_relaxed);
+    }
+
+    class thread_sink;
+
+    /**
+     * @brief All threads' message buffers, and the thread writing those that have grown old.
+     *
+     */
+    class sink_registry
+    {
+    public:
+        static sink_registry &instance()
+        {
+            static sink_registry registry;
+            return registry;
+        }
+
+        ~sink_registry()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_one();
+            if (flusher_.joinable())
+            {
+                flusher_.join();
+            }
+        }
+
+        void add(thread_sink *sink)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sinks_.push_back(sink);
+            if (!flusher_.joinable())
+            {
+                flusher_ = std::thread(&sink_registry::flush_loop, this);
+            }
+        }
+
+        void remove(thread_sink *sink)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sinks_.erase(std::remove(sinks_.begin(), sinks_.end(), sink), sinks_.end());
+        }
+
+    private:
+        sink_registry() = default;
+
+        inline void flush_loop();
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stopping_{false};
+        std::vector<thread_sink *> sinks_;
+        std::thread flusher_;
+    };
+
+    /**
+     * @brief The calling thread's message buffer.
+     *
+     * The buffer is locked while a message is built, so the background
+     * thread never writes half a message.
+     */
+    class thread_sink
+    {
+    public:
+        static constexpr std::streamoff FLUSH_SIZE = 1 << 14;
+        static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};
+
+        thread_sink()
+        {
+            sink_registry::instance().add(this);
+        }
+
+        ~thread_sink()
+        {
+            sink_registry::instance().remove(this);
+            std::lock_guard<std::mutex> lock(mutex_);
+            flush();
+        }
+
+        thread_sink(thread_sink const &) = delete;
+        thread_sink &operator=(thread_sink const &) = delete;
+
+        inline std::mutex &mutex()
+        {
+            return mutex_;
+        }
+
+        /**
+         * @brief The buffer to append to; to be called with `mutex()` locked.
+         *
+         */
+        inline std::ostream &stream()
+        {
+            if (buffer_.tellp() == std::streampos(0))
+            {
+                first_message_ = std::chrono::steady_clock::now();
+            }
+            return buffer_;
+        }
+
+        /**
+         * @brief Mark the end of a message, and write the buffer if it's due; to be called with `mutex()` locked.
+         *
+         */
+        inline void end_message()
+        {
+            if (buffer_.tellp() >= FLUSH_SIZE || std::chrono::steady_clock::now() - first_message_ >= FLUSH_INTERVAL)
+            {
+                flush();
+            }
+        }
+
+        /**
+         * @brief Write the buffer if its oldest message is `FLUSH_INTERVAL` old; to be called with `mutex()` locked.
+         *
+         */
+        inline void flush_if_old(std::chrono::steady_clock::time_point now)
+        {
+            if (buffer_.tellp() > std::streampos(0) && now - first_message_ >= FLUSH_INTERVAL)
+            {
+                flush();
+            }
+        }
+
+        /**
+         * @brief Write the buffer; to be called with `mutex()` locked.
+         *
+         */
+        void flush()
+        {
+            std::string const text = buffer_.str();
+            if (text.empty())
+            {
+                return;
+            }
+            {
+                static std::mutex output_mutex;
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::clog.write(text.data(), static_cast<std::streamsize>(text.size()));
+                std::clog.flush();
+            }
+            buffer_.str(std::string());
+        }
+
+        static inline thread_sink &local()
+        {
+            thread_local thread_sink sink;
+            return sink;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::ostringstream buffer_;
+        std::chrono::steady_clock::time_point first_message_;
+    };
+
+    inline void sink_registry::flush_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_)
+        {
+            wake_.wait_for(lock, thread_sink::FLUSH_INTERVAL / 2);
+            auto const now = std::chrono::steady_clock::now();
+            for (thread_sink *sink : sinks_)
+            {
+                std::lock_guard<std::mutex> sink_lock(sink->mutex());
+                sink->flush_if_old(now);
+            }
+        }
+    }
+
+    /**
+     * @brief A single message, built with `<<` and handed to the thread's buffer when destroyed.
+     *
+     * Use as a temporary: `logging::message(logging::verbose) << "Trying ...\n";`
+     */
+    class message
+    {
+    public:
+        explicit message(level l)
+            : sink_(enabled(l) ? &thread_sink::local() : nullptr)
+        {
+            if (sink_ != nullptr)
+            {
+                sink_->mutex().lock();
+            }
+        }
+
+        ~message()
+        {
+            if (sink_ != nullptr)
+            {
+                sink_->end_message();
+                sink_->mutex().unlock();
+            }
+        }
+
+        message(message const &) = delete;
+        message &operator=(message const &) = delete;
+
+        template <typename T>
+        inline message &operator<<(T const &value)
+        {
+            if (sink_ != nullptr)
+            {
+                sink_->stream() << value;
+            }
+            return *this;
+        }
+
+    private:
+        thread_sink *sink_;
+    };
+
+    /**
+     * @brief Write the calling thread's pending messages right away.
+     *
+     */
+    inline void flush()
+    {
+        thread_sink &sink = thread_sink::local();
+        std::lock_guard<std::mutex> lock(sink.mutex());
+        sink.flush();
+    }
+}
+
+#endif // __LOGGING_HPP__
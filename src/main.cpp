@@ -20,6 +20,8 @@
     SOFTWARE.
 */
 
+#include <algorithm>
+#include <csignal>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
@@ -30,15 +32,63 @@
 #include <cstdio>
 #include <utility>
 #include <thread>
-#include <mutex>
+#include <atomic>
+#include <memory>
 #include <chrono>
+#include <iomanip>
+#include <sstream>
 #include <unordered_map>
 
 #include <getopt.hpp>
 
+#include "affinity.hpp"
+#include "algorithm_mix.hpp"
+#include "checkpoint.hpp"
+#include "cluster.hpp"
+#include "corpus.hpp"
+#include "corpus_index.hpp"
+#include "dedup_set.hpp"
+#include "generators.hpp"
+#include "grader.hpp"
+#include "logging.hpp"
+#include "parallel_solver.hpp"
+#include "service.hpp"
+#include "stats_writer.hpp"
 #include "sudoku.hpp"
+#include "util.hpp"
 
-typedef std::function<void(int, std::mutex &, long long &, long long &)> generator_thread_t;
+/**
+ * @brief Counters of the generator pipeline, only written by the writer thread.
+ *
+ */
+struct generator_stats
+{
+    std::atomic<long long> n_games_valid{0};
+    std::atomic<long long> n_games_produced{0};
+    /**
+     * @brief Save at most this many valid games; 0 for no limit.
+     *
+     */
+    long long max_games_valid{0};
+    /**
+     * @brief Don't print each board and the progress line.
+     *
+     */
+    bool quiet{false};
+};
+
+/**
+ * @brief Set by SIGINT or SIGTERM to stop generating.
+ *
+ */
+std::atomic<bool> stop_requested{false};
+
+extern "C" void on_stop_signal(int sig)
+{
+    stop_requested.store(true);
+    // a second signal kills the process
+    std::signal(sig, SIG_DFL);
+}
 
 std::string iso_datetime_now()
 {
@@ -49,315 +99,1139 @@ std::string iso_datetime_now()
     return std::string(buf);
 }
 
-int solve(std::string const &board_data)
+int solve(std::string const &board_data, unsigned int thread_count, sudoku::search_mode search)
 {
     sudoku game(board_data);
+    game.set_search_mode(search);
     auto empty_count = game.empty_count();
     std::string level = game.level();
+    grader::result const grade = grader().grade(game.board());
     std::cout << "Trying to solve\n\n"
               << game << '\n';
-    game.solve();
-    std::cout << "number of solutions: " << game.solution_count() << " (" << game.solved_boards().size() << ")\n"
-              << "level of difficulty: " << level << " (" << empty_count << " of 64)\n\n"
-              << game.solved_boards().front()
-              << "\n";
+    long long n_solutions;
+    sudoku::board_t solution = game.board();
+    bool solved;
+    if (thread_count > 1)
+    {
+        parallel_solver solver(thread_count, search);
+        n_solutions = solver.count(game.board());
+        solved = solver.solve_single(solution);
+    }
+    else
+    {
+        n_solutions = game.solution_count();
+        solved = game.solve_single();
+        solution = game.board();
+    }
+    std::cout << "number of solutions: " << n_solutions << "\n"
+              << "level of difficulty: " << level << " (" << empty_count << " of 64)\n"
+              << "rating: " << grade.rating << " (hardest technique: " << grader::name(grade.hardest) << ")\n\n";
+    if (!solved)
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Board has no solution.\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << solution << "\n";
     return EXIT_SUCCESS;
 }
 
-void board_found(sudoku::board_t const &board, std::chrono::time_point<std::chrono::high_resolution_clock> const &t0, int difficulty, int empty_cells, bool complete, std::mutex &output_mutex, long long &n_games_valid, long long &n_games_produced)
+/**
+ * @brief Solve one line of a batch, using the same rules as `--solve`.
+ *
+ * Malformed boards and errors raised while solving are reported in the
+ * line's result instead of aborting the whole batch.
+ *
+ * @param game the calling thread's `sudoku` instance
+ * @param line the board, possibly surrounded by whitespace
+ * @return std::string the result line without a trailing newline
+ */
+std::string solve_line(sudoku &game, std::string const &line)
+{
+    std::string const board_data = util::trim(line, " \t\r\n");
+    if (board_data.length() != 81)
+    {
+        return "ERROR: Board data must contain exactly 81 digits.";
+    }
+    if (board_data.find_first_not_of("0123456789.") != std::string::npos)
+    {
+        return "ERROR: Board data must contain only digits, and '.' or '0' for empty cells.";
+    }
+    // one bad line mustn't take the results of all others down with it
+    try
+    {
+        game.assign(board_data);
+        int n_solutions = 0;
+        sudoku::board_t solution;
+        game.solve([&n_solutions, &solution](sudoku::board_t const &board)
+                   {
+            if (n_solutions == 0)
+            {
+                solution = board;
+            }
+            return ++n_solutions < 2; });
+        std::string result = n_solutions > 0
+                                 ? std::string(solution.begin(), solution.end())
+                                 : std::string("-");
+        result += '\t' + std::to_string(n_solutions) + '\t' + std::to_string(game.empty_count()) + '\t' + game.level();
+        return result;
+    }
+    catch (std::exception const &e)
+    {
+        return std::string("ERROR: ") + e.what();
+    }
+}
+
+/**
+ * @brief Solve a stream of boards, one per line, read from a file or from stdin (`-`).
+ *
+ * Files are memory-mapped. The boards are solved in batches, each one spread
+ * across `thread_count` threads, so memory use is bounded regardless of the
+ * input size. For each input line one tab-separated line is written to stdout,
+ * in input order: the (first) solution or `-`, the number of solutions capped
+ * at 2, the number of empty cells and the level of difficulty.
+ */
+int solve_stream(std::string const &filename, unsigned int thread_count, sudoku::search_mode search)
 {
-    std::lock_guard locker(output_mutex);
-    if (complete)
+    static constexpr std::size_t BATCH_SIZE = 1U << 16;
+    static constexpr std::size_t CHUNK_SIZE = 64;
+    std::unique_ptr<util::mapped_file> mapped;
+    char const *pos = nullptr;
+    char const *end = nullptr;
+    if (filename != "-")
+    {
+        mapped = std::make_unique<util::mapped_file>(filename);
+        if (!mapped->is_open())
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot read " << filename << ".\n";
+            return EXIT_FAILURE;
+        }
+        pos = mapped->data();
+        end = pos + mapped->size();
+    }
+    auto next_line = [&mapped, &pos, &end](std::string &line) -> bool
     {
-        ++n_games_valid;
-        std::cout << "\n\n\u001b[32;1mSuccess!\n\n";
-        for (int i = 0; i < 81; i += 9)
+        if (!mapped)
         {
-            std::cout.write(board.data() + i, 9);
-            std::cout << '\n';
+            return static_cast<bool>(std::getline(std::cin, line));
         }
-        std::cout << "\u001b[0m\n";
-        std::string filename = "sudoku-" + iso_datetime_now() + "-" + std::to_string(difficulty) + ".txt";
-        if (std::filesystem::exists(filename))
+        if (pos >= end)
         {
-            int seq_no = 0;
-            do
+            return false;
+        }
+        char const *eol = std::find(pos, end, '\n');
+        line.assign(pos, eol);
+        pos = eol == end ? end : eol + 1;
+        return true;
+    };
+    thread_count = std::max(1U, thread_count);
+    std::vector<std::unique_ptr<sudoku>> games;
+    for (unsigned int i = 0; i < thread_count; ++i)
+    {
+        games.emplace_back(std::make_unique<sudoku>());
+        games.back()->set_search_mode(search);
+    }
+    std::vector<std::string> lines(BATCH_SIZE);
+    std::vector<std::string> results(BATCH_SIZE);
+    std::string out;
+    while (true)
+    {
+        std::size_t n = 0;
+        while (n < BATCH_SIZE && next_line(lines[n]))
+        {
+            ++n;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        std::atomic<std::size_t> next{0};
+        auto worker = [&next, &lines, &results, n](sudoku &game)
+        {
+            std::size_t first;
+            while ((first = next.fetch_add(CHUNK_SIZE, std::memory_order_relaxed)) < n)
             {
-                filename = "sudoku-" + iso_datetime_now() + "-" + std::to_string(difficulty) + " (" + std::to_string(seq_no) + ").txt";
-                ++seq_no;
-            } while (std::filesystem::exists(filename));
+                std::size_t const last = std::min(first + CHUNK_SIZE, n);
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    results[i] = solve_line(game, lines[i]);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back(worker, std::ref(*games[i]));
         }
-        std::cout << "\u001b[32mSaving to " << filename << " ... \u001b[0m\n\n"
-                  << std::flush;
-        std::ofstream out(filename);
-        out.write(board.data(), static_cast<std::streamsize>(board.size()));
+        worker(*games.front());
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        out.clear();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            out.append(results[i]);
+            out.push_back('\n');
+        }
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
     }
-    else
+    std::cout.flush();
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Build an index of a corpus, to pick boards from by empty cells and rating (see `corpus_index`).
+ *
+ * @param input corpus file or directory of per-board text files
+ * @param filename the index file; `input` with the extension .sdi if empty
+ */
+int index_build(std::string const &input, std::string filename, unsigned int thread_count)
+{
+    if (filename.empty())
     {
-        std::cout << empty_cells << " cells above limit."
-                  << " \u001b[31;1mDiscarded.\u001b[0m\n\n";
+        filename = std::filesystem::path(input).replace_extension(".sdi").string();
     }
-    auto t1 = std::chrono::high_resolution_clock().now();
-    auto dt = t1 > t0 ? t1 - t0 : std::chrono::duration<float, std::milli>(1);
-    ++n_games_produced;
-    std::cout << std::setprecision(3) << (static_cast<float>(n_games_produced) * 1e3f / dt.count()) << " games/sec; "
-              << n_games_produced << " games total; of these "
-              << n_games_valid << " with specified difficulty " << difficulty << ".\n\n";
+    std::cerr << "Indexing " << input << " into " << filename << " ..." << std::endl;
+    corpus_index::build_result result;
+    if (!corpus_index::build(input, filename, thread_count, result))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot index " << input << " into " << filename << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << result.n_indexed << " boards indexed, " << result.n_skipped << " skipped.\n";
+    return EXIT_SUCCESS;
 }
 
-void incremental_fill_generator_thread(int difficulty, std::mutex &output_mutex, long long &n_games_valid, long long &n_games_produced)
+/**
+ * @brief Print how many boards each non-empty bucket of an index holds.
+ *
+ */
+int index_info(std::string const &filename)
 {
-    output_mutex.lock();
-    sudoku game;
-    output_mutex.unlock();
-    std::array<unsigned int, 81U> unvisited;
-    for (unsigned int i = 0; i < 81U; ++i)
+    corpus_index const index(filename);
+    if (!index.is_open())
     {
-        unvisited[i] = i;
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m " << filename << " is not a corpus index.\n";
+        return EXIT_FAILURE;
     }
-    auto t0 = std::chrono::high_resolution_clock().now();
-    while (true)
+    std::cout << "empty\trating\ttechnique\tboards\n";
+    for (unsigned int b = 0; b < corpus_index::BUCKETS; ++b)
     {
-        game.random_fill();
-        std::cout << "Trying ...\n"
-                  << game << "\n";
-        // visit cells in random order until all are visited
-        // or the desired amount of empty cells is reached
-        int empty_cells = difficulty;
-        unsigned int visited_idx = unvisited.size();
-        std::shuffle(unvisited.begin(), unvisited.end(), game.rng());
-        while (empty_cells > 0 && visited_idx-- > 0)
-        {
-            unsigned int const pos = unvisited.at(visited_idx);
-            char const cell_copy = game.at(pos);
-            game[pos] = sudoku::EMPTY;
-            if (game.has_one_clear_solution())
-            {
-                --empty_cells;
-            }
-            else
-            {
-                game[pos] = cell_copy;
-            }
+        if (index.count(b) == 0)
+        {
+            continue;
         }
-        const bool complete = empty_cells == 0;
+        auto const hardest = static_cast<grader::technique>(b % corpus_index::TECHNIQUES);
+        std::cout << (b / corpus_index::TECHNIQUES) << '\t' << grader::rating(hardest) << '\t'
+                  << grader::name(hardest) << '\t' << index.count(b) << '\n';
+    }
+    std::cout << "total\t\t\t" << index.size() << '\n';
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print boards picked at random from an index.
+ *
+ * Each board takes one tab-separated line: the board, its number of empty
+ * cells and its rating. Boards may be picked more than once.
+ *
+ * @param count number of boards to pick
+ */
+int index_query(std::string const &filename, corpus_index::query const &q, long long count, uint64_t seed)
+{
+    corpus_index const index(filename);
+    if (!index.is_open())
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m " << filename << " is not a corpus index.\n";
+        return EXIT_FAILURE;
+    }
+    sudoku::rng_t rng(seed);
+    std::ostringstream out;
+    for (long long i = 0; i < count; ++i)
+    {
+        unsigned int bucket;
+        uint8_t const *rec = index.pick(q, rng, bucket);
+        if (rec == nullptr)
         {
-            board_found(game.board(), t0, difficulty, empty_cells, complete, output_mutex, n_games_valid, n_games_produced);
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m No board in " << filename << " matches.\n";
+            return EXIT_FAILURE;
         }
+        sudoku::board_t const board = board_record::unpack(rec).board;
+        out.write(board.data(), static_cast<std::streamsize>(board.size()));
+        out << '\t' << (bucket / corpus_index::TECHNIQUES)
+            << '\t' << grader::rating(static_cast<grader::technique>(bucket % corpus_index::TECHNIQUES)) << '\n';
     }
+    std::cout << out.str() << std::flush;
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief This Sudoku generator produces valid minimal boards with the specified number of empty cells.
+ * @brief Print and save a board taken from a generator thread's queue.
  *
- * Each board is then checked if it has one clear solution. If there's no clear solution, the process repeats.
+ * Only called from the writer thread, so no locking is needed.
  */
-void mincheck_generator_thread(int difficulty, std::mutex &output_mutex, long long &n_games_valid, long long &n_games_produced)
+void save_board(found_board const &result, std::chrono::time_point<std::chrono::high_resolution_clock> const &t0, int difficulty, corpus_writer *corpus, cluster::uplink *uplink, generator_stats &stats, std::vector<std::unique_ptr<board_sink>> const &sinks)
 {
-    output_mutex.lock();
-    sudoku game;
-    output_mutex.unlock();
-    std::array<unsigned int, 81U> unvisited;
-    for (unsigned int i = 0; i < 81U; ++i)
+    sudoku::board_t const board = result.board.unpack();
+    if (result.complete && stats.max_games_valid > 0 && stats.n_games_valid.load(std::memory_order_relaxed) >= stats.max_games_valid)
     {
-        unvisited[i] = i;
+        // generator threads overshoot a bit until they learn that the count has been reached
+        return;
     }
-    auto t0 = std::chrono::high_resolution_clock().now();
-    while (true)
+    if (result.complete)
     {
-        std::shuffle(unvisited.begin(), unvisited.end(), game.rng());
-        unsigned int unvisited_idx = 0;
-        int num_placed = 81 - difficulty;
-        while (num_placed > 0)
+        stats.n_games_valid.fetch_add(1, std::memory_order_relaxed);
+        if (!stats.quiet)
         {
-            unsigned int visit_idx = unvisited.at(unvisited_idx);
-            char num = '1' + static_cast<char>(game.rng()() % 9);
-            if (game.is_safe(visit_idx, num))
+            std::cout << "\n\n\u001b[32;1mSuccess!\n\n";
+            for (int i = 0; i < 81; i += 9)
             {
-                game[visit_idx] = num;
-                --num_placed;
+                std::cout.write(board.data() + i, 9);
+                std::cout << '\n';
+            }
+            std::cout << "\u001b[0m\n";
+        }
+        if (corpus != nullptr)
+        {
+            corpus->write(board, static_cast<uint8_t>(difficulty), result.generator);
+        }
+        else if (uplink != nullptr)
+        {
+            uplink->write(board, static_cast<uint8_t>(difficulty), result.generator);
+        }
+        else
+        {
+            std::string filename = "sudoku-" + iso_datetime_now() + "-" + std::to_string(difficulty) + ".txt";
+            if (std::filesystem::exists(filename))
+            {
+                int seq_no = 0;
+                do
+                {
+                    filename = "sudoku-" + iso_datetime_now() + "-" + std::to_string(difficulty) + " (" + std::to_string(seq_no) + ").txt";
+                    ++seq_no;
+                } while (std::filesystem::exists(filename));
             }
-            ++unvisited_idx;
-            if (unvisited_idx == 81)
+            if (!stats.quiet)
             {
-                unvisited_idx = 0;
-                std::shuffle(unvisited.begin(), unvisited.end(), game.rng());
+                std::cout << "\u001b[32mSaving to " << filename << " ... \u001b[0m\n\n"
+                          << std::flush;
             }
+            std::ofstream out(filename);
+            out.write(board.data(), static_cast<std::streamsize>(board.size()));
         }
-        if (game.has_one_clear_solution())
+    }
+    else if (!stats.quiet)
+    {
+        std::cout << result.empty_cells << " cells above limit."
+                  << " \u001b[31;1mDiscarded.\u001b[0m\n\n";
+    }
+    long long const n_games_produced = stats.n_games_produced.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (stats.quiet)
+    {
+        return;
+    }
+    auto t1 = std::chrono::high_resolution_clock().now();
+    auto dt = t1 > t0 ? t1 - t0 : std::chrono::duration<float, std::milli>(1);
+    long long const n_games_valid = stats.n_games_valid.load(std::memory_order_relaxed);
+    std::cout << std::setprecision(3) << (static_cast<float>(n_games_produced) * 1e3f / dt.count()) << " games/sec; "
+              << n_games_produced << " games total; of these "
+              << n_games_valid << " with specified difficulty " << difficulty;
+    if (sinks.front()->seen != nullptr)
+    {
+        unsigned long long n_duplicates = 0;
+        for (auto const &sink : sinks)
         {
-            board_found(game.board(), t0, difficulty, 0, true, output_mutex, n_games_valid, n_games_produced);
+            n_duplicates += sink->n_duplicates.load(std::memory_order_relaxed);
         }
-        else
+        std::cout << "; " << n_duplicates << " duplicates dropped";
+    }
+    if (sinks.front()->min_rating > 0)
+    {
+        unsigned long long n_too_easy = 0;
+        for (auto const &sink : sinks)
         {
-            board_found(game.board(), t0, difficulty, 0, false, output_mutex, n_games_valid, n_games_produced);
+            n_too_easy += sink->n_too_easy.load(std::memory_order_relaxed);
         }
-        game.reset();
+        std::cout << "; " << n_too_easy << " rated below " << sinks.front()->min_rating;
+    }
+    unsigned long long n_grids = 0;
+    unsigned long long n_abandoned = 0;
+    unsigned long long n_cells_skipped = 0;
+    for (auto const &sink : sinks)
+    {
+        n_grids += sink->dig.n_grids.load(std::memory_order_relaxed);
+        n_abandoned += sink->dig.n_abandoned.load(std::memory_order_relaxed);
+        n_cells_skipped += sink->dig.n_cells_skipped.load(std::memory_order_relaxed);
+    }
+    if (n_grids > 0)
+    {
+        std::cout << "; " << n_abandoned << " of " << n_grids << " grids abandoned early, saving "
+                  << n_cells_skipped << " removal checks";
     }
+    std::cout << ".\n\n";
 }
 
 /**
- * @brief This Sudoku generator fills three independent 3x3 blocks with random numbers.
+ * @brief When the writer thread takes checkpoints, and how.
  *
- * The board is then solved. For each solution the generator tries to clear as many cells as required by the difficulty level.
- * If enough cells could be cleared the board is valid, otherwise disposed of.
+ * Every `interval` seconds the writer pauses the generator threads at
+ * `gate`, writes everything they delivered, and calls `save`.
  */
-void prefill_generator_thread(int difficulty, std::mutex &output_mutex, long long &n_games_valid, long long &n_games_produced)
+struct checkpoint_schedule
+{
+    pause_gate gate;
+    double interval{300};
+    std::chrono::steady_clock::time_point next;
+    std::function<void()> save;
+};
+
+/**
+ * @brief Drain the generator threads' queues until `running` is cleared and all queues are empty.
+ *
+ * Takes checkpoints in between if `checkpoints` is set.
+ */
+void writer_thread(int difficulty, corpus_writer *corpus, cluster::uplink *uplink, std::vector<std::unique_ptr<board_sink>> &sinks, std::atomic<bool> const &running, generator_stats &stats, checkpoint_schedule *checkpoints)
 {
-    static const std::array<uint8_t, 27> DIAGONAL3X3{
-        0, 1, 2, 9, 10, 11, 18, 19, 20,
-        30, 31, 32, 39, 40, 41, 48, 49, 50,
-        60, 61, 62, 69, 70, 71, 78, 79, 80};
-    // static const std::array<uint8_t, 27> INDEP3X3{
-    //     0, 1, 2, 9, 10, 11, 18, 19, 20,
-    //     33, 34, 35, 42, 43, 44, 51, 52, 53,
-    //     57, 58, 59, 66, 67, 68, 75, 76, 77};
-    output_mutex.lock();
-    sudoku game;
-    output_mutex.unlock();
-    std::array<unsigned int, 81U> unvisited;
-    for (unsigned int i = 0; i < 81U; ++i)
-    {
-        unvisited[i] = i;
-    }
     auto t0 = std::chrono::high_resolution_clock().now();
+    found_board result;
     while (true)
     {
-        // populate board
-        unsigned int num_idx = 0;
-        for (auto board_idx : DIAGONAL3X3)
+        bool idle = true;
+        for (auto &sink : sinks)
         {
-            game[board_idx] = game.guess_num(num_idx);
-            if (++num_idx == 9)
+            while (sink->queue.try_pop(result))
             {
-                num_idx = 0;
-                game.shuffle_guesses();
+                save_board(result, t0, difficulty, corpus, uplink, stats, sinks);
+                idle = false;
             }
         }
-        // generate all solutions
-        game.solve();
-        std::cout << "# solutions: " << game.solved_boards().size() << "\n\n";
-        for (sudoku::board_t const &board : game.solved_boards())
-        {
-            sudoku possible_solution(board);
-            std::cout << "Trying ...\n"
-                      << possible_solution << std::endl;
-            // visit cells in random order until all are visited
-            // or the desired amount of empty cells is reached
-            int empty_cells = difficulty;
-            unsigned int visited_idx = unvisited.size();
-            std::shuffle(unvisited.begin(), unvisited.end(), game.rng());
-            while (empty_cells > 0 && visited_idx-- > 0)
+        if (checkpoints != nullptr && running.load(std::memory_order_acquire) && std::chrono::steady_clock::now() >= checkpoints->next)
+        {
+            if (!checkpoints->gate.requested())
             {
-                unsigned int const pos = unvisited.at(visited_idx);
-                char const cell_copy = board.at(pos);
-                possible_solution[pos] = sudoku::EMPTY;
-                if (possible_solution.has_one_clear_solution())
-                {
-                    --empty_cells;
-                }
-                else
+                checkpoints->gate.request();
+            }
+            else if (checkpoints->gate.waiting() == sinks.size())
+            {
+                // with all generator threads paused, whatever they delivered is in the queues by now
+                for (auto &sink : sinks)
                 {
-                    possible_solution[pos] = cell_copy;
+                    while (sink->queue.try_pop(result))
+                    {
+                        save_board(result, t0, difficulty, corpus, uplink, stats, sinks);
+                    }
                 }
+                checkpoints->save();
+                checkpoints->next = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(checkpoints->interval));
+                checkpoints->gate.release();
             }
-            const bool complete = empty_cells == 0;
+        }
+        if (idle)
+        {
+            if (!running.load(std::memory_order_acquire))
             {
-                board_found(possible_solution.board(), t0, difficulty, empty_cells, complete, output_mutex, n_games_valid, n_games_produced);
+                break;
             }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
-        game.reset();
     }
 }
 
 /**
- * @brief This Sudoku generator fills three independent 3x3 blocks with random numbers.
+ * @brief Settings that only matter when generating.
  *
- * The board is then solved. For the first solution the generator tries to clear as many cells as required by the difficulty level.
- * If enough cells could be cleared the board is valid, otherwise disposed of.
  */
-void prefill_single_generator_thread(int difficulty, std::mutex &output_mutex, long long &n_games_valid, long long &n_games_produced)
+struct generate_options
 {
-    static const std::array<uint8_t, 27> DIAGONAL3X3{
-        0, 1, 2, 9, 10, 11, 18, 19, 20,
-        30, 31, 32, 39, 40, 41, 48, 49, 50,
-        60, 61, 62, 69, 70, 71, 78, 79, 80};
-    output_mutex.lock();
-    sudoku game;
-    output_mutex.unlock();
-    std::array<unsigned int, 81U> unvisited;
-    for (unsigned int i = 0; i < 81U; ++i)
-    {
-        unvisited[i] = i;
+    algorithm_t algorithm;
+    std::string out_filename;
+    uint64_t seed{0};
+    bool dedup{true};
+    unsigned int expand{0};
+    double min_rating{0};
+    bool prune{false};
+    unsigned int digs_per_grid{8};
+    unsigned int grid_threads{1};
+    std::string grid_cache;
+    long long count{0};
+    double time_limit{0};
+    bool quiet{false};
+    std::string stats_filename;
+    stats_writer::format stats_format{stats_writer::format::json};
+    double stats_interval{1};
+    std::string checkpoint_filename;
+    double checkpoint_interval{300};
+    affinity::placement pin{affinity::placement::none};
+    /**
+     * @brief The algorithms an adaptive run chooses from; `algorithm_mix::DEFAULT` if empty
+     *
+     */
+    std::vector<std::string> mix;
+    /**
+     * @brief The checkpoint to resume from, if any, read from `resume_filename`
+     *
+     */
+    checkpoint const *resume{nullptr};
+    std::string resume_filename;
+    /**
+     * @brief Where a worker sends its boards instead of writing them, if set
+     *
+     */
+    cluster::uplink *uplink{nullptr};
+    /**
+     * @brief The number of the random number stream of the first generator thread
+     *
+     */
+    unsigned int first_stream{0};
+};
+
+/**
+ * @brief Print per-thread and total throughput, accept ratio and time per valid game.
+ *
+ * @param elapsed wall time of the run in seconds
+ */
+void print_summary(std::vector<std::unique_ptr<board_sink>> const &sinks, generator_stats const &stats, double elapsed)
+{
+    latency_histogram micros;
+    unsigned long long n_produced = 0;
+    unsigned long long n_valid = 0;
+    unsigned long long n_allocs = 0;
+    std::cout << "\nSummary after " << std::fixed << std::setprecision(2) << elapsed << " s:\n";
+    for (std::size_t i = 0; i < sinks.size(); ++i)
+    {
+        board_sink const &sink = *sinks[i];
+        micros.merge(sink.valid_micros);
+        n_allocs += sink.perf.n_allocs.load();
+        unsigned long long const n_thread_produced = sink.perf.n_games.load();
+        unsigned long long const n_thread_valid = sink.perf.n_valid.load();
+        n_produced += n_thread_produced;
+        n_valid += n_thread_valid;
+        std::cout << "  thread " << std::setw(3) << i << ": "
+                  << std::setw(10) << std::setprecision(1) << (static_cast<double>(n_thread_produced) / elapsed) << " games/s, "
+                  << std::setw(10) << (static_cast<double>(n_thread_valid) / elapsed) << " valid/s\n";
     }
-    auto t0 = std::chrono::high_resolution_clock().now();
-    while (true)
+    double const accept_ratio = n_produced > 0 ? static_cast<double>(n_valid) / static_cast<double>(n_produced) : 0.0;
+    std::cout << "  total     : "
+              << std::setw(10) << (static_cast<double>(n_produced) / elapsed) << " games/s, "
+              << std::setw(10) << (static_cast<double>(n_valid) / elapsed) << " valid/s, "
+              << std::setprecision(2) << (100 * accept_ratio) << " % accepted\n"
+              << "  saved     : " << stats.n_games_valid.load() << " valid of "
+              << stats.n_games_produced.load() << " games\n";
+    if (micros.count() > 0)
+    {
+        double const p50 = micros.percentile(0.50) * 1e-3;
+        double const p99 = micros.percentile(0.99) * 1e-3;
+        std::cout << "  time per valid game (per thread): p50 " << std::setprecision(3) << p50
+                  << " ms, p99 " << p99 << " ms\n";
+    }
+    if (n_produced > sinks.size())
+    {
+        // each thread's first game is set-up, not steady state
+        std::cout << "  heap allocations per game: " << std::setprecision(3)
+                  << (static_cast<double>(n_allocs) / static_cast<double>(n_produced - sinks.size())) << '\n';
+    }
+    std::cout << std::defaultfloat << std::flush;
+}
+
+/**
+ * @brief Generate boards with boxes of `N` x `N` cells other than 9x9 ones.
+ *
+ * There's just the one algorithm (see `sized_generator_thread`), and
+ * boards are written as text, to the output file or to stdout.
+ */
+template <unsigned int N>
+int generate_sized(int difficulty, unsigned int thread_count, sudoku::search_mode search, generate_options const &options)
+{
+    constexpr unsigned int SIZE = basic_sudoku<N>::SIZE;
+    std::cerr << "Generating " << SIZE << "x" << SIZE << " games with difficulty " << difficulty
+              << " in " << thread_count << " thread" << (thread_count == 1 ? "" : "s")
+              << " (seed " << options.seed << ") ...\n"
+              << "(Press Ctrl+C to stop.)" << std::endl;
+    std::ofstream out;
+    if (!options.out_filename.empty())
     {
-        // populate board
-        unsigned int num_idx = 0;
-        for (auto board_idx : DIAGONAL3X3)
+        out.open(options.out_filename, std::ios::app);
+        if (!out.good())
         {
-            game[board_idx] = game.guess_num(num_idx);
-            if (++num_idx == 9)
-            {
-                num_idx = 0;
-                game.shuffle_guesses();
-            }
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot open " << options.out_filename << " for writing.\n";
+            return EXIT_FAILURE;
         }
-        // generate all solutions
-        game.solve_single();
-        std::cout << "Trying ...\n"
-                  << game << '\n';
-
-        // visit cells in random order until all are visited
-        // or the desired amount of empty cells is reached
-        int empty_cells = difficulty;
-        auto visited_idx = unvisited.size();
-        std::shuffle(unvisited.begin(), unvisited.end(), game.rng());
-        while (empty_cells > 0 && visited_idx-- > 0)
-        {
-            auto const pos = unvisited.at(visited_idx);
-            char const cell_copy = game.at(pos);
-            game[pos] = sudoku::EMPTY;
-            if (game.has_one_clear_solution())
-            {
-                --empty_cells;
-            }
-            else
+    }
+    std::vector<sudoku::rng_t> rngs;
+    rngs.reserve(thread_count);
+    for (auto i = 0U; i < thread_count; ++i)
+    {
+        rngs.push_back(sudoku::rng_t::stream(options.seed, i));
+    }
+    std::atomic<bool> generating{true};
+    std::atomic<bool> stopping{false};
+    sized_sink sink;
+    sink.out = out.is_open() ? static_cast<std::ostream *>(&out) : &std::cout;
+    sink.abort = &stopping;
+    sink.max_valid = static_cast<unsigned long long>(options.count);
+    auto const t_start = std::chrono::steady_clock::now();
+    std::vector<affinity::cpu> const cpus = affinity::cpu_order(options.pin);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (auto i = 0U; i < thread_count; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             {
+            if (!cpus.empty())
             {
-                game[pos] = cell_copy;
+                affinity::pin_current_thread(cpus[i % cpus.size()].id);
             }
-        }
-        const bool complete = empty_cells == 0;
-        board_found(game.board(), t0, difficulty, empty_cells, complete, output_mutex, n_games_valid, n_games_produced);
-        game.reset();
+            sized_generator_thread<N>(difficulty, search, rngs[i], sink, generating); });
+    }
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    while (!stop_requested.load() &&
+           (options.time_limit <= 0 || std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count() < options.time_limit) &&
+           (options.count <= 0 || sink.n_valid.load(std::memory_order_relaxed) < static_cast<unsigned long long>(options.count)))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+    stopping.store(true);
+    generating.store(false);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    sink.out->flush();
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    std::cerr << "\nSummary after " << std::fixed << std::setprecision(2) << elapsed << " s: "
+              << sink.n_valid.load() << " valid of " << sink.n_games.load() << " games, "
+              << std::setprecision(1) << (static_cast<double>(sink.n_valid.load()) / elapsed) << " valid/s\n"
+              << std::defaultfloat;
+    return EXIT_SUCCESS;
 }
 
-int generate(int difficulty, unsigned int thread_count, generator_thread_t const &generator)
+int generate(int difficulty, unsigned int thread_count, sudoku::search_mode search, generate_options const &options)
 {
+    algorithm_t const &algorithm = options.algorithm;
+    std::string const &out_filename = options.out_filename;
+    uint64_t const seed = options.seed;
     std::cout << "Generating games with difficulty " << difficulty
               << " in " << thread_count << " thread" << (thread_count == 1 ? "" : "s")
-              << " ...\n"
-              << "(Press Ctrl+C to break.)" << std::endl;
+              << " (seed " << seed << ") ...\n"
+              << "(Press Ctrl+C to stop.)" << std::endl;
 
+    // shared by all generator threads, so a duplicate is caught whichever thread produced the original
+    std::unique_ptr<dedup_set> seen;
+    if (options.dedup)
+    {
+        seen = std::make_unique<dedup_set>();
+    }
+    checkpoint const *resume = options.resume;
+    if (resume != nullptr && seen && !resume->load_seen(options.resume_filename, *seen))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot read the boards seen so far from " << options.resume_filename << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::unique_ptr<grid_pool> pool;
+    if (algorithm.uses_pool)
+    {
+        // the pool's state isn't checkpointed, so a resumed run makes other grids than the run before
+        uint64_t const pool_seed = resume != nullptr ? seed ^ (0x9e3779b97f4a7c15ULL * (resume->n_resumes + 1ULL)) : seed;
+        pool = std::make_unique<grid_pool>(options.grid_threads, search, pool_seed, options.grid_cache);
+        std::cout << "Digging " << options.digs_per_grid << " times from each of the grids made by "
+                  << options.grid_threads << " producer thread" << (options.grid_threads == 1 ? "" : "s");
+        if (!options.grid_cache.empty())
+        {
+            std::cout << ", starting with " << pool->loaded() << " grids from " << options.grid_cache;
+        }
+        std::cout << "\n";
+    }
+    std::vector<affinity::cpu> const cpus = affinity::cpu_order(options.pin);
+    std::unique_ptr<algorithm_mix> mix;
+    if (algorithm.adaptive)
+    {
+        mix = std::make_unique<algorithm_mix>(options.mix.empty() ? algorithm_mix::DEFAULT : options.mix, thread_count);
+        std::cout << "Adapting the share of each of " << mix->names() << " to its yield\n";
+    }
+    std::vector<std::unique_ptr<board_sink>> sinks(thread_count);
+    bool pinned = true;
+    for (auto i = 0U; i < thread_count; ++i)
+    {
+        if (cpus.empty())
+        {
+            sinks[i] = std::make_unique<board_sink>();
+        }
+        else
+        {
+            // the thread that touches memory first decides on which NUMA node it lives,
+            // so let one pinned where the generator thread will run set up its sink
+            std::thread([&sinks, &pinned, &cpus, i]()
+                        {
+                pinned = affinity::pin_current_thread(cpus[i % cpus.size()].id) && pinned;
+                sinks[i] = std::make_unique<board_sink>(); })
+                .join();
+        }
+        // every thread draws from its own non-overlapping stream
+        sinks[i]->thread_rng = sudoku::rng_t::stream(seed, options.first_stream + i);
+        sinks[i]->rng = &sinks[i]->thread_rng;
+        sinks[i]->generator_id = algorithm.id;
+        sinks[i]->mix = mix.get();
+        sinks[i]->mix_slot = i;
+        sinks[i]->seen = seen.get();
+        sinks[i]->expand = options.expand;
+        sinks[i]->min_rating = options.min_rating;
+        sinks[i]->prune = options.prune;
+        sinks[i]->pool = pool.get();
+        sinks[i]->digs_per_grid = options.digs_per_grid;
+    }
+    if (!cpus.empty())
+    {
+        if (pinned)
+        {
+            unsigned int const n_nodes = cpus.back().node + 1;
+            std::cout << "Pinning threads to " << std::min(thread_count, static_cast<unsigned int>(cpus.size())) << " of " << cpus.size()
+                      << " CPUs on " << n_nodes << " NUMA node" << (n_nodes == 1 ? "" : "s") << "\n";
+        }
+        else
+        {
+            std::cerr << "\u001b[33;1mWARNING:\u001b[0m Cannot pin threads to CPUs on this system.\n";
+        }
+    }
+    if (resume != nullptr)
+    {
+        resume->restore(sinks);
+        // drop whatever was written after the checkpoint, as the boards seen so far don't include it
+        std::error_code ec;
+        uint64_t const out_size = std::filesystem::exists(out_filename, ec) ? std::filesystem::file_size(out_filename, ec) : 0;
+        if (ec || out_size < resume->out_size)
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m " << out_filename << " is shorter than when the checkpoint was taken.\n";
+            return EXIT_FAILURE;
+        }
+        if (out_size > resume->out_size)
+        {
+            std::filesystem::resize_file(out_filename, resume->out_size, ec);
+            if (ec)
+            {
+                std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot cut " << out_filename << " back to its size when the checkpoint was taken: " << ec.message() << ".\n";
+                return EXIT_FAILURE;
+            }
+        }
+        std::cout << "Resuming after " << resume->n_games_valid << " valid of " << resume->n_games_produced << " games";
+        if (seen)
+        {
+            std::cout << ", " << seen->size() << " boards seen";
+        }
+        std::cout << "\n";
+    }
+    std::unique_ptr<corpus_writer> corpus;
+    if (!out_filename.empty())
+    {
+        corpus = std::make_unique<corpus_writer>(out_filename);
+        if (!corpus->good())
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot open " << out_filename << " for writing.\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << "Appending games to " << out_filename << " ("
+                  << (corpus->get_format() == corpus_writer::format::binary ? "binary" : "text") << ")\n";
+    }
+    cluster::uplink *uplink = options.uplink;
+    if (uplink != nullptr)
+    {
+        std::cout << "Sending games to the coordinator as worker " << uplink->get_job().worker << "\n";
+    }
+    std::unique_ptr<stats_writer> stats_out;
+    if (!options.stats_filename.empty())
+    {
+        stats_out = std::make_unique<stats_writer>(options.stats_filename, options.stats_format);
+        if (!stats_out->good())
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot open " << options.stats_filename << " for writing.\n";
+            return EXIT_FAILURE;
+        }
+    }
+    generator_stats stats;
+    stats.max_games_valid = options.count;
+    stats.quiet = options.quiet;
+    std::atomic<bool> running{true};
+    std::atomic<bool> generating{true};
+    std::atomic<bool> stopping{false};
+    for (auto &sink : sinks)
+    {
+        sink->abort = &stopping;
+        sink->last_valid = std::chrono::steady_clock::now();
+    }
+    // a resumed run goes on with the time, the totals and the count of the run before
+    auto const t_start = std::chrono::steady_clock::now() -
+                         std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(resume != nullptr ? resume->elapsed : 0.0));
+    if (resume != nullptr)
+    {
+        stats.n_games_valid.store(resume->n_games_valid);
+        stats.n_games_produced.store(resume->n_games_produced);
+    }
+    std::unique_ptr<checkpoint_schedule> checkpoints;
+    auto save_checkpoint = [&]()
+    {
+        checkpoint cp;
+        cp.algorithm_id = algorithm.id;
+        cp.difficulty = difficulty;
+        cp.search = search;
+        cp.seed = seed;
+        cp.out_filename = out_filename;
+        cp.dedup = options.dedup;
+        cp.expand = options.expand;
+        cp.min_rating = options.min_rating;
+        cp.prune = options.prune;
+        cp.digs_per_grid = options.digs_per_grid;
+        cp.grid_threads = options.grid_threads;
+        cp.grid_cache = options.grid_cache;
+        cp.mix = mix ? mix->names() : std::string();
+        cp.count = options.count;
+        cp.time_limit = options.time_limit;
+        cp.n_resumes = resume != nullptr ? resume->n_resumes + 1 : 0;
+        cp.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+        cp.n_games_valid = stats.n_games_valid.load();
+        cp.n_games_produced = stats.n_games_produced.load();
+        cp.capture(sinks);
+        corpus->flush();
+        std::error_code ec;
+        cp.out_size = std::filesystem::file_size(out_filename, ec);
+        // the boards the checkpoint counts as written must survive a crash, too
+        if (ec || !util::sync_file(out_filename) || !cp.save(options.checkpoint_filename, seen.get()))
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot write checkpoint " << options.checkpoint_filename << ".\n";
+        }
+    };
+    if (!options.checkpoint_filename.empty())
+    {
+        checkpoints = std::make_unique<checkpoint_schedule>();
+        checkpoints->interval = options.checkpoint_interval;
+        checkpoints->next = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.checkpoint_interval));
+        checkpoints->save = save_checkpoint;
+        for (auto &sink : sinks)
+        {
+            sink->gate = &checkpoints->gate;
+        }
+    }
+    std::thread writer(writer_thread, difficulty, corpus.get(), uplink, std::ref(sinks), std::cref(running), std::ref(stats), checkpoints.get());
     std::vector<std::thread> threads;
-    threads.reserve(std::thread::hardware_concurrency());
-    std::mutex output_mutex;
-    long long n_games_produced = 0;
-    long long n_games_valid = 0;
+    threads.reserve(thread_count);
     for (auto i = 0U; i < thread_count; ++i)
     {
-        threads.emplace_back(generator,
-                             difficulty,
-                             std::ref(output_mutex),
-                             std::ref(n_games_valid),
-                             std::ref(n_games_produced));
+        threads.emplace_back([&, i]()
+                             {
+            if (!cpus.empty())
+            {
+                affinity::pin_current_thread(cpus[i % cpus.size()].id);
+            }
+            algorithm.generator(difficulty, search, *sinks[i]->rng, *sinks[i], generating); });
+    }
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    auto write_stats = [&stats_out, &sinks, &stats, &t_start]()
+    {
+        stats_out->write(sinks,
+                         stats_writer::saved_counts{stats.n_games_produced.load(std::memory_order_relaxed), stats.n_games_valid.load(std::memory_order_relaxed)},
+                         std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    };
+    auto worker_stats = [&stats, &t_start]()
+    {
+        return cluster::worker_stats{static_cast<uint64_t>(stats.n_games_produced.load()), static_cast<uint64_t>(stats.n_games_valid.load()),
+                                     std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count()};
+    };
+    double next_stats = options.stats_interval;
+    double next_report = 1;
+    double last_rebalance = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    while (true)
+    {
+        double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+        if (stats_out && elapsed >= next_stats)
+        {
+            write_stats();
+            while (next_stats <= elapsed)
+            {
+                next_stats += options.stats_interval;
+            }
+        }
+        if (uplink != nullptr && elapsed >= next_report)
+        {
+            uplink->report(worker_stats());
+            next_report = elapsed + 1;
+        }
+        if (mix && elapsed - last_rebalance >= algorithm_mix::REBALANCE_INTERVAL)
+        {
+            mix->rebalance(sinks, elapsed - last_rebalance);
+            last_rebalance = elapsed;
+        }
+        if (stop_requested.load() ||
+            (uplink != nullptr && uplink->stopped()) ||
+            (options.time_limit > 0 && elapsed >= options.time_limit) ||
+            (options.count > 0 && stats.n_games_valid.load(std::memory_order_relaxed) >= options.count))
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stopping.store(true);
+    generating.store(false);
+    if (mix)
+    {
+        mix->stop();
     }
     for (auto &thread : threads)
     {
         thread.join();
     }
+    if (mix)
+    {
+        mix->measure(sinks, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count() - last_rebalance);
+    }
+    if (pool)
+    {
+        pool->stop();
+    }
+    running.store(false, std::memory_order_release);
+    writer.join();
+    if (uplink != nullptr)
+    {
+        uplink->finish(worker_stats());
+    }
+    if (checkpoints)
+    {
+        save_checkpoint();
+    }
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    if (stats_out)
+    {
+        write_stats();
+    }
+    print_summary(sinks, stats, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    if (mix)
+    {
+        mix->print_summary(std::cout);
+        std::cout << std::flush;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief The algorithm whose boards are tagged with `id`, or nullptr if there's none.
+ *
+ */
+algorithm_t const *algorithm_by_id(uint8_t id)
+{
+    auto const algorithm = std::find_if(ALGORITHMS.begin(), ALGORITHMS.end(), [id](auto const &a)
+                                        { return a.second.id == id; });
+    return algorithm == ALGORITHMS.end() ? nullptr : &algorithm->second;
+}
+
+/**
+ * @brief Generate as a worker of the coordinator at `address`, in `thread_count` threads.
+ *
+ * The settings come from the job the coordinator hands out, except for
+ * those on how the run is monitored and where its threads run.
+ */
+int work(std::string const &address, unsigned int thread_count, generate_options gen)
+{
+    std::string host;
+    std::string port;
+    std::string error;
+    if (!net::parse_address(address, host, port) || host.empty())
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid coordinator address: " << address << " (expected HOST:PORT)\n";
+        return EXIT_FAILURE;
+    }
+    cluster::uplink uplink;
+    if (!uplink.connect(host, port, thread_count, error))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m " << error << ".\n";
+        return EXIT_FAILURE;
+    }
+    cluster::job const &job = uplink.get_job();
+    algorithm_t const *algorithm = algorithm_by_id(job.algorithm_id);
+    std::string unknown;
+    if (algorithm == nullptr || (!job.mix.empty() && !algorithm_mix::parse(job.mix, gen.mix, unknown)))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m The coordinator asks for an unknown algorithm.\n";
+        return EXIT_FAILURE;
+    }
+    gen.algorithm = *algorithm;
+    gen.seed = job.seed;
+    gen.first_stream = job.first_stream;
+    gen.count = job.quota;
+    gen.time_limit = 0;
+    gen.dedup = job.dedup;
+    gen.expand = job.expand;
+    gen.min_rating = job.min_rating;
+    gen.prune = job.prune;
+    gen.digs_per_grid = job.digs_per_grid;
+    gen.grid_threads = job.grid_threads;
+    gen.out_filename.clear();
+    gen.uplink = &uplink;
+    int const rc = generate(job.difficulty, thread_count, job.search, gen);
+    if (uplink.lost())
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Lost the connection to the coordinator.\n";
+        return EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/**
+ * @brief Hand out jobs to the workers connecting at `address`, and save the boards they send.
+ *
+ * Runs until `--count` boards have been saved, until `--time-limit`, or
+ * until Ctrl+C, then tells the workers to stop and waits for their last boards.
+ */
+int coordinate(std::string const &address, int difficulty, sudoku::search_mode search, generate_options const &options)
+{
+    std::string host;
+    std::string port;
+    std::string error;
+    if (!net::parse_address(address, host, port))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid address to listen at: " << address << " (expected [HOST:]PORT)\n";
+        return EXIT_FAILURE;
+    }
+    cluster::job settings;
+    settings.algorithm_id = options.algorithm.id;
+    settings.difficulty = difficulty;
+    settings.search = search;
+    settings.seed = options.seed;
+    settings.dedup = options.dedup;
+    settings.expand = options.expand;
+    settings.min_rating = options.min_rating;
+    settings.prune = options.prune;
+    settings.digs_per_grid = options.digs_per_grid;
+    settings.grid_threads = options.grid_threads;
+    for (std::string const &name : options.mix)
+    {
+        settings.mix += (settings.mix.empty() ? "" : ",") + name;
+    }
+    corpus_writer corpus(options.out_filename);
+    if (!corpus.good())
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot open " << options.out_filename << " for writing.\n";
+        return EXIT_FAILURE;
+    }
+    // catches duplicates across workers; each worker drops its own duplicates before sending
+    std::unique_ptr<dedup_set> seen;
+    if (options.dedup)
+    {
+        seen = std::make_unique<dedup_set>();
+    }
+    cluster::coordinator coord(settings, options.count, corpus, seen.get());
+    if (!coord.start(host, port, error))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m " << error << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Coordinating workers at " << (host.empty() ? "*" : host) << ":" << port
+              << " generating games with difficulty " << difficulty << " (seed " << options.seed << ") ...\n"
+              << "Appending games to " << options.out_filename << " ("
+              << (corpus.get_format() == corpus_writer::format::binary ? "binary" : "text") << ")\n"
+              << "(Press Ctrl+C to stop.)" << std::endl;
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    auto const t_start = std::chrono::steady_clock::now();
+    double next_progress = 1;
+    while (true)
+    {
+        double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+        if (stop_requested.load() || coord.quota_reached() || (options.time_limit > 0 && elapsed >= options.time_limit))
+        {
+            break;
+        }
+        if (!options.quiet && elapsed >= next_progress)
+        {
+            unsigned int n_connected = 0;
+            double valid_per_sec = 0;
+            for (auto const &w : coord.workers())
+            {
+                if (w.connected)
+                {
+                    ++n_connected;
+                    valid_per_sec += w.stats.elapsed > 0 ? static_cast<double>(w.stats.n_valid) / w.stats.elapsed : 0.0;
+                }
+            }
+            std::cout << coord.saved() << " games saved; " << n_connected << " worker" << (n_connected == 1 ? "" : "s")
+                      << " connected, " << std::fixed << std::setprecision(1) << valid_per_sec << " valid/s\n"
+                      << std::defaultfloat << std::flush;
+            next_progress = elapsed + 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    coord.stop();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    std::vector<cluster::coordinator::worker_info> const workers = coord.workers();
+    unsigned long long n_received = 0;
+    unsigned long long n_duplicates = 0;
+    unsigned long long n_games = 0;
+    std::cout << "\nSummary after " << std::fixed << std::setprecision(2) << elapsed << " s:\n";
+    for (std::size_t i = 0; i < workers.size(); ++i)
+    {
+        cluster::coordinator::worker_info const &w = workers[i];
+        n_received += w.n_received;
+        n_duplicates += w.n_duplicates;
+        n_games += w.stats.n_games;
+        std::cout << "  worker " << std::setw(3) << i << ": " << w.address << ", " << w.threads << " threads, "
+                  << std::setprecision(1) << (w.stats.elapsed > 0 ? static_cast<double>(w.stats.n_valid) / w.stats.elapsed : 0.0) << " valid/s, "
+                  << w.n_received << " received, " << w.n_saved << " saved, " << w.n_duplicates << " duplicates\n";
+    }
+    std::cout << "  total     : " << n_games << " games, " << n_received << " valid received, "
+              << n_duplicates << " duplicates across workers, " << coord.saved() << " saved, "
+              << std::setprecision(1) << (static_cast<double>(coord.saved()) / elapsed) << " saved/s\n"
+              << std::defaultfloat << std::flush;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Answer requests at `address` until Ctrl+C (see `service`), on `thread_count` contexts.
+ *
+ */
+int serve(std::string const &address, unsigned int thread_count, uint64_t seed, sudoku::search_mode search, bool quiet)
+{
+    sudoku_solver const solver = search == sudoku::search_mode::dlx
+                                     ? SUDOKU_SOLVER_DLX
+                                 : search == sudoku::search_mode::first_free
+                                     ? SUDOKU_SOLVER_BACKTRACK
+                                     : SUDOKU_SOLVER_MRV;
+    service server(std::max(1U, thread_count), seed, solver);
+    std::string error;
+    if (!server.start(address, error))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m " << error << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Serving at " << address << " with " << std::max(1U, thread_count) << " contexts (seed " << seed << ") ...\n"
+              << "(Press Ctrl+C to stop.)" << std::endl;
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    auto const t_start = std::chrono::steady_clock::now();
+    double next_progress = 1;
+    unsigned long long last_requests = 0;
+    while (!stop_requested.load())
+    {
+        double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+        if (!quiet && elapsed >= next_progress)
+        {
+            unsigned long long const n_requests = server.requests();
+            if (n_requests != last_requests)
+            {
+                std::cout << n_requests << " requests from " << server.connections() << " connections\n"
+                          << std::flush;
+                last_requests = n_requests;
+            }
+            next_progress = elapsed + 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    server.stop();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::cout << "\n" << server.requests() << " requests from " << server.connections() << " connections answered.\n";
     return EXIT_SUCCESS;
 }
 
@@ -395,10 +1269,42 @@ void usage()
                  "       3. Clear as many cells as required by the difficulty level.\n"
                  "          If enough cells could be cleared the board is valid, otherwise disposed of.\n"
                  "\n"
+                 "   grid-pool\n"
+                 "\n"
+                 "       1. Producer threads (--grid-threads, default 1) fill a pool with\n"
+                 "          solved grids the way prefill-single does.\n"
+                 "       2. Each generator thread takes a grid from the pool and clears cells\n"
+                 "          in --digs-per-grid (default 8) different random orders.\n"
+                 "       With --grid-cache FILE, grids are read from FILE first, and new\n"
+                 "       grids are appended to it for later runs.\n"
+                 "\n"
                  "   incremental-fill\n"
                  "\n"
                  "       1. [...] TODO\n"
                  "\n"
+                 "   adaptive\n"
+                 "\n"
+                 "       1. Run prefill, prefill-single and mincheck, or the algorithms given\n"
+                 "          with --mix, e.g. --mix prefill-single,mincheck, side by side.\n"
+                 "       2. Every 2 seconds, move the threads to the one that yielded the most\n"
+                 "          valid Sudokus per second lately, keeping one in eight threads\n"
+                 "          trying the others.\n"
+                 "\n"
+                 "Solver descriptions (select with --solver):\n"
+                 "\n"
+                 "   mrv (default)\n"
+                 "\n"
+                 "       Place all cells with a single candidate, then branch on\n"
+                 "       the empty cell with the fewest candidates.\n"
+                 "\n"
+                 "   backtrack\n"
+                 "\n"
+                 "       Branch on the first empty cell in row-major order.\n"
+                 "\n"
+                 "   dlx\n"
+                 "\n"
+                 "       Solve as an exact-cover problem with Knuth's Dancing Links.\n"
+                 "\n"
                  "Each Sudoku found will be written to a text file named like sudoku-[ISO8601DateTime]-[difficulty] [seq_no].txt with a contents like (`0` denotes an empty field):\n"
                  "\n"
                  "   007000000\\\n"
@@ -411,6 +1317,89 @@ void usage()
                  "   000500060\\\n"
                  "   000400070\\\n"
                  "\n"
+                 "Write all Sudokus to a single file instead, one 81-char line per game:\n"
+                 "\n"
+                 "   sudoku -d 62 --out corpus.txt\n"
+                 "\n"
+                 "A file name ending in .sdk selects a compact binary format with\n"
+                 "42 bytes per game (difficulty, 4 bits per cell, generator id):\n"
+                 "\n"
+                 "   sudoku -d 62 --out corpus.sdk\n"
+                 "\n"
+                 "Valid Sudokus equivalent to one generated before, i.e. the same up to\n"
+                 "relabelling digits, swapping rows or columns within bands or stacks,\n"
+                 "swapping bands or stacks, or transposing, are dropped. Keep them with\n"
+                 "--no-dedup.\n"
+                 "\n"
+                 "Digging out a solved grid stops once the requested number of empty cells\n"
+                 "is out of reach. With --prune, grids that judging from earlier ones are\n"
+                 "unlikely to reach it are abandoned even earlier (experimental).\n"
+                 "\n"
+                 "Only keep Sudokus that need at least an X-wing (rating 3.2) to solve\n"
+                 "without guessing. Ratings roughly follow the Sudoku Explainer scale,\n"
+                 "from 1.5 (hidden single) via 4.2 (XY-wing) and 6.5 (XY-chain) to 10\n"
+                 "(beyond the techniques the built-in grader knows):\n"
+                 "\n"
+                 "   sudoku -d 58 --min-rating 3.2\n"
+                 "\n"
+                 "Emit 100 randomly transformed variants of each valid Sudoku, too. They're\n"
+                 "as unique and as empty as the original, so they need no further checks:\n"
+                 "\n"
+                 "   sudoku -d 58 --expand 100 --out corpus.sdk\n"
+                 "\n"
+                 "Stop after 1000 valid Sudokus or after 10 minutes, whichever comes first.\n"
+                 "Ctrl+C (SIGINT) or SIGTERM stop in the same orderly way, and a summary\n"
+                 "with games/sec per thread, accept ratio and time per valid game follows:\n"
+                 "\n"
+                 "   sudoku -d 58 --count 1000 --time-limit 600 --out corpus.txt\n"
+                 "\n"
+                 "Print nothing but the summary, and write a snapshot of the counters of all\n"
+                 "generator threads to stats.jsonl every 5 seconds, one JSON object per line\n"
+                 "(--stats-format prometheus, or a file name ending in .prom, writes the\n"
+                 "Prometheus text format instead; --stats - writes to stdout):\n"
+                 "\n"
+                 "   sudoku -d 58 --quiet --stats stats.jsonl --stats-interval 5\n"
+                 "\n"
+                 "Add -v to see every board the generators try, -v -v to see even more.\n"
+                 "\n"
+                 "Generate 16x16 Sudokus with 120 empty cells (4x4 and 25x25 work, too).\n"
+                 "These are written as text, using the digits 1 to 9 and A to G:\n"
+                 "\n"
+                 "   sudoku --size 16 -d 120 --out corpus16.txt\n"
+                 "\n"
+                 "Save a checkpoint every 10 minutes, and when the run ends, so that after a\n"
+                 "crash, or on another machine, the run goes on where the checkpoint was taken:\n"
+                 "\n"
+                 "   sudoku -d 64 -a mincheck --out corpus.sdk --checkpoint run.ckpt --checkpoint-interval 600\n"
+                 "   sudoku --resume run.ckpt\n"
+                 "\n"
+                 "Pin each thread to a CPU, filling one NUMA node after the other (compact)\n"
+                 "or taking turns between nodes (scatter). Each thread's queue and counters\n"
+                 "are then allocated on its own node:\n"
+                 "\n"
+                 "   sudoku -d 58 -T 32 --pin scatter --quiet --out corpus.sdk\n"
+                 "\n"
+                 "Spread a run over many machines: the coordinator hands out the settings\n"
+                 "and distinct random number streams to each worker that connects, drops\n"
+                 "Sudokus equivalent to one from another worker, saves the others, and stops\n"
+                 "all workers once --count Sudokus have been saved. Workers only pick their\n"
+                 "number of threads and how they report:\n"
+                 "\n"
+                 "   sudoku --coordinator 5963 -d 64 -a mincheck -n 100000 --out corpus.sdk\n"
+                 "   sudoku --worker coordinator.example:5963 -T 32 --quiet\n"
+                 "\n"
+                 "Answer requests, one per line, at a Unix domain socket or a TCP port, on\n"
+                 "4 warm contexts; e.g. `solve BOARD`, `unique BOARD`, `grade BOARD`,\n"
+                 "`generate EMPTY [MIN_RATING]` or `ping`:\n"
+                 "\n"
+                 "   sudoku --serve unix:/tmp/sudoku.sock -T 4\n"
+                 "   sudoku --serve 127.0.0.1:5964\n"
+                 "\n"
+                 "Every run prints its seed. Pass it to --seed to reproduce a batch\n"
+                 "(exactly with -T 1, per-thread streams otherwise):\n"
+                 "\n"
+                 "   sudoku -d 62 -T 1 --seed 12345 --out corpus.txt\n"
+                 "\n"
                  "Read Sudoku from file and solve it:\n"
                  "\n"
                  "   sudoku --solve-file sudoku61.txt\n"
@@ -418,23 +1407,57 @@ void usage()
                  "Or solve Sudoku serialized as a string:\n"
                  "\n"
                  "   sudoku --solve 008007006000090000012000040100483900000560020000000000000050009000000061001600030\n"
+                 "\n"
+                 "Solve many Sudokus, one per line, from a file or from stdin (`-`) in 8 threads:\n"
+                 "\n"
+                 "   sudoku --solve-stream corpus.txt -T 8 > solutions.tsv\n"
+                 "\n"
+                 "Each input line yields one output line (in input order) with the tab-separated\n"
+                 "solution, number of solutions (at most 2), number of empty cells and level.\n"
+                 "\n"
+                 "Sort a corpus (a --out file, or a directory of sudoku-*.txt files) by number\n"
+                 "of empty cells and rating into an index file that serves boards straight\n"
+                 "from a memory mapping:\n"
+                 "\n"
+                 "   sudoku --index-build corpus.sdk --out corpus.sdi -T 8\n"
+                 "\n"
+                 "Pick 10 boards with 58 empty cells rated 4.2 (XY-wing) to 6.5 at random,\n"
+                 "one tab-separated line each with board, number of empty cells and rating:\n"
+                 "\n"
+                 "   sudoku --index-query corpus.sdi -d 58 --min-rating 4.2 --max-rating 6.5 -n 10\n"
+                 "\n"
+                 "Show how many boards there are per number of empty cells and rating:\n"
+                 "\n"
+                 "   sudoku --index-info corpus.sdi\n"
                  "\n";
 }
 
 int main(int argc, char *argv[])
 {
     std::string const DEFAULT_ALGORITHM = "prefill-single";
-    std::unordered_map<std::string, generator_thread_t> const ALGORITHMS = {
-        {DEFAULT_ALGORITHM, &prefill_single_generator_thread},
-        {"prefill", &prefill_generator_thread},
-        {"mincheck", &mincheck_generator_thread},
-        {"incremental-fill", &incremental_fill_generator_thread}};
     int difficulty{61};
+    bool difficulty_given{false};
+    unsigned int size{9};
     unsigned int thread_count{std::thread::hardware_concurrency()};
     std::string sudoku_filename{};
     std::string board_data{};
+    std::string stream_filename{};
+    std::string index_input{};
+    std::string index_filename{};
+    bool index_stats{false};
+    std::string coordinator_address{};
+    std::string worker_address{};
+    std::string serve_address{};
+    double max_rating{10};
     int verbosity{0};
-    generator_thread_t generator = prefill_generator_thread;
+    generate_options gen;
+    gen.algorithm = ALGORITHMS.at(DEFAULT_ALGORITHM);
+    gen.seed = static_cast<uint64_t>(util::make_seed());
+    std::unordered_map<std::string, sudoku::search_mode> const SOLVERS = {
+        {"mrv", sudoku::search_mode::mrv},
+        {"backtrack", sudoku::search_mode::first_free},
+        {"dlx", sudoku::search_mode::dlx}};
+    sudoku::search_mode search{sudoku::search_mode::mrv};
 
     using argparser = argparser::argparser;
     argparser opt(argc, argv);
@@ -447,17 +1470,39 @@ int main(int argc, char *argv[])
              { board_data = val; })
         .reg({"--solve-file"}, argparser::required_argument, [&sudoku_filename](std::string const &val)
              { sudoku_filename = val; })
-        .reg({"-d", "--difficulty"}, argparser::required_argument, [&difficulty](std::string const &val)
-             { difficulty = std::max(25, std::min(std::stoi(val), 64)); })
+        .reg({"--solve-stream"}, argparser::required_argument, [&stream_filename](std::string const &val)
+             { stream_filename = val; })
+        .reg({"--index-build"}, argparser::required_argument, [&index_input](std::string const &val)
+             { index_input = val; })
+        .reg({"--index-query"}, argparser::required_argument, [&index_filename](std::string const &val)
+             { index_filename = val; })
+        .reg({"--index-info"}, argparser::required_argument, [&index_filename, &index_stats](std::string const &val)
+             {
+                index_filename = val;
+                index_stats = true; })
+        .reg({"--coordinator"}, argparser::required_argument, [&coordinator_address](std::string const &val)
+             { coordinator_address = val; })
+        .reg({"--worker"}, argparser::required_argument, [&worker_address](std::string const &val)
+             { worker_address = val; })
+        .reg({"--serve"}, argparser::required_argument, [&serve_address](std::string const &val)
+             { serve_address = val; })
+        .reg({"--max-rating"}, argparser::required_argument, [&max_rating](std::string const &val)
+             { max_rating = std::stod(val); })
+        .reg({"-d", "--difficulty"}, argparser::required_argument, [&difficulty, &difficulty_given](std::string const &val)
+             {
+                difficulty = std::stoi(val);
+                difficulty_given = true; })
+        .reg({"--size"}, argparser::required_argument, [&size](std::string const &val)
+             { size = static_cast<unsigned int>(std::stoi(val)); })
         .reg({"-T", "--threads"}, argparser::required_argument, [&thread_count](std::string const &val)
              { thread_count = static_cast<unsigned int>(std::stoi(val)); })
         .reg({"-v", "--verbose"}, argparser::no_argument, [&verbosity](std::string const &)
              { ++verbosity; })
-        .reg({"-a", "--algorithm"}, argparser::no_argument, [&ALGORITHMS, &generator](std::string const &val)
+        .reg({"-a", "--algorithm"}, argparser::required_argument, [&gen](std::string const &val)
              {
                 if (ALGORITHMS.find(val) != ALGORITHMS.end())
                 {
-                    generator = ALGORITHMS.at(val);
+                    gen.algorithm = ALGORITHMS.at(val);
                 }
                 else
                 {
@@ -469,6 +1514,94 @@ int main(int argc, char *argv[])
                     }
                     std::cerr << "\nType `sudoku --help` for help.\n\n";
                     exit(EXIT_FAILURE);
+                } })
+        .reg({"--mix"}, argparser::required_argument, [&gen](std::string const &val)
+             {
+                std::string error;
+                if (!algorithm_mix::parse(val, gen.mix, error))
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid algorithm for --mix: " << error << "\n\n"
+                              << "Choose from the algorithms not using a grid pool.\n\n";
+                    exit(EXIT_FAILURE);
+                } })
+        .reg({"--pin"}, argparser::required_argument, [&gen](std::string const &val)
+             {
+                if (!affinity::parse(val, gen.pin))
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid placement: " << val << "\n\n"
+                              << "Choose one of\n - none\n - compact\n - scatter\n\n";
+                    exit(EXIT_FAILURE);
+                } })
+        .reg({"--seed"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.seed = std::stoull(val); })
+        .reg({"--expand"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.expand = static_cast<unsigned int>(std::max(0, std::stoi(val))); })
+        .reg({"--min-rating"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.min_rating = std::stod(val); })
+        .reg({"--prune"}, argparser::no_argument, [&gen](std::string const &)
+             { gen.prune = true; })
+        .reg({"--no-prune"}, argparser::no_argument, [&gen](std::string const &)
+             { gen.prune = false; })
+        .reg({"--no-dedup"}, argparser::no_argument, [&gen](std::string const &)
+             { gen.dedup = false; })
+        .reg({"-o", "--out"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.out_filename = val; })
+        .reg({"-n", "--count"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.count = std::max(0LL, std::stoll(val)); })
+        .reg({"--time-limit"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.time_limit = std::max(0.0, std::stod(val)); })
+        .reg({"-q", "--quiet"}, argparser::no_argument, [&gen](std::string const &)
+             { gen.quiet = true; })
+        .reg({"--stats"}, argparser::required_argument, [&gen](std::string const &val)
+             {
+                gen.stats_filename = val;
+                gen.stats_format = stats_writer::format_for(val); })
+        .reg({"--stats-format"}, argparser::required_argument, [&gen](std::string const &val)
+             {
+                if (val == "json")
+                {
+                    gen.stats_format = stats_writer::format::json;
+                }
+                else if (val == "prometheus")
+                {
+                    gen.stats_format = stats_writer::format::prometheus;
+                }
+                else
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid stats format: " << val << "\n\n"
+                              << "Choose one of\n - json\n - prometheus\n\n";
+                    exit(EXIT_FAILURE);
+                } })
+        .reg({"--stats-interval"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.stats_interval = std::max(0.01, std::stod(val)); })
+        .reg({"--digs-per-grid"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.digs_per_grid = static_cast<unsigned int>(std::max(1, std::stoi(val))); })
+        .reg({"--grid-threads"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.grid_threads = static_cast<unsigned int>(std::max(1, std::stoi(val))); })
+        .reg({"--grid-cache"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.grid_cache = val; })
+        .reg({"--checkpoint"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.checkpoint_filename = val; })
+        .reg({"--checkpoint-interval"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.checkpoint_interval = std::max(1.0, std::stod(val)); })
+        .reg({"--resume"}, argparser::required_argument, [&gen](std::string const &val)
+             { gen.resume_filename = val; })
+        .reg({"--solver"}, argparser::required_argument, [&SOLVERS, &search](std::string const &val)
+             {
+                if (SOLVERS.find(val) != SOLVERS.end())
+                {
+                    search = SOLVERS.at(val);
+                }
+                else
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid solver: " << val << "\n\n"
+                            << "Choose one of\n";
+                    for (auto const &s : SOLVERS)
+                    {
+                        std::cerr << " - " << s.first << "\n";
+                    }
+                    std::cerr << "\nType `sudoku --help` for help.\n\n";
+                    exit(EXIT_FAILURE);
                 } });
     try
     {
@@ -481,11 +1614,39 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    if (!sudoku_filename.empty() && !board_data.empty())
+    if (static_cast<int>(!sudoku_filename.empty()) + static_cast<int>(!board_data.empty()) + static_cast<int>(!stream_filename.empty()) +
+            static_cast<int>(!index_input.empty()) + static_cast<int>(!index_filename.empty()) +
+            static_cast<int>(!coordinator_address.empty()) + static_cast<int>(!worker_address.empty()) +
+            static_cast<int>(!serve_address.empty()) >
+        1)
     {
-        std::cerr << "\u001b[31;1mERROR:\u001b[0m Only one of `--solve` or `--solve-file` is allowed.\n\n";
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Only one of `--solve`, `--solve-file`, `--solve-stream`, `--index-build`, `--index-query`, `--index-info`, `--coordinator`, `--worker` or `--serve` is allowed.\n\n";
         return EXIT_FAILURE;
     }
+    if (!index_input.empty())
+    {
+        return index_build(index_input, gen.out_filename, thread_count);
+    }
+    if (!index_filename.empty())
+    {
+        if (index_stats)
+        {
+            return index_info(index_filename);
+        }
+        corpus_index::query q;
+        q.empty_cells = difficulty_given ? difficulty : -1;
+        q.min_rating = gen.min_rating;
+        q.max_rating = max_rating;
+        return index_query(index_filename, q, std::max(1LL, gen.count), gen.seed);
+    }
+    if (!serve_address.empty())
+    {
+        return serve(serve_address, thread_count, gen.seed, search, gen.quiet);
+    }
+    if (!stream_filename.empty())
+    {
+        return solve_stream(stream_filename, thread_count, search);
+    }
     if (!sudoku_filename.empty() )
     {
         std::ifstream fin{sudoku_filename};
@@ -503,9 +1664,115 @@ int main(int argc, char *argv[])
             std::cerr << "\u001b[31;1mERROR:\u001b[0m Board data must contain exactly 81 digits.\n";
             return EXIT_FAILURE;
         }
-        return solve(board_data);
+        return solve(board_data, thread_count, search);
     }
 
-    int rc = generate(difficulty, thread_count, generator);
+    logging::set_verbosity(verbosity);
+    if (!gen.mix.empty() && !gen.algorithm.adaptive)
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m `--mix` needs `--algorithm adaptive`.\n\n";
+        return EXIT_FAILURE;
+    }
+    if (!worker_address.empty() || !coordinator_address.empty())
+    {
+        if (!gen.checkpoint_filename.empty() || !gen.resume_filename.empty() || size != 9)
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m `--coordinator` and `--worker` work for 9x9 boards only, without `--checkpoint` or `--resume`.\n\n";
+            return EXIT_FAILURE;
+        }
+        if (!worker_address.empty())
+        {
+            return work(worker_address, thread_count, gen);
+        }
+        if (gen.out_filename.empty())
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m `--coordinator` needs `--out`.\n\n";
+            return EXIT_FAILURE;
+        }
+        return coordinate(coordinator_address, std::max(25, std::min(difficulty, 64)), search, gen);
+    }
+    checkpoint resume;
+    if (!gen.resume_filename.empty())
+    {
+        if (!resume.load(gen.resume_filename))
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m " << gen.resume_filename << " is not a checkpoint.\n";
+            return EXIT_FAILURE;
+        }
+        algorithm_t const *algorithm = algorithm_by_id(resume.algorithm_id);
+        if (algorithm == nullptr)
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m " << gen.resume_filename << " was made by an unknown algorithm.\n";
+            return EXIT_FAILURE;
+        }
+        // the run goes on as it was started; only how it's monitored and where its threads run may change
+        gen.algorithm = *algorithm;
+        difficulty = resume.difficulty;
+        size = 9;
+        search = resume.search;
+        thread_count = static_cast<unsigned int>(resume.threads.size());
+        gen.seed = resume.seed;
+        gen.out_filename = resume.out_filename;
+        gen.dedup = resume.dedup;
+        gen.expand = resume.expand;
+        gen.min_rating = resume.min_rating;
+        gen.prune = resume.prune;
+        gen.digs_per_grid = resume.digs_per_grid;
+        gen.grid_threads = resume.grid_threads;
+        gen.grid_cache = resume.grid_cache;
+        std::string error;
+        if (!resume.mix.empty() && !algorithm_mix::parse(resume.mix, gen.mix, error))
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m " << gen.resume_filename << " mixes an unknown algorithm: " << error << ".\n";
+            return EXIT_FAILURE;
+        }
+        gen.count = resume.count;
+        gen.time_limit = resume.time_limit;
+        gen.resume = &resume;
+        if (gen.checkpoint_filename.empty())
+        {
+            gen.checkpoint_filename = gen.resume_filename;
+        }
+    }
+    if (!gen.checkpoint_filename.empty() && (gen.out_filename.empty() || size != 9))
+    {
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m `--checkpoint` needs `--out` and works for 9x9 boards only.\n\n";
+        return EXIT_FAILURE;
+    }
+    if (size != 9)
+    {
+        struct size_info
+        {
+            unsigned int size;
+            unsigned int box_size;
+            int default_difficulty;
+        };
+        // default difficulties that still yield boards at a good pace
+        constexpr std::array<size_info, 3> SIZES{{{4, 2, 10}, {16, 4, 120}, {25, 5, 250}}};
+        auto const info = std::find_if(SIZES.begin(), SIZES.end(), [size](size_info const &i)
+                                       { return i.size == size; });
+        if (info == SIZES.end())
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m invalid size: " << size << "\n\n"
+                      << "Choose one of 4, 9, 16 or 25.\n\n";
+            return EXIT_FAILURE;
+        }
+        int const cells = static_cast<int>(size * size);
+        int const max_difficulty = cells - static_cast<int>(size) + 1;
+        difficulty = difficulty_given
+                         ? std::max(0, std::min(difficulty, max_difficulty))
+                         : info->default_difficulty;
+        switch (info->box_size)
+        {
+        case 2:
+            return generate_sized<2>(difficulty, thread_count, search, gen);
+        case 4:
+            return generate_sized<4>(difficulty, thread_count, search, gen);
+        default:
+            return generate_sized<5>(difficulty, thread_count, search, gen);
+        }
+    }
+    difficulty = std::max(25, std::min(difficulty, 64));
+    int rc = generate(difficulty, thread_count, search, gen);
     return rc;
 }
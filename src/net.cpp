@@ -0,0 +1,402 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifdef _MSC_VER
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+
+#include "net.hpp"
+
+namespace net
+{
+    namespace
+    {
+#ifdef _MSC_VER
+        typedef SOCKET native_socket;
+        typedef int io_size;
+        constexpr int SHUT_WR = SD_SEND;
+        constexpr int SHUT_RDWR = SD_BOTH;
+
+        void init_sockets()
+        {
+            static bool const initialized = []()
+            {
+                WSADATA data;
+                return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+            }();
+            (void)initialized;
+        }
+
+        inline void close_socket(native_socket s)
+        {
+            closesocket(s);
+        }
+
+        inline bool interrupted()
+        {
+            return false;
+        }
+#else
+        typedef int native_socket;
+        typedef std::size_t io_size;
+
+        inline void init_sockets()
+        {
+        }
+
+        inline void close_socket(native_socket s)
+        {
+            ::close(s);
+        }
+
+        inline bool interrupted()
+        {
+            return errno == EINTR;
+        }
+#endif
+
+#ifdef MSG_NOSIGNAL
+        constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+        constexpr int SEND_FLAGS = 0;
+#endif
+
+        inline native_socket native(std::intptr_t handle)
+        {
+            return static_cast<native_socket>(handle);
+        }
+
+        bool send_all(std::intptr_t handle, char const *data, std::size_t size)
+        {
+            while (size > 0)
+            {
+                auto const n = ::send(native(handle), data, static_cast<io_size>(std::min<std::size_t>(size, 1U << 30)), SEND_FLAGS);
+                if (n < 0 && interrupted())
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        bool receive_all(std::intptr_t handle, char *data, std::size_t size)
+        {
+            while (size > 0)
+            {
+                auto const n = ::recv(native(handle), data, static_cast<io_size>(std::min<std::size_t>(size, 1U << 30)), 0);
+                if (n < 0 && interrupted())
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Resolve `host` and `port`, calling `f` with each address until it returns true.
+         *
+         */
+        template <typename F>
+        bool for_each_address(std::string const &host, std::string const &port, bool passive, std::string &error, F &&f)
+        {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = passive ? AI_PASSIVE : 0;
+            addrinfo *addresses = nullptr;
+            int const rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses);
+            if (rc != 0)
+            {
+                error = "cannot resolve " + host + ":" + port;
+                return false;
+            }
+            bool ok = false;
+            for (addrinfo *a = addresses; a != nullptr && !ok; a = a->ai_next)
+            {
+                ok = f(*a);
+            }
+            freeaddrinfo(addresses);
+            if (!ok)
+            {
+                error = (passive ? "cannot listen at " : "cannot connect to ") + host + ":" + port;
+            }
+            return ok;
+        }
+    }
+
+    bool parse_address(std::string const &address, std::string &host, std::string &port)
+    {
+        std::size_t const colon = address.rfind(':');
+        host = colon == std::string::npos ? std::string() : address.substr(0, colon);
+        port = colon == std::string::npos ? address : address.substr(colon + 1);
+        // "[::1]:5963"
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+        {
+            host = host.substr(1, host.size() - 2);
+        }
+        return !port.empty() && port.find_first_not_of("0123456789") == std::string::npos;
+    }
+
+    connection::connection(std::intptr_t handle)
+        : handle_(handle)
+    {
+        int const one = 1;
+        // short messages shouldn't wait for more data to come
+        setsockopt(native(handle_), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const *>(&one), sizeof(one));
+    }
+
+    connection::~connection()
+    {
+        close();
+    }
+
+    connection::connection(connection &&other) noexcept
+        : handle_(other.handle_)
+    {
+        other.handle_ = -1;
+    }
+
+    connection &connection::operator=(connection &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            handle_ = other.handle_;
+            other.handle_ = -1;
+        }
+        return *this;
+    }
+
+    connection connection::connect(std::string const &host, std::string const &port, std::string &error)
+    {
+        init_sockets();
+        std::intptr_t handle = -1;
+        for_each_address(host, port, false, error, [&handle](addrinfo const &a)
+                         {
+            native_socket const s = ::socket(a.ai_family, a.ai_socktype, a.ai_protocol);
+            if (static_cast<std::intptr_t>(s) == -1)
+            {
+                return false;
+            }
+            if (::connect(s, a.ai_addr, static_cast<int>(a.ai_addrlen)) != 0)
+            {
+                close_socket(s);
+                return false;
+            }
+            handle = static_cast<std::intptr_t>(s);
+            return true; });
+        return handle == -1 ? connection() : connection(handle);
+    }
+
+    bool connection::write_all(char const *data, std::size_t size)
+    {
+        return is_open() && send_all(handle_, data, size);
+    }
+
+    bool connection::read_exact(char *data, std::size_t size)
+    {
+        return is_open() && receive_all(handle_, data, size);
+    }
+
+    long long connection::read_some(char *data, std::size_t size)
+    {
+        while (is_open())
+        {
+            auto const n = ::recv(native(handle_), data, static_cast<io_size>(std::min<std::size_t>(size, 1U << 30)), 0);
+            if (n < 0 && interrupted())
+            {
+                continue;
+            }
+            return static_cast<long long>(n);
+        }
+        return -1;
+    }
+
+    void connection::shutdown_send()
+    {
+        if (is_open())
+        {
+            ::shutdown(native(handle_), SHUT_WR);
+        }
+    }
+
+    void connection::shutdown()
+    {
+        if (is_open())
+        {
+            ::shutdown(native(handle_), SHUT_RDWR);
+        }
+    }
+
+    void connection::close()
+    {
+        if (is_open())
+        {
+            close_socket(native(handle_));
+            handle_ = -1;
+        }
+    }
+
+    std::string connection::peer() const
+    {
+        sockaddr_storage address{};
+        socklen_t size = sizeof(address);
+        if (!is_open() || getpeername(native(handle_), reinterpret_cast<sockaddr *>(&address), &size) != 0)
+        {
+            return "?";
+        }
+        char host[NI_MAXHOST];
+        char port[NI_MAXSERV];
+        if (getnameinfo(reinterpret_cast<sockaddr *>(&address), size, host, sizeof(host), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+        {
+            return "?";
+        }
+        return std::string(host) + ":" + port;
+    }
+
+    listener::~listener()
+    {
+        close();
+    }
+
+    bool listener::listen(std::string const &host, std::string const &port, std::string &error)
+    {
+        init_sockets();
+        return for_each_address(host, port, true, error, [this](addrinfo const &a)
+                                {
+            native_socket const s = ::socket(a.ai_family, a.ai_socktype, a.ai_protocol);
+            if (static_cast<std::intptr_t>(s) == -1)
+            {
+                return false;
+            }
+            int const one = 1;
+            setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const *>(&one), sizeof(one));
+            if (::bind(s, a.ai_addr, static_cast<int>(a.ai_addrlen)) != 0 || ::listen(s, 64) != 0)
+            {
+                close_socket(s);
+                return false;
+            }
+            handle_ = static_cast<std::intptr_t>(s);
+            return true; });
+    }
+
+    connection listener::accept(int timeout_ms)
+    {
+        if (handle_ == -1)
+        {
+            return connection();
+        }
+        fd_set ready;
+        FD_ZERO(&ready);
+        FD_SET(native(handle_), &ready);
+        timeval timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        if (select(static_cast<int>(handle_ + 1), &ready, nullptr, nullptr, &timeout) <= 0)
+        {
+            return connection();
+        }
+        native_socket const s = ::accept(native(handle_), nullptr, nullptr);
+        return static_cast<std::intptr_t>(s) == -1 ? connection() : connection(static_cast<std::intptr_t>(s));
+    }
+
+#ifdef _MSC_VER
+    bool listener::listen_unix(std::string const &path, std::string &error)
+    {
+        error = "cannot listen at " + path + ": Unix domain sockets aren't supported on Windows";
+        return false;
+    }
+#else
+    bool listener::listen_unix(std::string const &path, std::string &error)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            error = "socket path too long: " + path;
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::copy(path.begin(), path.end(), address.sun_path);
+        native_socket const s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s == -1)
+        {
+            error = "cannot create a socket for " + path;
+            return false;
+        }
+        // a socket left behind by a server that didn't get to clean up
+        std::error_code ec;
+        if (std::filesystem::is_socket(path, ec))
+        {
+            ::unlink(path.c_str());
+        }
+        if (::bind(s, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) != 0 || ::listen(s, 64) != 0)
+        {
+            close_socket(s);
+            error = "cannot listen at " + path;
+            return false;
+        }
+        handle_ = s;
+        unix_path_ = path;
+        return true;
+    }
+#endif
+
+    void listener::close()
+    {
+        if (handle_ != -1)
+        {
+            close_socket(native(handle_));
+            handle_ = -1;
+        }
+        if (!unix_path_.empty())
+        {
+            std::error_code ec;
+            std::filesystem::remove(unix_path_, ec);
+            unix_path_.clear();
+        }
+    }
+
+}
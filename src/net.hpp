@@ -0,0 +1,160 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __NET_HPP__
+#define __NET_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Thin wrappers around sockets, on POSIX systems and Windows.
+ *
+ */
+namespace net
+{
+    /**
+     * @brief Split "host:port", or just "port", into its parts.
+     *
+     * @return false if there's no port
+     */
+    bool parse_address(std::string const &address, std::string &host, std::string &port);
+
+    /**
+     * @brief A connected TCP or Unix domain socket.
+     *
+     * Not thread-safe, except that one thread may write while another one
+     * reads, and `shutdown()` may be called while another thread waits in
+     * `read_exact()` or `read_some()`, which then return.
+     */
+    class connection
+    {
+    public:
+        connection() = default;
+        explicit connection(std::intptr_t handle);
+        ~connection();
+        connection(connection &&other) noexcept;
+        connection &operator=(connection &&other) noexcept;
+        connection(connection const &) = delete;
+        connection &operator=(connection const &) = delete;
+
+        /**
+         * @brief Connect to `host` at `port`.
+         *
+         * @return a connection that isn't open if it failed, with the reason in `error`
+         */
+        static connection connect(std::string const &host, std::string const &port, std::string &error);
+
+        inline bool is_open() const
+        {
+            return handle_ != -1;
+        }
+
+        /**
+         * @brief Write all of `data`, waiting as long as it takes.
+         *
+         * @return false if the connection broke
+         */
+        bool write_all(char const *data, std::size_t size);
+
+        /**
+         * @brief Read exactly `size` bytes into `data`.
+         *
+         * @return false if the connection closed or broke before
+         */
+        bool read_exact(char *data, std::size_t size);
+
+        /**
+         * @brief Read what has arrived, up to `size` bytes, waiting for at least one.
+         *
+         * @return the number of bytes read; 0 if the other end closed the connection, negative if it broke
+         */
+        long long read_some(char *data, std::size_t size);
+
+        /**
+         * @brief Send nothing more; the other end receives what was sent so far, then sees the connection close.
+         *
+         */
+        void shutdown_send();
+
+        /**
+         * @brief Send and receive nothing more, making `receive()` return false.
+         *
+         */
+        void shutdown();
+        void close();
+
+        /**
+         * @brief The address of the other end, as "host:port".
+         *
+         */
+        std::string peer() const;
+
+    private:
+        std::intptr_t handle_{-1};
+    };
+
+    /**
+     * @brief A socket listening for connections.
+     *
+     */
+    class listener
+    {
+    public:
+        listener() = default;
+        ~listener();
+        listener(listener const &) = delete;
+        listener &operator=(listener const &) = delete;
+
+        /**
+         * @brief Listen at `port` on the interface `host`, or on all if empty.
+         *
+         * @return false if it failed, with the reason in `error`
+         */
+        bool listen(std::string const &host, std::string const &port, std::string &error);
+
+        /**
+         * @brief Listen at the Unix domain socket `path`, replacing a socket left there before.
+         *
+         * The socket file is removed again by `close()`. Not available on Windows.
+         *
+         * @return false if it failed, with the reason in `error`
+         */
+        bool listen_unix(std::string const &path, std::string &error);
+
+        /**
+         * @brief Wait up to `timeout_ms` milliseconds for a connection.
+         *
+         * @return the connection, which isn't open if none came in
+         */
+        connection accept(int timeout_ms);
+
+        void close();
+
+    private:
+        std::intptr_t handle_{-1};
+        std::string unix_path_;
+    };
+}
+
+#endif // __NET_HPP__
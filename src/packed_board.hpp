@@ -0,0 +1,102 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __PACKED_BOARD_HPP__
+#define __PACKED_BOARD_HPP__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief A board packed into 41 bytes for storage, queues and hash sets.
+ *
+ * The 81 cells are stored as 4-bit nibbles, high nibble first, 0 for
+ * an empty cell. The last nibble is unused and always 0, so two packed
+ * boards are equal if and only if their bytes are.
+ */
+struct packed_board
+{
+    static constexpr std::size_t SIZE = 41;
+
+    std::array<uint8_t, SIZE> data;
+
+    static packed_board pack(sudoku::board_t const &board)
+    {
+        packed_board packed;
+        for (unsigned int i = 0; i < 80U; i += 2)
+        {
+            packed.data[i / 2] = static_cast<uint8_t>(
+                (static_cast<uint8_t>(board[i] - sudoku::EMPTY) << 4) |
+                static_cast<uint8_t>(board[i + 1] - sudoku::EMPTY));
+        }
+        packed.data[40] = static_cast<uint8_t>(static_cast<uint8_t>(board[80] - sudoku::EMPTY) << 4);
+        return packed;
+    }
+
+    sudoku::board_t unpack() const
+    {
+        sudoku::board_t board;
+        for (unsigned int i = 0; i < 80U; i += 2)
+        {
+            board[i] = static_cast<char>(sudoku::EMPTY + (data[i / 2] >> 4));
+            board[i + 1] = static_cast<char>(sudoku::EMPTY + (data[i / 2] & 0xfU));
+        }
+        board[80] = static_cast<char>(sudoku::EMPTY + (data[40] >> 4));
+        return board;
+    }
+
+    /**
+     * @brief 64-bit FNV-1a hash over the packed bytes.
+     *
+     */
+    std::size_t hash() const
+    {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (uint8_t byte : data)
+        {
+            h = (h ^ byte) * 0x100000001b3ULL;
+        }
+        return static_cast<std::size_t>(h);
+    }
+
+    bool operator==(packed_board const &) const = default;
+};
+
+static_assert(sizeof(packed_board) == packed_board::SIZE);
+static_assert(std::is_trivially_copyable_v<packed_board>);
+static_assert(std::is_trivially_copyable_v<sudoku::board_t>);
+
+template <>
+struct std::hash<packed_board>
+{
+    std::size_t operator()(packed_board const &board) const noexcept
+    {
+        return board.hash();
+    }
+};
+
+#endif // __PACKED_BOARD_HPP__
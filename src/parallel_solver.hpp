@@ -0,0 +1,336 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __PARALLEL_SOLVER_HPP__
+#define __PARALLEL_SOLVER_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief Multi-threaded solver for a single board.
+ *
+ * The search tree is expanded breadth-first at the top levels until there
+ * are enough subtrees to keep all threads busy. The subtrees are dealt out
+ * to per-thread task queues; a thread that runs out of work steals from the
+ * others. Each worker searches with its own `sudoku` instance. A shared stop
+ * flag ends all searches as soon as the caller's goal is met.
+ *
+ * The work is split once, before the search starts: a subtree, once taken,
+ * is searched to the end by the thread that took it, and busy threads
+ * never hand parts of theirs to idle ones. Stealing evens out subtrees of
+ * different sizes only as long as there are untaken ones left, so if
+ * nearly all of the work sits in a single subtree, the other threads idle
+ * until it is done. `TASKS_PER_THREAD` makes that less likely, not
+ * impossible.
+ *
+ * The worker threads are started once and then wait for jobs, so the pool
+ * can answer repeated queries with low latency.
+ */
+class parallel_solver
+{
+public:
+    typedef sudoku::board_t board_t;
+
+    explicit parallel_solver(unsigned int thread_count = std::thread::hardware_concurrency(), sudoku::search_mode mode = sudoku::search_mode::mrv)
+        : mode_(mode)
+    {
+        thread_count = std::max(1U, thread_count);
+        splitter_.set_search_mode(mode == sudoku::search_mode::dlx ? sudoku::search_mode::mrv : mode);
+        for (unsigned int i = 0; i < thread_count; ++i)
+        {
+            workers_.emplace_back(std::make_unique<worker>());
+            workers_.back()->game.set_search_mode(mode_);
+            workers_.back()->game.set_abort_flag(&stop_);
+        }
+        for (unsigned int i = 0; i < thread_count; ++i)
+        {
+            threads_.emplace_back(&parallel_solver::work, this, i);
+        }
+    }
+
+    ~parallel_solver()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        wake_.notify_all();
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    parallel_solver(parallel_solver const &) = delete;
+    parallel_solver &operator=(parallel_solver const &) = delete;
+
+    /**
+     * @brief Count the solutions of a board.
+     *
+     * @param board the board to solve
+     * @param limit stop counting when this number is reached
+     * @return long long number of solutions, at most `limit`
+     */
+    long long count(board_t const &board, long long limit = std::numeric_limits<long long>::max())
+    {
+        std::atomic<long long> n{0};
+        run(board, [&n, limit](board_t const &)
+            { return n.fetch_add(1, std::memory_order_relaxed) + 1 < limit; });
+        return std::min(n.load(), limit);
+    }
+
+    /**
+     * @brief Check if a board has exactly one solution.
+     *
+     */
+    inline bool has_one_clear_solution(board_t const &board)
+    {
+        return count(board, 2) == 1;
+    }
+
+    /**
+     * @brief Find a solution of a board.
+     *
+     * @param[in,out] board the board to solve, replaced by a solution if there's one
+     * @return true if a solution has been found
+     * @return false otherwise
+     */
+    bool solve_single(board_t &board)
+    {
+        std::mutex solution_mutex;
+        bool found = false;
+        board_t solution;
+        run(board, [&](board_t const &b)
+            {
+            std::lock_guard<std::mutex> lock(solution_mutex);
+            if (!found)
+            {
+                found = true;
+                solution = b;
+            }
+            return false; });
+        if (found)
+        {
+            board = solution;
+        }
+        return found;
+    }
+
+    inline unsigned int thread_count() const
+    {
+        return static_cast<unsigned int>(workers_.size());
+    }
+
+private:
+    typedef std::function<bool(board_t const &)> visitor_t;
+
+    struct worker
+    {
+        std::mutex mutex;
+        std::deque<board_t> tasks;
+        sudoku game;
+    };
+
+    /**
+     * @brief Search all subtrees of `board` in parallel.
+     *
+     * @param board the board to solve
+     * @param on_solution called concurrently for each solution; return false to stop all threads
+     */
+    void run(board_t const &board, visitor_t const &on_solution)
+    {
+        stop_.store(false);
+        std::vector<board_t> tasks;
+        if (!split(board, tasks, on_solution))
+        {
+            return;
+        }
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+        {
+            workers_[i % workers_.size()]->tasks.push_back(tasks[i]);
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        on_solution_ = &on_solution;
+        busy_ = static_cast<unsigned int>(workers_.size());
+        ++generation_;
+        wake_.notify_all();
+        done_.wait(lock, [this]
+                   { return busy_ == 0; });
+        on_solution_ = nullptr;
+    }
+
+    /**
+     * @brief Expand the top levels of the search tree into independent subtrees.
+     *
+     * Solutions met on the way are reported right away.
+     *
+     * @return false if the visitor asked to stop
+     */
+    bool split(board_t const &board, std::vector<board_t> &frontier, visitor_t const &on_solution)
+    {
+        std::size_t const target = TASKS_PER_THREAD * workers_.size();
+        std::vector<board_t> next;
+        frontier.assign(1, board);
+        for (unsigned int depth = 0; depth < MAX_SPLIT_DEPTH && !frontier.empty() && frontier.size() < target; ++depth)
+        {
+            next.clear();
+            for (board_t const &b : frontier)
+            {
+                splitter_.assign(b);
+                unsigned int row, col;
+                if (!splitter_.find_free_cell(row, col))
+                {
+                    // no empty cell left, i.e. solved
+                    if (!on_solution(b))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                uint16_t digits = splitter_.candidates(row, col);
+                while (digits != 0)
+                {
+                    board_t child = b;
+                    child[row * 9 + col] = static_cast<char>('1' + std::countr_zero(digits));
+                    next.push_back(child);
+                    digits &= static_cast<uint16_t>(digits - 1);
+                }
+            }
+            frontier.swap(next);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Take a task from the worker's own queue or steal one from another worker.
+     *
+     */
+    bool next_task(unsigned int idx, board_t &task)
+    {
+        {
+            worker &self = *workers_[idx];
+            std::lock_guard<std::mutex> lock(self.mutex);
+            if (!self.tasks.empty())
+            {
+                task = self.tasks.back();
+                self.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < workers_.size(); ++i)
+        {
+            worker &victim = *workers_[(idx + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned int idx)
+    {
+        worker &self = *workers_[idx];
+        unsigned long long seen = 0;
+        while (true)
+        {
+            visitor_t const *on_solution;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this, seen]
+                           { return quit_ || generation_ != seen; });
+                if (quit_)
+                {
+                    return;
+                }
+                seen = generation_;
+                on_solution = on_solution_;
+            }
+            auto stopping_visitor = [this, on_solution](board_t const &b)
+            {
+                if (!(*on_solution)(b))
+                {
+                    stop_.store(true, std::memory_order_relaxed);
+                }
+                return !stop_.load(std::memory_order_relaxed);
+            };
+            board_t task;
+            while (next_task(idx, task))
+            {
+                if (stop_.load(std::memory_order_relaxed))
+                {
+                    continue; // drain the queues
+                }
+                self.game.assign(task);
+                self.game.solve(stopping_visitor);
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0)
+            {
+                done_.notify_all();
+            }
+        }
+    }
+
+    /**
+     * @brief Number of subtrees to create per thread.
+     *
+     * There's no splitting later on (see the class comment), so the more
+     * subtrees, the better the load evens out, at the cost of more setup.
+     */
+    static constexpr std::size_t TASKS_PER_THREAD = 16;
+
+    /**
+     * @brief Number of levels the search tree is expanded at most before dealing out the subtrees.
+     *
+     */
+    static constexpr unsigned int MAX_SPLIT_DEPTH = 8;
+
+    sudoku::search_mode mode_;
+    sudoku splitter_;
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    visitor_t const *on_solution_{nullptr};
+    unsigned long long generation_{0};
+    unsigned int busy_{0};
+    bool quit_{false};
+    std::atomic<bool> stop_{false};
+};
+
+#endif // __PARALLEL_SOLVER_HPP__
@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __PERF_COUNTERS_HPP__
+#define __PERF_COUNTERS_HPP__
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+#include "spsc_queue.hpp"
+#include "sudoku.hpp"
+
+/**
+ * @brief Hot-path counters of one generator thread.
+ *
+ * Every counter has a single writer, the generator thread, which adds to
+ * it with a relaxed load and store instead of a locked read-modify-write.
+ * Any thread may read them at any time. The struct starts on a cache line
+ * of its own, so the counters of different threads never share a line.
+ */
+struct alignas(CACHE_LINE_SIZE) perf_counters
+{
+    /**
+     * @brief What a generator thread spends its time on.
+     *
+     * `prefill` covers seeding or randomly filling a board, `solve`
+     * completing it to a solved grid, `dig` clearing cells, and `output`
+     * handing the result to the writer, including grading and
+     * deduplication.
+     */
+    enum phase : unsigned int
+    {
+        prefill,
+        solve,
+        dig,
+        output,
+        PHASE_COUNT
+    };
+
+    std::atomic<uint64_t> n_games{0};
+    std::atomic<uint64_t> n_valid{0};
+    std::atomic<uint64_t> n_nodes{0};
+    std::atomic<uint64_t> n_is_safe{0};
+    std::atomic<uint64_t> n_unique_checks{0};
+    std::atomic<uint64_t> n_discarded{0};
+    /**
+     * @brief Heap allocations the thread made after delivering its first board (see `alloc_counter`)
+     *
+     */
+    std::atomic<uint64_t> n_allocs{0};
+    std::array<std::atomic<uint64_t>, PHASE_COUNT> phase_nanos{};
+
+    static inline void add(std::atomic<uint64_t> &counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline void add(sudoku::search_counters const &counters)
+    {
+        add(n_nodes, counters.n_nodes);
+        add(n_is_safe, counters.n_is_safe);
+        add(n_unique_checks, counters.n_unique_checks);
+    }
+
+    static constexpr char const *phase_name(phase p)
+    {
+        constexpr std::array<char const *, PHASE_COUNT> NAMES{"prefill", "solve", "dig", "output"};
+        return NAMES[p];
+    }
+};
+
+/**
+ * @brief Histogram of durations in microseconds, for percentiles without keeping every sample.
+ *
+ * Durations below 8 µs get a bucket each; above, each power of two is
+ * split into 8 buckets, so a percentile is off by at most 1/16 of its
+ * value. The buckets are held in place, so recording never allocates.
+ * Not thread-safe.
+ */
+class latency_histogram
+{
+public:
+    static constexpr unsigned int SUB_BUCKETS = 8;
+    static constexpr unsigned int BUCKETS = (32 - 3 + 1) * SUB_BUCKETS;
+
+    inline void record(uint32_t micros)
+    {
+        ++buckets_[bucket_of(micros)];
+        ++count_;
+    }
+
+    void merge(latency_histogram const &other)
+    {
+        for (unsigned int i = 0; i < BUCKETS; ++i)
+        {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+    }
+
+    inline uint64_t count() const
+    {
+        return count_;
+    }
+
+    /**
+     * @brief Get the duration that the share `p` of the samples doesn't exceed.
+     *
+     * @param p between 0 and 1
+     * @return double the middle of the bucket holding that sample, in microseconds; 0 if there are no samples
+     */
+    double percentile(double p) const
+    {
+        if (count_ == 0)
+        {
+            return 0;
+        }
+        uint64_t const rank = static_cast<uint64_t>(p * static_cast<double>(count_ - 1));
+        uint64_t seen = 0;
+        unsigned int i = 0;
+        while (seen + buckets_[i] <= rank)
+        {
+            seen += buckets_[i++];
+        }
+        if (i < SUB_BUCKETS)
+        {
+            return i;
+        }
+        unsigned int const shift = i / SUB_BUCKETS - 1;
+        double const lower = static_cast<double>(uint64_t{SUB_BUCKETS + i % SUB_BUCKETS} << shift);
+        return lower + static_cast<double>(uint64_t{1} << shift) / 2;
+    }
+
+private:
+    static inline unsigned int bucket_of(uint32_t micros)
+    {
+        if (micros < SUB_BUCKETS)
+        {
+            return micros;
+        }
+        // the 3 bits below the leading one pick the sub-bucket
+        unsigned int const shift = static_cast<unsigned int>(std::bit_width(micros)) - 4;
+        return (shift + 1) * SUB_BUCKETS + ((micros >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_{0};
+};
+
+/**
+ * @brief Stopwatch splitting a generator thread's time into phases.
+ *
+ * Each `lap()` charges the time since the previous lap (or construction)
+ * to the given phase.
+ */
+class phase_clock
+{
+public:
+    explicit phase_clock(perf_counters &counters)
+        : counters_(counters), t_(std::chrono::steady_clock::now())
+    {
+    }
+
+    inline void lap(perf_counters::phase p)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        perf_counters::add(counters_.phase_nanos[p], static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - t_).count()));
+        t_ = now;
+    }
+
+private:
+    perf_counters &counters_;
+    std::chrono::steady_clock::time_point t_;
+};
+
+#endif // __PERF_COUNTERS_HPP__
@@ -0,0 +1,185 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "propagate.hpp"
+
+#if defined(SUDOKU_PROPAGATE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    /**
+     * @brief Cell by cell, skipping the filled ones.
+     *
+     * The reference for the other kernels.
+     */
+    void scan_scalar(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                     char const *board, propagate::scan_result &out)
+    {
+        bool contradiction = false;
+        for (unsigned int row = 0; row < 9; ++row)
+        {
+            unsigned int single = 0;
+            for (unsigned int col = 0; col < 9; ++col)
+            {
+                if (board[row * 9 + col] != propagate::EMPTY)
+                {
+                    continue;
+                }
+                uint16_t const c = static_cast<uint16_t>(
+                    ~(row_mask[row] | col_mask[col] | box_mask[(row / 3) * 3 + col / 3]) & propagate::ALL_DIGITS);
+                out.cand[row][col] = c;
+                contradiction |= c == 0;
+                single |= static_cast<unsigned int>(c != 0 && (c & (c - 1)) == 0) << col;
+            }
+            out.naked[row] = static_cast<uint16_t>(single);
+        }
+        out.contradiction = contradiction;
+    }
+
+    propagate::scan_fn kernel_fn(propagate::kernel k)
+    {
+        switch (k)
+        {
+        case propagate::kernel::scalar:
+            return scan_scalar;
+        case propagate::kernel::sse41:
+            return propagate::detail::sse41_kernel();
+        case propagate::kernel::avx2:
+            return propagate::detail::avx2_kernel();
+        case propagate::kernel::neon:
+            return propagate::detail::neon_kernel();
+        default:
+            return nullptr;
+        }
+    }
+
+    bool cpu_supports(propagate::kernel k)
+    {
+#if defined(SUDOKU_PROPAGATE_X86)
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        bool const sse41 = (info[2] & (1 << 19)) != 0;
+        bool const os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                            (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        bool const avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+#else
+        bool const sse41 = __builtin_cpu_supports("sse4.1");
+        bool const avx2 = __builtin_cpu_supports("avx2");
+#endif
+        switch (k)
+        {
+        case propagate::kernel::sse41:
+            return sse41;
+        case propagate::kernel::avx2:
+            return avx2;
+        default:
+            break;
+        }
+#endif
+        // NEON is part of every AArch64 CPU
+        return k == propagate::kernel::scalar || k == propagate::kernel::neon;
+    }
+
+    /**
+     * @brief `scan()` until the first call.
+     *
+     */
+    void resolve(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                 char const *board, propagate::scan_result &out)
+    {
+        propagate::select(propagate::best());
+        propagate::scan(row_mask, col_mask, box_mask, board, out);
+    }
+
+    char const *const NAMES[] = {"scalar", "sse4.1", "avx2", "neon"};
+}
+
+namespace propagate
+{
+    namespace detail
+    {
+        std::atomic<scan_fn> active{resolve};
+    }
+
+    bool available(kernel k)
+    {
+        return kernel_fn(k) != nullptr && cpu_supports(k);
+    }
+
+    kernel best()
+    {
+        for (kernel k : {kernel::avx2, kernel::sse41, kernel::neon})
+        {
+            if (available(k))
+            {
+                return k;
+            }
+        }
+        return kernel::scalar;
+    }
+
+    bool select(kernel k)
+    {
+        if (!available(k))
+        {
+            return false;
+        }
+        detail::active.store(kernel_fn(k), std::memory_order_relaxed);
+        return true;
+    }
+
+    kernel selected()
+    {
+        scan_fn const active = detail::active.load(std::memory_order_relaxed);
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kernel::KERNEL_COUNT); ++i)
+        {
+            if (kernel_fn(static_cast<kernel>(i)) == active)
+            {
+                return static_cast<kernel>(i);
+            }
+        }
+        return best();
+    }
+
+    char const *name(kernel k)
+    {
+        return NAMES[static_cast<unsigned int>(k)];
+    }
+
+    bool from_name(std::string const &name, kernel &k)
+    {
+        for (unsigned int i = 0; i < static_cast<unsigned int>(kernel::KERNEL_COUNT); ++i)
+        {
+            if (name == NAMES[i])
+            {
+                k = static_cast<kernel>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+}
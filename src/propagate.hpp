@@ -0,0 +1,161 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __PROPAGATE_HPP__
+#define __PROPAGATE_HPP__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SUDOKU_PROPAGATE_X86
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SUDOKU_PROPAGATE_NEON
+#endif
+
+/**
+ * @brief Candidate scan of a 9x9 board, in one pass over all cells.
+ *
+ * A scan derives every cell's candidates from the row, column and box
+ * masks, and reports the naked singles, i.e. empty cells with exactly one
+ * candidate, and whether some empty cell has no candidate at all. Each row
+ * of the board goes into one vector of 16 16-bit lanes, so the whole grid
+ * takes nine vector operations per step.
+ *
+ * There is a kernel per instruction set. The first scan picks the fastest
+ * one the CPU supports; `select()` overrides that, e.g. for benchmarks.
+ * Select kernels before starting threads that scan.
+ */
+namespace propagate
+{
+    /**
+     * @brief Instruction sets with a kernel.
+     *
+     * `scalar` goes cell by cell and runs everywhere.
+     */
+    enum class kernel
+    {
+        scalar,
+        sse41,
+        avx2,
+        neon,
+        KERNEL_COUNT
+    };
+
+    static constexpr uint16_t ALL_DIGITS = 0x1ff;
+    static constexpr char EMPTY = '0';
+
+    /**
+     * @brief What a scan found.
+     *
+     * Plain arrays, so that the kernels get by without the standard library.
+     */
+    struct scan_result
+    {
+        /**
+         * @brief Candidates per row and column.
+         *
+         * Only lanes 0 to 8 of empty cells are meaningful.
+         */
+        alignas(32) uint16_t cand[9][16];
+        /**
+         * @brief Bit `c` of row `r` is set if cell (r, c) is a naked single.
+         *
+         */
+        uint16_t naked[9];
+        /**
+         * @brief true if an empty cell has no candidate
+         *
+         */
+        bool contradiction;
+    };
+
+    typedef void (*scan_fn)(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                            char const *board, scan_result &out);
+
+    namespace detail
+    {
+        extern std::atomic<scan_fn> active;
+
+        /**
+         * @brief The kernels compiled into this binary, or `nullptr`.
+         *
+         */
+        scan_fn sse41_kernel();
+        scan_fn avx2_kernel();
+        scan_fn neon_kernel();
+    }
+
+    /**
+     * @brief Scan a board with the selected kernel.
+     *
+     * @param row_mask the digits in rows 0 to 8
+     * @param col_mask the digits in columns 0 to 8
+     * @param box_mask the digits in boxes 0 to 8
+     * @param board the 81 cells, `EMPTY` if empty
+     * @param[out] out the candidates and singles found
+     */
+    inline void scan(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                     char const *board, scan_result &out)
+    {
+        detail::active.load(std::memory_order_relaxed)(row_mask, col_mask, box_mask, board, out);
+    }
+
+    /**
+     * @brief Check if this binary and the CPU running it support a kernel.
+     *
+     */
+    bool available(kernel k);
+
+    /**
+     * @brief Get the fastest kernel available.
+     *
+     */
+    kernel best();
+
+    /**
+     * @brief Make `scan()` use a kernel.
+     *
+     * @return false if the kernel isn't available
+     */
+    bool select(kernel k);
+
+    /**
+     * @brief Get the kernel `scan()` uses.
+     *
+     */
+    kernel selected();
+
+    char const *name(kernel k);
+
+    /**
+     * @brief Look up a kernel by its name.
+     *
+     * @return false if there's no kernel of that name
+     */
+    bool from_name(std::string const &name, kernel &k);
+}
+
+#endif // __PROPAGATE_HPP__
@@ -0,0 +1,124 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "propagate.hpp"
+
+#if defined(SUDOKU_PROPAGATE_X86)
+
+#include <immintrin.h>
+
+#include "propagate_kernel.hpp"
+
+namespace
+{
+    /**
+     * @brief All 16 lanes in one register.
+     *
+     */
+    struct avx2_vec
+    {
+        typedef __m256i type;
+
+        static inline type set1(uint16_t x)
+        {
+            return _mm256_set1_epi16(static_cast<short>(x));
+        }
+
+        static inline type load9(uint16_t const *p)
+        {
+            return _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p))),
+                _mm_cvtsi32_si128(p[8]), 1);
+        }
+
+        static inline type band(uint16_t const *p)
+        {
+            // the shuffle picks bytes within each half, so both halves hold the boxes
+            __m128i const boxes = _mm_insert_epi16(_mm_cvtsi32_si128(p[0] | (p[1] << 16)), p[2], 2);
+            __m256i const spread = _mm256_setr_epi8(0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 4, 5, 4, 5,
+                                                    4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 4, 5);
+            return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(boxes), spread);
+        }
+
+        static inline type bit_or(type a, type b)
+        {
+            return _mm256_or_si256(a, b);
+        }
+
+        static inline type bit_and(type a, type b)
+        {
+            return _mm256_and_si256(a, b);
+        }
+
+        static inline type and_not(type a, type b)
+        {
+            return _mm256_andnot_si256(a, b);
+        }
+
+        static inline type dec(type a)
+        {
+            return _mm256_subs_epu16(a, _mm256_set1_epi16(1));
+        }
+
+        static inline unsigned int zero_lanes(type a)
+        {
+            __m256i const zero = _mm256_cmpeq_epi16(a, _mm256_setzero_si256());
+            __m128i const packed = _mm_packs_epi16(_mm256_castsi256_si128(zero), _mm256_extracti128_si256(zero, 1));
+            return static_cast<unsigned int>(_mm_movemask_epi8(packed));
+        }
+
+        static inline void store(uint16_t *p, type a)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(p), a);
+        }
+
+        static inline unsigned int empty_cells(char const *board, unsigned int row)
+        {
+            // the last row is read from the end of the board, so as not to read past it
+            unsigned int const shift = row == 8 ? 7 : 0;
+            __m128i const cells = _mm_loadu_si128(reinterpret_cast<__m128i const *>(board + row * 9 - shift));
+            unsigned int const bits = static_cast<unsigned int>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(cells, _mm_set1_epi8(propagate::EMPTY))));
+            return (bits >> shift) & 0x1ff;
+        }
+    };
+
+    void scan_avx2(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                   char const *board, propagate::scan_result &out)
+    {
+        propagate::scan_board<avx2_vec>(row_mask, col_mask, box_mask, board, out);
+    }
+}
+
+propagate::scan_fn propagate::detail::avx2_kernel()
+{
+    return scan_avx2;
+}
+
+#else
+
+propagate::scan_fn propagate::detail::avx2_kernel()
+{
+    return nullptr;
+}
+
+#endif
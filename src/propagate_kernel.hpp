@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __PROPAGATE_KERNEL_HPP__
+#define __PROPAGATE_KERNEL_HPP__
+
+#include "propagate.hpp"
+
+namespace propagate
+{
+    /**
+     * @brief The scan shared by all kernels, on top of a vector type `V`.
+     *
+     * `V::type` holds 16 lanes of 16 bits, one row of the board in lanes 0
+     * to 8. `V` provides `set1()`, `load9()` to read nine masks, `band()`
+     * to spread three box masks over three lanes each, `bit_or()`,
+     * `bit_and()`, `and_not()` (`~a & b`), `dec()` (`a - 1` in every
+     * non-zero lane), `zero_lanes()` to get a bit per zero lane, `store()`,
+     * and `empty_cells()` to get a bit per empty cell of a row.
+     *
+     * Each kernel instantiates the template in a translation unit of its
+     * own, compiled for its instruction set, with a `V` in an anonymous
+     * namespace, so that no code for one instruction set leaks into
+     * another one's.
+     */
+    template <typename V>
+    inline void scan_board(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                           char const *board, scan_result &out)
+    {
+        typedef typename V::type vec;
+        vec const all = V::set1(ALL_DIGITS);
+        vec const cols = V::load9(col_mask);
+        unsigned int contradiction = 0;
+        for (unsigned int band = 0; band < 3; ++band)
+        {
+            vec const fixed = V::bit_or(cols, V::band(box_mask + 3 * band));
+            for (unsigned int row = 3 * band; row < 3 * band + 3; ++row)
+            {
+                vec const cand = V::and_not(V::bit_or(fixed, V::set1(row_mask[row])), all);
+                V::store(out.cand[row], cand);
+                unsigned int const empty = V::empty_cells(board, row);
+                unsigned int const none = V::zero_lanes(cand) & empty;
+                unsigned int const single = V::zero_lanes(V::bit_and(cand, V::dec(cand))) & empty & ~none;
+                out.naked[row] = static_cast<uint16_t>(single);
+                contradiction |= none;
+            }
+        }
+        out.contradiction = contradiction != 0;
+    }
+}
+
+#endif // __PROPAGATE_KERNEL_HPP__
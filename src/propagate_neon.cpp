@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "propagate.hpp"
+
+#if defined(SUDOKU_PROPAGATE_NEON)
+
+#include <arm_neon.h>
+
+#include "propagate_kernel.hpp"
+
+namespace
+{
+    /**
+     * @brief Lanes 0 to 7 in `lo`, lane 8 in lane 0 of `hi`.
+     *
+     */
+    struct neon_vec
+    {
+        struct type
+        {
+            uint16x8_t lo;
+            uint16x8_t hi;
+        };
+
+        static inline type set1(uint16_t x)
+        {
+            uint16x8_t const v = vdupq_n_u16(x);
+            return type{v, v};
+        }
+
+        static inline type load9(uint16_t const *p)
+        {
+            return type{vld1q_u16(p), vsetq_lane_u16(p[8], vdupq_n_u16(0), 0)};
+        }
+
+        static inline type band(uint16_t const *p)
+        {
+            uint16_t const spread[8] = {p[0], p[0], p[0], p[1], p[1], p[1], p[2], p[2]};
+            return type{vld1q_u16(spread), vsetq_lane_u16(p[2], vdupq_n_u16(0), 0)};
+        }
+
+        static inline type bit_or(type const &a, type const &b)
+        {
+            return type{vorrq_u16(a.lo, b.lo), vorrq_u16(a.hi, b.hi)};
+        }
+
+        static inline type bit_and(type const &a, type const &b)
+        {
+            return type{vandq_u16(a.lo, b.lo), vandq_u16(a.hi, b.hi)};
+        }
+
+        static inline type and_not(type const &a, type const &b)
+        {
+            return type{vbicq_u16(b.lo, a.lo), vbicq_u16(b.hi, a.hi)};
+        }
+
+        static inline type dec(type const &a)
+        {
+            uint16x8_t const one = vdupq_n_u16(1);
+            return type{vqsubq_u16(a.lo, one), vqsubq_u16(a.hi, one)};
+        }
+
+        static inline unsigned int zero_lanes(type const &a)
+        {
+            static uint16_t const LANE_BITS[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+            uint16x8_t const bits = vld1q_u16(LANE_BITS);
+            unsigned int const lo = vaddvq_u16(vandq_u16(vceqzq_u16(a.lo), bits));
+            unsigned int const hi = vaddvq_u16(vandq_u16(vceqzq_u16(a.hi), bits));
+            return lo | (hi << 8);
+        }
+
+        static inline void store(uint16_t *p, type const &a)
+        {
+            vst1q_u16(p, a.lo);
+            vst1q_u16(p + 8, a.hi);
+        }
+
+        static inline unsigned int empty_cells(char const *board, unsigned int row)
+        {
+            // the last row is read from the end of the board, so as not to read past it
+            static uint8_t const LANE_BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+            unsigned int const shift = row == 8 ? 7 : 0;
+            uint8x16_t const cells = vld1q_u8(reinterpret_cast<uint8_t const *>(board + row * 9 - shift));
+            uint8x16_t const empty = vandq_u8(vceqq_u8(cells, vdupq_n_u8(static_cast<uint8_t>(propagate::EMPTY))),
+                                              vld1q_u8(LANE_BITS));
+            unsigned int const bits = vaddv_u8(vget_low_u8(empty)) | (vaddv_u8(vget_high_u8(empty)) << 8);
+            return (bits >> shift) & 0x1ff;
+        }
+    };
+
+    void scan_neon(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                   char const *board, propagate::scan_result &out)
+    {
+        propagate::scan_board<neon_vec>(row_mask, col_mask, box_mask, board, out);
+    }
+}
+
+propagate::scan_fn propagate::detail::neon_kernel()
+{
+    return scan_neon;
+}
+
+#else
+
+propagate::scan_fn propagate::detail::neon_kernel()
+{
+    return nullptr;
+}
+
+#endif
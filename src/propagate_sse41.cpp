@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "propagate.hpp"
+
+#if defined(SUDOKU_PROPAGATE_X86)
+
+#include <immintrin.h>
+
+#include "propagate_kernel.hpp"
+
+namespace
+{
+    /**
+     * @brief Lanes 0 to 7 in `lo`, lane 8 in lane 0 of `hi`.
+     *
+     */
+    struct sse41_vec
+    {
+        struct type
+        {
+            __m128i lo;
+            __m128i hi;
+        };
+
+        static inline type set1(uint16_t x)
+        {
+            __m128i const v = _mm_set1_epi16(static_cast<short>(x));
+            return type{v, v};
+        }
+
+        static inline type load9(uint16_t const *p)
+        {
+            return type{_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)), _mm_cvtsi32_si128(p[8])};
+        }
+
+        static inline type band(uint16_t const *p)
+        {
+            __m128i const boxes = _mm_insert_epi16(_mm_cvtsi32_si128(p[0] | (p[1] << 16)), p[2], 2);
+            __m128i const spread = _mm_setr_epi8(0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 4, 5, 4, 5);
+            return type{_mm_shuffle_epi8(boxes, spread), _mm_cvtsi32_si128(p[2])};
+        }
+
+        static inline type bit_or(type const &a, type const &b)
+        {
+            return type{_mm_or_si128(a.lo, b.lo), _mm_or_si128(a.hi, b.hi)};
+        }
+
+        static inline type bit_and(type const &a, type const &b)
+        {
+            return type{_mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi)};
+        }
+
+        static inline type and_not(type const &a, type const &b)
+        {
+            return type{_mm_andnot_si128(a.lo, b.lo), _mm_andnot_si128(a.hi, b.hi)};
+        }
+
+        static inline type dec(type const &a)
+        {
+            __m128i const one = _mm_set1_epi16(1);
+            return type{_mm_subs_epu16(a.lo, one), _mm_subs_epu16(a.hi, one)};
+        }
+
+        static inline unsigned int zero_lanes(type const &a)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const packed = _mm_packs_epi16(_mm_cmpeq_epi16(a.lo, zero), _mm_cmpeq_epi16(a.hi, zero));
+            return static_cast<unsigned int>(_mm_movemask_epi8(packed));
+        }
+
+        static inline void store(uint16_t *p, type const &a)
+        {
+            _mm_store_si128(reinterpret_cast<__m128i *>(p), a.lo);
+            _mm_store_si128(reinterpret_cast<__m128i *>(p + 8), a.hi);
+        }
+
+        static inline unsigned int empty_cells(char const *board, unsigned int row)
+        {
+            // the last row is read from the end of the board, so as not to read past it
+            unsigned int const shift = row == 8 ? 7 : 0;
+            __m128i const cells = _mm_loadu_si128(reinterpret_cast<__m128i const *>(board + row * 9 - shift));
+            unsigned int const bits = static_cast<unsigned int>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(cells, _mm_set1_epi8(propagate::EMPTY))));
+            return (bits >> shift) & 0x1ff;
+        }
+    };
+
+    void scan_sse41(uint16_t const *row_mask, uint16_t const *col_mask, uint16_t const *box_mask,
+                    char const *board, propagate::scan_result &out)
+    {
+        propagate::scan_board<sse41_vec>(row_mask, col_mask, box_mask, board, out);
+    }
+}
+
+propagate::scan_fn propagate::detail::sse41_kernel()
+{
+    return scan_sse41;
+}
+
+#else
+
+propagate::scan_fn propagate::detail::sse41_kernel()
+{
+    return nullptr;
+}
+
+#endif
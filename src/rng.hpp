@@ -0,0 +1,159 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __RNG_HPP__
+#define __RNG_HPP__
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief xoshiro256** pseudo random number generator by Blackman and Vigna.
+ *
+ * 32 bytes of state, a few cycles per number and a period of 2^256-1.
+ * Satisfies UniformRandomBitGenerator, so it works with `std::shuffle` and
+ * the `<random>` distributions.
+ *
+ * `jump()` advances the state by 2^128 steps, so a single seed yields
+ * non-overlapping streams for many threads (see `stream()`).
+ */
+class xoshiro256ss
+{
+public:
+    typedef uint64_t result_type;
+
+    explicit xoshiro256ss(uint64_t seed = 0x5eedULL)
+    {
+        this->seed(seed);
+    }
+
+    /**
+     * @brief Create the `index`-th independent stream derived from `seed`.
+     *
+     * @param seed the common seed
+     * @param index the stream's number, e.g. the thread number
+     * @return xoshiro256ss
+     */
+    static xoshiro256ss stream(uint64_t seed, unsigned int index)
+    {
+        xoshiro256ss rng(seed);
+        for (unsigned int i = 0; i < index; ++i)
+        {
+            rng.jump();
+        }
+        return rng;
+    }
+
+    /**
+     * @brief Initialize the state from a single 64-bit seed via splitmix64.
+     *
+     * Recommended by the authors, because it never produces an all-zero state.
+     */
+    void seed(uint64_t seed)
+    {
+        for (auto &s : s_)
+        {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s = z ^ (z >> 31);
+        }
+    }
+
+    typedef std::array<uint64_t, 4> state_type;
+
+    /**
+     * @brief Get the internal state, e.g. to continue the stream later (see `set_state()`).
+     *
+     */
+    inline state_type const &state() const
+    {
+        return s_;
+    }
+
+    inline void set_state(state_type const &s)
+    {
+        s_ = s;
+    }
+
+    static constexpr result_type min()
+    {
+        return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    inline result_type operator()()
+    {
+        uint64_t const result = rotl(s_[1] * 5, 7) * 9;
+        uint64_t const t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Advance the state by 2^128 calls to `operator()`.
+     *
+     */
+    void jump()
+    {
+        static constexpr std::array<uint64_t, 4> JUMP{
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        std::array<uint64_t, 4> s{0, 0, 0, 0};
+        for (uint64_t jump : JUMP)
+        {
+            for (int b = 0; b < 64; ++b)
+            {
+                if (jump & (1ULL << b))
+                {
+                    s[0] ^= s_[0];
+                    s[1] ^= s_[1];
+                    s[2] ^= s_[2];
+                    s[3] ^= s_[3];
+                }
+                (void)(*this)();
+            }
+        }
+        s_ = s;
+    }
+
+private:
+    static inline uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    state_type s_;
+};
+
+#endif // __RNG_HPP__
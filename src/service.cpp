@@ -0,0 +1,354 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "net.hpp"
+#include "service.hpp"
+
+namespace
+{
+    /**
+     * @brief Split off the first word of `line`.
+     *
+     * @return the word, with leading blanks skipped; empty if there's none
+     */
+    std::string_view next_word(std::string_view &line)
+    {
+        std::size_t const start = line.find_first_not_of(" \t");
+        if (start == std::string_view::npos)
+        {
+            line = std::string_view();
+            return line;
+        }
+        std::size_t end = line.find_first_of(" \t", start);
+        if (end == std::string_view::npos)
+        {
+            end = line.size();
+        }
+        std::string_view const word = line.substr(start, end - start);
+        line.remove_prefix(end);
+        return word;
+    }
+
+    bool parse_number(std::string_view word, int &value)
+    {
+        char const *end = word.data() + word.size();
+        auto const [ptr, ec] = std::from_chars(word.data(), end, value);
+        return ec == std::errc() && ptr == end;
+    }
+
+    bool parse_number(std::string_view word, double &value)
+    {
+        // short enough for the small string buffer, so this doesn't allocate
+        std::string const str(word.substr(0, 15));
+        char *end = nullptr;
+        value = std::strtod(str.c_str(), &end);
+        return !str.empty() && word.size() < 16 && *end == '\0';
+    }
+
+    void append_error(std::string &reply, int rc)
+    {
+        reply += rc == SUDOKU_INVALID_BOARD
+                     ? "error invalid board\n"
+                 : rc == SUDOKU_GAVE_UP
+                     ? "error gave up\n"
+                     : "error invalid argument\n";
+    }
+}
+
+service::service(unsigned int n_contexts, uint64_t seed, sudoku_solver solver)
+{
+    contexts_.reserve(n_contexts);
+    for (unsigned int i = 0; i < n_contexts; ++i)
+    {
+        contexts_.emplace_back(seed + i);
+        contexts_.back().set_solver(solver);
+        idle_.push_back(contexts_.back().get());
+    }
+}
+
+service::~service()
+{
+    stop();
+}
+
+bool service::start(std::string const &address, std::string &error)
+{
+    static std::string const UNIX_PREFIX = "unix:";
+    if (address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0)
+    {
+        if (!listener_.listen_unix(address.substr(UNIX_PREFIX.size()), error))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        std::string host;
+        std::string port;
+        if (!net::parse_address(address, host, port))
+        {
+            error = "invalid address " + address + " (expected unix:PATH or [HOST:]PORT)";
+            return false;
+        }
+        if (!listener_.listen(host, port, error))
+        {
+            return false;
+        }
+    }
+    acceptor_ = std::thread(&service::accept_loop, this);
+    return true;
+}
+
+void service::accept_loop()
+{
+    while (!stopping_.load())
+    {
+        net::connection conn = listener_.accept(100);
+        std::lock_guard<std::mutex> lock(mutex_);
+        // forget clients that have gone
+        for (std::size_t i = 0; i < clients_.size();)
+        {
+            if (clients_[i]->done.load())
+            {
+                clients_[i]->thread.join();
+                clients_[i] = std::move(clients_.back());
+                clients_.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        if (!conn.is_open())
+        {
+            continue;
+        }
+        n_connections_.fetch_add(1, std::memory_order_relaxed);
+        clients_.emplace_back(std::make_unique<client>());
+        client &c = *clients_.back();
+        c.conn = std::move(conn);
+        c.thread = std::thread(&service::serve, this, std::ref(c));
+    }
+}
+
+sudoku_context *service::check_out()
+{
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    pool_changed_.wait(lock, [this]
+                       { return !idle_.empty(); });
+    sudoku_context *ctx = idle_.back();
+    idle_.pop_back();
+    return ctx;
+}
+
+void service::check_in(sudoku_context *ctx)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        idle_.push_back(ctx);
+    }
+    pool_changed_.notify_one();
+}
+
+/**
+ * Reads whatever has arrived, answers all complete lines in it on one
+ * context, and sends the replies with a single write.
+ */
+void service::serve(client &c)
+{
+    static constexpr std::size_t BUFFER_SIZE = 1U << 16;
+    std::unique_ptr<char[]> buffer = std::make_unique<char[]>(BUFFER_SIZE);
+    std::string pending;
+    std::string reply;
+    pending.reserve(BUFFER_SIZE);
+    reply.reserve(BUFFER_SIZE);
+    while (!stopping_.load(std::memory_order_relaxed))
+    {
+        long long const n = c.conn.read_some(buffer.get(), BUFFER_SIZE);
+        if (n <= 0)
+        {
+            break;
+        }
+        pending.append(buffer.get(), static_cast<std::size_t>(n));
+        reply.clear();
+        sudoku_context *ctx = nullptr;
+        std::size_t pos = 0;
+        std::size_t newline;
+        while ((newline = pending.find('\n', pos)) != std::string::npos)
+        {
+            if (ctx == nullptr)
+            {
+                ctx = check_out();
+            }
+            answer(ctx, pending.data() + pos, newline - pos, reply);
+            pos = newline + 1;
+        }
+        if (ctx != nullptr)
+        {
+            check_in(ctx);
+        }
+        pending.erase(0, pos);
+        bool const too_long = pending.size() > MAX_LINE;
+        if (too_long)
+        {
+            reply += "error line too long\n";
+        }
+        if (!reply.empty() && !c.conn.write_all(reply.data(), reply.size()))
+        {
+            break;
+        }
+        if (too_long)
+        {
+            break;
+        }
+    }
+    // closed when the client is forgotten; `stop()` may be shutting it down at the same time
+    c.conn.shutdown();
+    c.done.store(true);
+}
+
+void service::answer(sudoku_context *ctx, char const *data, std::size_t size, std::string &reply)
+{
+    std::string_view line(data, size);
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    std::string_view const command = next_word(line);
+    if (command.empty())
+    {
+        return;
+    }
+    n_requests_.fetch_add(1, std::memory_order_relaxed);
+    std::string_view const arg = next_word(line);
+    std::string_view const arg2 = next_word(line);
+    bool const board_arg = arg.size() == 81 && arg2.empty();
+    if (command == "solve" && board_arg)
+    {
+        char solution[82];
+        int const n = sudoku_solve(ctx, arg.data(), solution);
+        if (n < 0)
+        {
+            append_error(reply, n);
+        }
+        else if (n == 0)
+        {
+            reply += "none\n";
+        }
+        else
+        {
+            reply += "ok ";
+            reply.append(solution, 81);
+            reply += n == 1 ? " 1\n" : " 2\n";
+        }
+    }
+    else if (command == "unique" && board_arg)
+    {
+        int const rc = sudoku_is_unique(ctx, arg.data());
+        if (rc < 0)
+        {
+            append_error(reply, rc);
+        }
+        else
+        {
+            reply += rc == 1 ? "yes\n" : "no\n";
+        }
+    }
+    else if (command == "grade" && board_arg)
+    {
+        sudoku_rating rating;
+        int const rc = sudoku_grade(ctx, arg.data(), &rating);
+        if (rc < 0)
+        {
+            append_error(reply, rc);
+        }
+        else
+        {
+            char number[32];
+            std::snprintf(number, sizeof(number), "ok %.1f ", rating.rating);
+            reply += number;
+            reply += rating.technique_name;
+            reply += '\n';
+        }
+    }
+    else if (command == "generate" && !arg.empty() && next_word(line).empty())
+    {
+        int empty_cells = 0;
+        double min_rating = 0;
+        if (!parse_number(arg, empty_cells) || (!arg2.empty() && !parse_number(arg2, min_rating)))
+        {
+            reply += "error usage: generate EMPTY [RATING]\n";
+            return;
+        }
+        char board[82];
+        int const rc = sudoku_generate(ctx, empty_cells, min_rating, GENERATE_ATTEMPTS, board);
+        if (rc < 0)
+        {
+            append_error(reply, rc);
+        }
+        else
+        {
+            reply += "ok ";
+            reply.append(board, 81);
+            reply += '\n';
+        }
+    }
+    else if (command == "ping" && arg.empty())
+    {
+        reply += "pong\n";
+    }
+    else if (command == "solve" || command == "unique" || command == "grade")
+    {
+        reply += "error usage: ";
+        reply += command;
+        reply += " BOARD\n";
+    }
+    else
+    {
+        reply += "error unknown command\n";
+    }
+}
+
+void service::stop()
+{
+    stopping_.store(true);
+    if (acceptor_.joinable())
+    {
+        acceptor_.join();
+    }
+    listener_.close();
+    // with the acceptor gone, the list of clients doesn't change anymore
+    for (auto &c : clients_)
+    {
+        c->conn.shutdown();
+        if (c->thread.joinable())
+        {
+            c->thread.join();
+        }
+    }
+    clients_.clear();
+}
@@ -0,0 +1,135 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __SERVICE_HPP__
+#define __SERVICE_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libsudoku.h"
+#include "net.hpp"
+
+/**
+ * @brief Answers requests for solving, checking, grading and generating boards, one per line.
+ *
+ * Requests and replies are single lines of text:
+ *
+ *     solve BOARD              ok SOLUTION N | none
+ *     unique BOARD             yes | no
+ *     grade BOARD              ok RATING TECHNIQUE
+ *     generate EMPTY [RATING]  ok BOARD
+ *     ping                     pong
+ *
+ * where BOARD is 81 chars as accepted by `sudoku_solve()`, and N is the number
+ * of solutions, 1 or 2. A request that can't be answered gets
+ * "error REASON". Clients may send any number of requests without waiting;
+ * the replies come in the same order.
+ *
+ * Each connection is served by a thread of its own. The requests are
+ * answered on warm `sudoku_context`s, checked out of a fixed pool for each
+ * batch of requests that arrived together, so answering allocates nothing
+ * beyond growing the connection's buffers.
+ */
+class service
+{
+public:
+    /**
+     * @brief Longest request accepted; a client sending a longer line is disconnected.
+     *
+     */
+    static constexpr std::size_t MAX_LINE = 1024;
+
+    /**
+     * @brief Solved grids dug out for a "generate" request before it's answered with "error gave up".
+     *
+     */
+    static constexpr unsigned int GENERATE_ATTEMPTS = 1000;
+
+    /**
+     * @brief Make `n_contexts` contexts, seeded from `seed`, that solve with `solver`.
+     *
+     */
+    service(unsigned int n_contexts, uint64_t seed, sudoku_solver solver);
+    ~service();
+    service(service const &) = delete;
+    service &operator=(service const &) = delete;
+
+    /**
+     * @brief Start listening at `address`, "unix:PATH" or "[HOST:]PORT".
+     *
+     * @return false if it failed, with the reason in `error`
+     */
+    bool start(std::string const &address, std::string &error);
+
+    /**
+     * @brief Stop listening, close all connections and wait for their threads.
+     *
+     */
+    void stop();
+
+    inline unsigned long long requests() const
+    {
+        return n_requests_.load(std::memory_order_relaxed);
+    }
+
+    inline unsigned long long connections() const
+    {
+        return n_connections_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct client
+    {
+        net::connection conn;
+        std::atomic<bool> done{false};
+        std::thread thread;
+    };
+
+    void accept_loop();
+    void serve(client &c);
+    void answer(sudoku_context *ctx, char const *line, std::size_t size, std::string &reply);
+
+    sudoku_context *check_out();
+    void check_in(sudoku_context *ctx);
+
+    std::vector<libsudoku::context> contexts_;
+    std::vector<sudoku_context *> idle_;
+    std::mutex pool_mutex_;
+    std::condition_variable pool_changed_;
+    net::listener listener_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<unsigned long long> n_requests_{0};
+    std::atomic<unsigned long long> n_connections_{0};
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<client>> clients_;
+    std::thread acceptor_;
+};
+
+#endif // __SERVICE_HPP__
@@ -0,0 +1,129 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __SPSC_QUEUE_HPP__
+#define __SPSC_QUEUE_HPP__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Assumed size of a cache line, used to keep hot atomics apart.
+ *
+ */
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Lock-free bounded ring buffer for exactly one producer and one consumer thread.
+ *
+ * Each side keeps a private copy of the other side's index and only
+ * reloads the shared one when the queue looks full or empty, so in the
+ * common case a push or pop touches no cache line owned by the other thread.
+ *
+ * @tparam T element type
+ * @tparam Capacity number of slots, must be a power of 2
+ */
+template <typename T, std::size_t Capacity>
+class spsc_queue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+    spsc_queue() = default;
+    spsc_queue(spsc_queue const &) = delete;
+    spsc_queue &operator=(spsc_queue const &) = delete;
+
+    /**
+     * @brief Append an element. Must only be called by the producer.
+     *
+     * @param item the element to append
+     * @return true if the element has been appended
+     * @return false if the queue is full
+     */
+    bool try_push(T const &item)
+    {
+        std::size_t const head = head_.load(std::memory_order_relaxed);
+        if (head - tail_cache_ == Capacity)
+        {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ == Capacity)
+            {
+                return false;
+            }
+        }
+        buffer_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest element. Must only be called by the consumer.
+     *
+     * @param[out] item the element taken
+     * @return true if an element has been taken
+     * @return false if the queue is empty
+     */
+    bool try_pop(T &item)
+    {
+        std::size_t const tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_cache_)
+        {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail == head_cache_)
+            {
+                return false;
+            }
+        }
+        item = buffer_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Check if the queue is empty. Only exact when called by the consumer.
+     *
+     */
+    inline bool empty() const
+    {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+private:
+    /**
+     * @brief Next slot to write, owned by the producer.
+     *
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_{0};
+
+    /**
+     * @brief Next slot to read, owned by the consumer.
+     *
+     */
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_{0};
+
+    alignas(CACHE_LINE_SIZE) std::array<T, Capacity> buffer_;
+};
+
+#endif // __SPSC_QUEUE_HPP__
@@ -0,0 +1,210 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <array>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "stats_writer.hpp"
+
+namespace
+{
+    /**
+     * @brief A per-thread counter and how to read it from a sink.
+     *
+     */
+    struct metric
+    {
+        char const *name;
+        char const *help;
+        unsigned long long (*get)(board_sink const &);
+    };
+
+    std::array<metric, 12> const METRICS{{
+        {"games", "Boards delivered, valid or not.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_games.load(std::memory_order_relaxed)); }},
+        {"valid", "Valid boards delivered, including variants made by --expand.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_valid.load(std::memory_order_relaxed)); }},
+        {"discarded", "Boards discarded for having too few empty cells.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_discarded.load(std::memory_order_relaxed)); }},
+        {"duplicates", "Valid boards dropped as duplicates.", [](board_sink const &s)
+         { return s.n_duplicates.load(std::memory_order_relaxed); }},
+        {"too_easy", "Valid boards dropped for being rated below --min-rating.", [](board_sink const &s)
+         { return s.n_too_easy.load(std::memory_order_relaxed); }},
+        {"solver_nodes", "Search tree nodes visited by the backtrackers.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_nodes.load(std::memory_order_relaxed)); }},
+        {"is_safe_calls", "Checks whether a digit may be placed in a cell.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_is_safe.load(std::memory_order_relaxed)); }},
+        {"unique_checks", "Checks for a unique or any solution.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_unique_checks.load(std::memory_order_relaxed)); }},
+        {"failed_removals", "Cells that had to be restored while digging.", [](board_sink const &s)
+         { return s.dig.n_failed_removals.load(std::memory_order_relaxed); }},
+        {"grids_dug", "Solved grids dug out.", [](board_sink const &s)
+         { return s.dig.n_grids.load(std::memory_order_relaxed); }},
+        {"grids_abandoned", "Solved grids abandoned before reaching the target.", [](board_sink const &s)
+         { return s.dig.n_abandoned.load(std::memory_order_relaxed); }},
+        {"heap_allocations", "Heap allocations made after delivering the first board.", [](board_sink const &s)
+         { return static_cast<unsigned long long>(s.perf.n_allocs.load(std::memory_order_relaxed)); }},
+    }};
+
+    inline double phase_seconds(board_sink const &sink, perf_counters::phase p)
+    {
+        return static_cast<double>(sink.perf.phase_nanos[p].load(std::memory_order_relaxed)) * 1e-9;
+    }
+}
+
+stats_writer::format stats_writer::format_for(std::string const &filename)
+{
+    return std::filesystem::path(filename).extension() == ".prom"
+               ? format::prometheus
+               : format::json;
+}
+
+stats_writer::stats_writer(std::string const &filename, format fmt)
+    : filename_(filename), format_(fmt)
+{
+    if (filename_ != "-" && format_ == format::json)
+    {
+        out_.open(filename_, std::ios::app);
+    }
+}
+
+void stats_writer::write(std::vector<std::unique_ptr<board_sink>> const &sinks, saved_counts const &saved, double elapsed)
+{
+    std::ostringstream os;
+    os.imbue(std::locale::classic());
+    if (format_ == format::json)
+    {
+        write_json(os, sinks, saved, elapsed);
+    }
+    else
+    {
+        write_prometheus(os, sinks, saved, elapsed);
+    }
+    std::string const text = os.str();
+    if (filename_ == "-")
+    {
+        std::cout << text << std::flush;
+    }
+    else if (format_ == format::json)
+    {
+        out_ << text << std::flush;
+    }
+    else
+    {
+        // replace the file in one go, so readers never see half a snapshot
+        std::string const tmp_filename = filename_ + ".tmp";
+        {
+            std::ofstream out(tmp_filename, std::ios::trunc);
+            out << text;
+            if (!out.good())
+            {
+                out_.setstate(std::ios::failbit);
+                return;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp_filename, filename_, ec);
+        if (ec)
+        {
+            out_.setstate(std::ios::failbit);
+        }
+    }
+}
+
+void stats_writer::write_json(std::ostream &os, std::vector<std::unique_ptr<board_sink>> const &sinks, saved_counts const &saved, double elapsed) const
+{
+    std::array<unsigned long long, METRICS.size()> totals{};
+    std::array<double, perf_counters::PHASE_COUNT> total_seconds{};
+    std::ostringstream threads;
+    threads.imbue(std::locale::classic());
+    threads << std::fixed << std::setprecision(6);
+    for (std::size_t i = 0; i < sinks.size(); ++i)
+    {
+        threads << (i == 0 ? "{" : ",{") << "\"thread\":" << i;
+        for (std::size_t m = 0; m < METRICS.size(); ++m)
+        {
+            unsigned long long const value = METRICS[m].get(*sinks[i]);
+            totals[m] += value;
+            threads << ",\"" << METRICS[m].name << "\":" << value;
+        }
+        threads << ",\"phase_seconds\":{";
+        for (unsigned int p = 0; p < perf_counters::PHASE_COUNT; ++p)
+        {
+            double const seconds = phase_seconds(*sinks[i], static_cast<perf_counters::phase>(p));
+            total_seconds[p] += seconds;
+            threads << (p == 0 ? "\"" : ",\"") << perf_counters::phase_name(static_cast<perf_counters::phase>(p)) << "\":" << seconds;
+        }
+        threads << "}}";
+    }
+    os << std::fixed << std::setprecision(6)
+       << "{\"elapsed_seconds\":" << elapsed
+       << ",\"saved_games\":" << saved.n_games
+       << ",\"saved_valid\":" << saved.n_valid
+       << ",\"total\":{";
+    for (std::size_t m = 0; m < METRICS.size(); ++m)
+    {
+        os << (m == 0 ? "\"" : ",\"") << METRICS[m].name << "\":" << totals[m];
+    }
+    os << ",\"phase_seconds\":{";
+    for (unsigned int p = 0; p < perf_counters::PHASE_COUNT; ++p)
+    {
+        os << (p == 0 ? "\"" : ",\"") << perf_counters::phase_name(static_cast<perf_counters::phase>(p)) << "\":" << total_seconds[p];
+    }
+    os << "}},\"threads\":[" << threads.str() << "]}\n";
+}
+
+void stats_writer::write_prometheus(std::ostream &os, std::vector<std::unique_ptr<board_sink>> const &sinks, saved_counts const &saved, double elapsed) const
+{
+    os << std::fixed << std::setprecision(6)
+       << "# HELP sudoku_elapsed_seconds Time since generating started.\n"
+       << "# TYPE sudoku_elapsed_seconds gauge\n"
+       << "sudoku_elapsed_seconds " << elapsed << "\n"
+       << "# HELP sudoku_saved_games_total Boards saved or reported by the writer.\n"
+       << "# TYPE sudoku_saved_games_total counter\n"
+       << "sudoku_saved_games_total " << saved.n_games << "\n"
+       << "# HELP sudoku_saved_valid_total Valid boards saved by the writer.\n"
+       << "# TYPE sudoku_saved_valid_total counter\n"
+       << "sudoku_saved_valid_total " << saved.n_valid << "\n";
+    for (metric const &m : METRICS)
+    {
+        os << "# HELP sudoku_" << m.name << "_total " << m.help << "\n"
+           << "# TYPE sudoku_" << m.name << "_total counter\n";
+        for (std::size_t i = 0; i < sinks.size(); ++i)
+        {
+            os << "sudoku_" << m.name << "_total{thread=\"" << i << "\"} " << m.get(*sinks[i]) << "\n";
+        }
+    }
+    os << "# HELP sudoku_phase_seconds_total Time spent in each phase of generating.\n"
+       << "# TYPE sudoku_phase_seconds_total counter\n";
+    for (std::size_t i = 0; i < sinks.size(); ++i)
+    {
+        for (unsigned int p = 0; p < perf_counters::PHASE_COUNT; ++p)
+        {
+            os << "sudoku_phase_seconds_total{thread=\"" << i << "\",phase=\""
+               << perf_counters::phase_name(static_cast<perf_counters::phase>(p)) << "\"} "
+               << phase_seconds(*sinks[i], static_cast<perf_counters::phase>(p)) << "\n";
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __STATS_WRITER_HPP__
+#define __STATS_WRITER_HPP__
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "generators.hpp"
+
+/**
+ * @brief Writes snapshots of the generator threads' counters in machine-readable form.
+ *
+ * Two formats are supported: `json` appends one JSON object per line and
+ * snapshot, `prometheus` writes the Prometheus text exposition format,
+ * replacing the previous snapshot, so the file can be picked up by
+ * node_exporter's textfile collector. The format is derived from the file name:
+ * `.prom` means Prometheus. The file name `-` means stdout.
+ */
+class stats_writer
+{
+public:
+    enum class format
+    {
+        json,
+        prometheus
+    };
+
+    /**
+     * @brief Totals the writer thread keeps, as opposed to the generator threads.
+     *
+     */
+    struct saved_counts
+    {
+        long long n_games;
+        long long n_valid;
+    };
+
+    stats_writer(std::string const &filename, format fmt);
+
+    stats_writer(stats_writer const &) = delete;
+    stats_writer &operator=(stats_writer const &) = delete;
+
+    /**
+     * @brief Write a snapshot of all counters.
+     *
+     * @param sinks the generator threads' sinks, whose counters may still be changing
+     * @param saved what has been saved so far
+     * @param elapsed seconds since generating started
+     */
+    void write(std::vector<std::unique_ptr<board_sink>> const &sinks, saved_counts const &saved, double elapsed);
+
+    inline bool good() const
+    {
+        return filename_ == "-" || !out_.fail();
+    }
+
+    static format format_for(std::string const &filename);
+
+private:
+    void write_json(std::ostream &os, std::vector<std::unique_ptr<board_sink>> const &sinks, saved_counts const &saved, double elapsed) const;
+    void write_prometheus(std::ostream &os, std::vector<std::unique_ptr<board_sink>> const &sinks, saved_counts const &saved, double elapsed) const;
+
+    std::string filename_;
+    format format_;
+    std::ofstream out_;
+};
+
+#endif // __STATS_WRITER_HPP__
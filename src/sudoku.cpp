@@ -33,9 +33,3 @@ std::ostream &operator<<(std::ostream &os, const sudoku::board_t &board)
     }
     return os;
 }
-
-std::ostream &operator<<(std::ostream &os, const sudoku &game)
-{
-    os << game.board_;
-    return os;
-}
@@ -24,70 +24,232 @@
 #define __SUDOKU_HPP__
 
 #include <cassert>
+#include <cstdint>
+#include <bit>
 #include <string>
 #include <array>
+#include <atomic>
+#include <type_traits>
 #include <vector>
-#include <random>
 #include <algorithm>
+#include <limits>
 #include <iostream>
 #include <ctime>
-#include <vector>
 
+#include "dlx.hpp"
+#include "logging.hpp"
+#include "propagate.hpp"
+#include "rng.hpp"
 #include "util.hpp"
 
-class sudoku
+/**
+ * @brief What all board sizes have in common.
+ *
+ */
+struct sudoku_base
+{
+    typedef xoshiro256ss rng_t;
+
+    /**
+     * @brief How the solvers search for solutions.
+     *
+     * `first_free` backtracks on the first empty cell in row-major order.
+     * `mrv` places all naked singles first, then backtracks on the
+     * empty cell with the minimum number of remaining values.
+     * `dlx` hands the board to the thread's Dancing Links solver (see `dlx`).
+     */
+    enum class search_mode
+    {
+        first_free,
+        mrv,
+        dlx
+    };
+
+    /**
+     * @brief How much work the backtrackers did.
+     *
+     * Plain counters, only touched by the thread using the board. The DLX
+     * solver keeps no counters, so in `search_mode::dlx` only uniqueness
+     * checks are counted.
+     */
+    struct search_counters
+    {
+        /**
+         * @brief Nodes of the search tree visited.
+         *
+         */
+        uint64_t n_nodes{0};
+        /**
+         * @brief Calls to `is_safe()` made by the backtrackers.
+         *
+         */
+        uint64_t n_is_safe{0};
+        /**
+         * @brief Calls to `has_one_clear_solution()` and `has_solution()`.
+         *
+         */
+        uint64_t n_unique_checks{0};
+    };
+
+    /**
+     * @brief Value of an empty field
+     *
+     */
+    static constexpr char EMPTY = '0';
+
+    /**
+     * @brief Get the calling thread's fallback generator.
+     *
+     * Seeded once per thread from `util::make_seed()`, and shared by boards of all sizes.
+     *
+     * @return rng_t&
+     */
+    static rng_t &thread_rng()
+    {
+        thread_local rng_t rng(static_cast<uint64_t>(util::make_seed()));
+        return rng;
+    }
+};
+
+/**
+ * @brief A Sudoku board and its solvers, for boxes of `N` x `N` cells.
+ *
+ * The board has `SIZE` = `N` * `N` rows, columns and digits and
+ * `CELLS` cells. Digits are written '1' to '9', then 'A', 'B', ...,
+ * so a 16x16 board uses '1' to '9' and 'A' to 'G'. Cell and box
+ * indexes, masks and loop bounds are compile-time constants, so each
+ * size gets code of its own; the classic 9x9 board is `sudoku`.
+ * Only 9x9 boards can use the DLX solver (see `dlx`); other sizes fall
+ * back to `search_mode::mrv`.
+ */
+template <unsigned int N>
+class basic_sudoku : public sudoku_base
 {
 public:
-    typedef std::array<char, 81> board_t;
+    static_assert(N >= 2 && N <= 5, "boxes must be 2x2 to 5x5");
+
+    static constexpr unsigned int BOX_SIZE = N;
+    static constexpr unsigned int SIZE = N * N;
+    static constexpr unsigned int CELLS = SIZE * SIZE;
+
+    typedef std::array<char, CELLS> board_t;
+
+    /**
+     * @brief Bit mask of digits, wide enough for `SIZE` of them.
+     *
+     */
+    typedef std::conditional_t<(SIZE <= 16), uint16_t, uint32_t> mask_t;
+
+    /**
+     * @brief Index of a cell, as stored in the trail.
+     *
+     */
+    typedef std::conditional_t<(CELLS <= 256), uint8_t, uint16_t> cell_t;
+
+    /**
+     * @brief Fewer givens than this can't make a Sudoku with one clear solution.
+     *
+     */
+    static constexpr unsigned int MIN_GIVENS = N == 3 ? 17U : (N == 2 ? 4U : SIZE - 1);
+
+    /**
+     * @brief Create an empty board.
+     *
+     * Construction doesn't touch any RNG, so it's cheap enough for hot loops.
+     * The guesses are tried in ascending order until `reset()` or
+     * `shuffle_guesses()` is called.
+     */
+    basic_sudoku()
+    {
+        init();
+        clear();
+    }
 
-    sudoku()
+    /**
+     * @brief Create an empty board drawing its random numbers from `rng`.
+     *
+     * @param rng the caller-owned generator; must outlive the board
+     */
+    explicit basic_sudoku(rng_t &rng)
+        : rng_(&rng)
     {
         init();
         reset();
     }
 
-    explicit sudoku(std::string const &board_str)
-        : sudoku()
+    explicit basic_sudoku(std::string const &board_str)
+        : basic_sudoku()
+    {
+        assign(board_str);
+    }
+
+    explicit basic_sudoku(board_t const &board)
+        : basic_sudoku()
+    {
+        assign(board);
+    }
+
+    /**
+     * @brief Replace the board, keeping RNG and search mode.
+     *
+     * This is much cheaper than constructing a new `sudoku`.
+     *
+     * @param board the new board
+     */
+    void assign(board_t const &board)
+    {
+        board_ = board;
+        trail_size_ = 0;
+        update_masks();
+    }
+
+    /**
+     * @brief Replace the board with one serialized as `CELLS` chars.
+     *
+     * '.' is accepted for an empty cell.
+     *
+     * @param board_str the new board
+     */
+    void assign(std::string const &board_str)
     {
-        assert(board_.size() == 81U);
-        for (unsigned int i = 0; i < 81U; ++i)
+        assert(board_str.size() >= CELLS);
+        for (unsigned int i = 0; i < CELLS; ++i)
         {
             board_[i] = board_str.at(i) == '.'
                             ? EMPTY
                             : board_str.at(i);
         }
-    }
-
-    explicit sudoku(board_t const &board)
-        : sudoku()
-    {
-        this->board_ = board;
+        trail_size_ = 0;
+        update_masks();
     }
 
     void init()
     {
-        rng_.seed(static_cast<uint32_t>(util::make_seed()));
-        // warmup RNG
-        for (int i = 0; i < 10'000; ++i)
-        {
-            (void)rng_();
-        }
-        for (unsigned int i = 0; i < 9U; ++i)
+        for (unsigned int i = 0; i < SIZE; ++i)
         {
-            guess_num_[i] = static_cast<char>(i + '1');
+            guess_num_[i] = digit(i);
         }
     }
 
     void reset()
     {
-        std::fill(board_.begin(), board_.end(), EMPTY);
-        solved_boards_.clear();
+        clear();
         shuffle_guesses();
     }
 
     inline void shuffle_guesses()
     {
-        std::shuffle(guess_num_.begin(), guess_num_.end(), rng_);
+        std::shuffle(guess_num_.begin(), guess_num_.end(), rng());
+    }
+
+    /**
+     * @brief Draw random numbers from a caller-owned generator from now on.
+     *
+     * @param rng the generator; must outlive the board
+     */
+    inline void set_rng(rng_t &rng)
+    {
+        rng_ = &rng;
     }
 
     inline char const &guess_num(unsigned int idx) const
@@ -95,9 +257,71 @@ public:
         return guess_num_.at(idx);
     }
 
+    /**
+     * @brief Select the search strategy used by the solvers.
+     *
+     * @param mode the new search mode; `dlx` means `mrv` unless the board is 9x9
+     */
+    inline void set_search_mode(search_mode mode)
+    {
+        search_mode_ = N != 3 && mode == search_mode::dlx ? search_mode::mrv : mode;
+    }
+
+    inline search_mode get_search_mode() const
+    {
+        return search_mode_;
+    }
+
+    /**
+     * @brief Let another thread abort a running search.
+     *
+     * The backtrackers return as soon as they see the flag set, `solve()`
+     * as if the visitor had stopped the search. Results of an aborted
+     * search are meaningless and must be discarded.
+     *
+     * @param flag the flag to watch, or nullptr to never abort
+     */
+    inline void set_abort_flag(std::atomic<bool> const *flag)
+    {
+        abort_ = flag;
+    }
+
+    /**
+     * @brief Give up searching once more than `limit` further nodes have been visited.
+     *
+     * Like an abort, hitting the limit leaves meaningless results, until
+     * the next call lifts or renews the limit. Randomly filled boards
+     * larger than 9x9 now and then send the backtrackers down hopeless
+     * branches for ages; starting over is much cheaper.
+     *
+     * @param limit the number of nodes, or 0 for no limit
+     */
+    inline void set_node_limit(uint64_t limit)
+    {
+        node_limit_ = limit != 0 ? counters_.n_nodes + limit : std::numeric_limits<uint64_t>::max();
+    }
+
+    /**
+     * @brief Get the work counted since the last call, and start counting anew.
+     *
+     */
+    inline search_counters take_counters()
+    {
+        search_counters const counters = counters_;
+        counters_ = search_counters{};
+        if (node_limit_ != std::numeric_limits<uint64_t>::max())
+        {
+            node_limit_ -= std::min(node_limit_, counters.n_nodes);
+        }
+        return counters;
+    }
+
     /**
      * @brief Find empty cell.
      *
+     * In `search_mode::mrv` the empty cell with the fewest candidates is returned.
+     * Ties go to the first such cell in row-major order.
+     *
      * @param[out] row the row of the cell found, if any
      * @param[out] col the columns of the cell found, if any
      * @return true if an empty cell could be found
@@ -105,12 +329,16 @@ public:
      */
     bool find_free_cell(unsigned int &row, unsigned int &col)
     {
-        for (unsigned int i = 0; i < 81; ++i)
+        if (search_mode_ == search_mode::mrv)
+        {
+            return find_mrv_cell(row, col);
+        }
+        for (unsigned int i = 0; i < CELLS; ++i)
         {
-            if (board_.at(i) == EMPTY)
+            if (board_[i] == EMPTY)
             {
-                row = i / 9;
-                col = i % 9;
+                row = i / SIZE;
+                col = i % SIZE;
                 return true;
             }
         }
@@ -120,26 +348,31 @@ public:
     /**
      * @brief Count the number of solutions.
      *
-     * This is a recursive function acting as a solver, implemented as a backtracker.
+     * The backtracker runs on the board's explicit search stack (see `step()`).
      *
-     * @param[out] n the number of solutions
+     * @param[in,out] n incremented for every solution
      */
     void count_solutions(int &n)
     {
-        unsigned int row, col;
-        bool some_free = find_free_cell(row, col);
-        if (!some_free)
+        if constexpr (N == 3)
         {
-            ++n;
-            return;
+            if (search_mode_ == search_mode::dlx)
+            {
+                n += dlx::local().count(board_, std::numeric_limits<int>::max());
+                return;
+            }
         }
-        for (unsigned int i = 0; i < 9; ++i)
+        start_search();
+        while (true)
         {
-            if (is_safe(row, col, guess_num_[i]))
+            step_result const result = step();
+            if (result == step_result::solution)
             {
-                set(row, col, guess_num_[i]);
-                count_solutions(n);
-                set(row, col, EMPTY); // backtrack
+                ++n;
+            }
+            else if (result != step_result::running)
+            {
+                return;
             }
         }
     }
@@ -159,28 +392,37 @@ public:
     /**
      * @brief Determine if Sudoku has more than one solution.
      *
-     * This is a recursive function acting as a solver, implemented as a backtracker.
+     * The backtracker runs on the board's explicit search stack (see `step()`).
+     * The search stops as soon as a second solution is found.
      *
-     * @param[out] n the number of solutions
+     * @param[in,out] n incremented for every solution, up to 2
+     * @return true if exactly one solution has been found
      */
     bool count_solutions_limited(int &n)
     {
-        unsigned int row, col;
-        bool some_free = find_free_cell(row, col);
-        if (!some_free)
+        if constexpr (N == 3)
         {
-            return ++n > 1;
+            if (search_mode_ == search_mode::dlx)
+            {
+                n += n < 2 ? dlx::local().count(board_, 2 - n) : 0;
+                return n == 1;
+            }
         }
-        for (unsigned int i = 0; i < 9; ++i)
+        start_search();
+        while (n < 2)
         {
-            if (is_safe(row, col, guess_num_[i]))
+            step_result const result = step();
+            if (result == step_result::solution)
+            {
+                ++n;
+            }
+            else if (result != step_result::running)
             {
-                set(row, col, guess_num_[i]);
-                count_solutions_limited(n);
-                set(row, col, EMPTY); // backtrack
+                return n == 1;
             }
         }
-        return n == 1;
+        end_search();
+        return false;
     }
 
     /**
@@ -190,24 +432,47 @@ public:
      */
     inline bool has_one_clear_solution()
     {
+        ++counters_.n_unique_checks;
         int n = 0;
         return count_solutions_limited(n);
     }
 
+    /**
+     * @brief Check if Sudoku has any solution at all.
+     *
+     * The search stops at the first solution. The board is left unchanged.
+     *
+     * @return true if there's at least one solution, false otherwise.
+     */
+    inline bool has_solution()
+    {
+        ++counters_.n_unique_checks;
+        if constexpr (N == 3)
+        {
+            if (search_mode_ == search_mode::dlx)
+            {
+                return dlx::local().count(board_, 1) > 0;
+            }
+        }
+        auto stop = [](board_t const &)
+        { return false; };
+        return !visit_solutions(stop);
+    }
+
     /** WIP */
     void random_fill()
     {
-        std::array<unsigned char, 81> unvisited;
-        for (unsigned char i = 0; i < 81; ++i)
+        std::array<cell_t, CELLS> unvisited;
+        for (unsigned int i = 0; i < CELLS; ++i)
         {
-            unvisited[i] = i;
+            unvisited[i] = static_cast<cell_t>(i);
         }
-        while (true)
+        while (!aborted())
         {
-            std::shuffle(unvisited.begin(), unvisited.end(), rng_);
-            for (unsigned int i = 0; i < 81; ++i)
+            std::shuffle(unvisited.begin(), unvisited.end(), rng());
+            for (unsigned int i = 0; i < CELLS && !aborted(); ++i)
             {
-                std::cout << '.' << std::flush;
+                logging::message(logging::debug) << '.';
                 auto idx = unvisited.at(i);
                 shuffle_guesses();
                 for (char num : guess_num_)
@@ -215,71 +480,235 @@ public:
                     if (is_safe(idx, num))
                     {
                         set(idx, num);
-                        if (i >= 17 && has_one_clear_solution())
+                        if (i >= MIN_GIVENS && has_one_clear_solution())
                         {
-                            std::cout << "Solving ..." << std::flush;
-                            solve();
                             return;
                         }
+                        if (has_solution())
+                        {
+                            // keep the digit
+                            break;
+                        }
                         set(idx, EMPTY);
                     }
-                    std::cout << num << std::flush;
+                    logging::message(logging::debug) << num;
                 }
             }
-            std::cout << "**RETRY**" << std::flush;
+            logging::message(logging::debug) << "**RETRY**";
         }
     }
 
     /**
-     * @brief Solve Sudoku.
+     * @brief Solve Sudoku, handing each solution to a visitor as soon as it is found.
      *
-     * This is a recursive function implementing a backtracking algorithm.
+     * The backtracker runs on the board's explicit search stack (see `step()`).
+     * Solutions aren't stored, so enumerating millions of them takes constant memory.
+     * The board is restored when the function returns.
      *
-     * @return true if there's at least one empty cell
-     * @return false if no empty cell left, thus Sudoku is solved
+     * @param on_solution called as `bool(board_t const &)` for every solution;
+     *        return false to stop the search
+     * @return true if all solutions have been visited
+     * @return false if the visitor stopped the search
      */
-    bool solve()
+    template <typename Visitor>
+    bool solve(Visitor &&on_solution)
     {
-        unsigned int row, col;
-        bool some_free = find_free_cell(row, col);
-        if (!some_free)
+        if constexpr (N == 3)
         {
-            solved_boards_.push_back(board_);
-            return true;
-        }
-        for (unsigned int i = 0; i < 9; ++i)
-        {
-            if (is_safe(row, col, guess_num_[i]))
+            if (search_mode_ == search_mode::dlx)
             {
-                set(row, col, guess_num_[i]);
-                solve();
-                set(row, col, EMPTY); // backtrack
+                bool stopped = false;
+                dlx::local_enumerator().search(board_, std::numeric_limits<int>::max(), [&on_solution, &stopped](board_t const &solution)
+                                               {
+                                                   stopped = !on_solution(solution);
+                                                   return !stopped; });
+                return !stopped;
             }
         }
-        return false;
+        return visit_solutions(on_solution);
     }
 
+    /**
+     * @brief Complete the board to its first solution.
+     *
+     * The backtracker runs on the board's explicit search stack (see `step()`).
+     *
+     * @return true if the board has been solved, false if it has no solution
+     *         and is unchanged
+     */
     bool solve_single()
     {
-        unsigned int row, col;
-        bool some_free = find_free_cell(row, col);
-        if (!some_free)
+        if constexpr (N == 3)
         {
-            return true;
+            if (search_mode_ == search_mode::dlx)
+            {
+                if (!dlx::local().solve_single(board_))
+                {
+                    return false;
+                }
+                update_masks();
+                return true;
+            }
+        }
+        start_search();
+        while (true)
+        {
+            step_result const result = step();
+            if (result == step_result::solution)
+            {
+                // keep the solution, and the singles placed on the way
+                trail_size_ = stack_.frames[0].mark;
+                stack_.size = 0;
+                return true;
+            }
+            if (result != step_result::running)
+            {
+                return false;
+            }
         }
-        for (size_t i = 0; i < 9; ++i)
+    }
+
+    /**
+     * @brief A level of the search (see `step()`).
+     *
+     * `cell` is the cell being guessed, or `CELLS` for a solution the
+     * search is parked on. `next_guess` indexes the guess to try next, and
+     * `mark` is the trail size before the level's singles were placed.
+     */
+    struct search_frame
+    {
+        uint16_t cell;
+        uint16_t mark;
+        uint8_t next_guess;
+    };
+
+    /**
+     * @brief The explicit stack of the search.
+     *
+     * One level per guessed cell, so it never needs more than `CELLS` + 1
+     * frames and holds them in place. Each board has one, so searching
+     * never allocates.
+     */
+    struct search_stack
+    {
+        std::array<search_frame, CELLS + 1> frames;
+        unsigned int size{0};
+        /**
+         * @brief true if the next step enters the node below the top frame's guess
+         *
+         */
+        bool entering{false};
+    };
+
+    /**
+     * @brief What a `step()` of the search ended with.
+     *
+     * After `solution` the board holds the solution found until the next
+     * step. After `exhausted` or `aborted` the search is over and the board
+     * is back as it was.
+     */
+    enum class step_result
+    {
+        running,
+        solution,
+        exhausted,
+        aborted
+    };
+
+    /**
+     * @brief Start searching the current board one node at a time.
+     *
+     * All backtrackers but DLX run this resumable search. Driven by hand,
+     * it lets many searches be interleaved (see `basic_batch_solver`).
+     * `search_mode::dlx` is not supported. Any search started before is
+     * abandoned without restoring the board.
+     */
+    inline void start_search()
+    {
+        assert(search_mode_ != search_mode::dlx);
+        stack_.size = 0;
+        stack_.entering = true;
+    }
+
+    /**
+     * @brief Visit the next node of the search started by `start_search()`.
+     *
+     * Nodes are visited depth-first, guessing digits in the order of
+     * `guess_num()`, and naked singles are placed first in `search_mode::mrv`.
+     *
+     * @return step_result `solution` if the node visited completes the
+     *         board, `exhausted` if there are no nodes left, `aborted` if
+     *         the search has been aborted (see `set_abort_flag()` and
+     *         `set_node_limit()`), `running` otherwise
+     */
+    step_result step()
+    {
+        while (true)
         {
-            if (is_safe(row, col, guess_num_[i]))
+            if (stack_.entering)
             {
-                set(row, col, guess_num_[i]);
-                if (solve_single())
+                stack_.entering = false;
+                ++counters_.n_nodes;
+                unsigned int const mark = trail_size_;
+                if (!propagate_singles())
                 {
-                    return true;
+                    undo(mark);
+                    return step_result::running;
                 }
-                set(row, col, EMPTY); // backtrack
+                unsigned int row, col;
+                bool const some_free = find_free_cell(row, col);
+                stack_.frames[stack_.size++] = search_frame{
+                    static_cast<uint16_t>(some_free ? row * SIZE + col : CELLS), static_cast<uint16_t>(mark), 0};
+                return some_free ? step_result::running : step_result::solution;
             }
+            if (stack_.size == 0)
+            {
+                return step_result::exhausted;
+            }
+            if (aborted())
+            {
+                end_search();
+                return step_result::aborted;
+            }
+            search_frame &top = stack_.frames[stack_.size - 1];
+            if (top.cell != CELLS)
+            {
+                set(top.cell, EMPTY); // backtrack
+                unsigned int i = top.next_guess;
+                while (i < SIZE && !is_safe(top.cell, guess_num_[i]))
+                {
+                    ++i;
+                }
+                counters_.n_is_safe += i - top.next_guess + (i < SIZE);
+                if (i < SIZE)
+                {
+                    set(top.cell, guess_num_[i]);
+                    top.next_guess = static_cast<uint8_t>(i + 1);
+                    stack_.entering = true;
+                    continue;
+                }
+            }
+            undo(top.mark);
+            --stack_.size;
         }
-        return false;
+    }
+
+    /**
+     * @brief Abandon the search started by `start_search()` and restore the board.
+     *
+     */
+    void end_search()
+    {
+        while (stack_.size > 0)
+        {
+            search_frame const &top = stack_.frames[--stack_.size];
+            if (top.cell != CELLS)
+            {
+                set(top.cell, EMPTY);
+            }
+            undo(top.mark);
+        }
+        stack_.entering = false;
     }
 
     /**
@@ -305,6 +734,9 @@ public:
     /**
      * @brief Returns a string describing the Sudoku's difficulty.
      *
+     * The thresholds are those of 9x9 boards, scaled to the number of cells.
+     * Boards with more empty cells than the hardest level's threshold get
+     * the hardest level.
      */
     std::string level() const
     {
@@ -313,7 +745,7 @@ public:
             int empty_cells;
             std::string description;
         } e2d;
-        auto difficulty = empty_count();
+        int const difficulty = (empty_count() * 81 + static_cast<int>(CELLS) / 2) / static_cast<int>(CELLS);
         static const std::vector<e2d> lvl = {
             {25, "LEAD"},
             {35, "GOLD"},
@@ -323,37 +755,39 @@ public:
             {64, "TUNGSTEN"}};
         auto const &it = std::find_if(lvl.begin(), lvl.end(), [difficulty](e2d const &c) -> bool
                                       { return difficulty <= c.empty_cells; });
-        return it->description;
-    }
-
-    /**
-     * @brief Get all calculated solutions of this Sudoku game.
-     *
-     * @return std::vector<board_t> const&
-     */
-    std::vector<board_t> const &solved_boards() const
-    {
-        return solved_boards_;
+        return it != lvl.end() ? it->description : lvl.back().description;
     }
 
     /**
      * @brief Place a digit on the flattened board at the specified index.
      *
+     * The row, column and box masks are updated accordingly.
+     * Pass `EMPTY` to clear the cell.
+     *
      * @param idx The index to place the digit at
      * @param value The digit to place
      */
     inline void set(unsigned int idx, char value)
     {
+        mask_t const old_bit = bit(board_[idx]);
+        mask_t const new_bit = bit(value);
+        unsigned int const row = idx / SIZE;
+        unsigned int const col = idx % SIZE;
+        unsigned int const box = BOX[idx];
+        row_mask_[row] = static_cast<mask_t>((row_mask_[row] & ~old_bit) | new_bit);
+        col_mask_[col] = static_cast<mask_t>((col_mask_[col] & ~old_bit) | new_bit);
+        box_mask_[box] = static_cast<mask_t>((box_mask_[box] & ~old_bit) | new_bit);
         board_[idx] = value;
     }
 
     /**
      * @brief Get the value at the specified index.
      *
+     * Use `set()` to change a cell, so that the candidate masks stay in sync.
+     *
      * @param idx
-     * @param value
      */
-    inline char &operator[](unsigned int idx)
+    inline char operator[](unsigned int idx) const
     {
         return board_[idx];
     }
@@ -380,13 +814,16 @@ public:
     }
 
     /**
-     * @brief Get the Mersenne-Twister based random number generator `sudoku` uses internally.
+     * @brief Get the random number generator the board draws from.
+     *
+     * That's the one passed via `set_rng()` or, if there's none,
+     * the calling thread's generator (see `thread_rng()`).
      *
-     * @return std::mt19937&
+     * @return rng_t&
      */
-    inline std::mt19937 &rng()
+    inline rng_t &rng()
     {
-        return rng_;
+        return rng_ != nullptr ? *rng_ : thread_rng();
     }
 
     /**
@@ -398,7 +835,7 @@ public:
      */
     inline void set(unsigned int row, unsigned int col, char num)
     {
-        board_[row * 9 + col] = num;
+        set(row * SIZE + col, num);
     }
 
     /**
@@ -410,14 +847,34 @@ public:
      */
     inline char get(unsigned int row, unsigned int col) const
     {
-        return board_.at(row * 9 + col);
+        return board_.at(row * SIZE + col);
+    }
+
+    /**
+     * @brief Get the digits that may be placed into a certain cell.
+     *
+     * Bit 0 stands for the first digit, bit `SIZE` - 1 for the last one.
+     *
+     * @param row the cell's row
+     * @param col the cell's column
+     * @return mask_t bit mask of allowed digits
+     */
+    inline mask_t candidates(unsigned int row, unsigned int col) const
+    {
+        return static_cast<mask_t>(~(row_mask_[row] | col_mask_[col] | box_mask_[(row / N) * N + col / N]) & ALL_DIGITS);
+    }
+
+    inline mask_t candidates(unsigned int idx) const
+    {
+        return candidates(idx / SIZE, idx % SIZE);
     }
 
     /**
      * @brief Check if placing a number at the designated destinaton is safe.
      *
      * The function check if the given number is either present in
-     * the given row or column or 3x3 box.
+     * the given row or column or box. It does so by looking up
+     * the occupancy masks maintained by `set()`.
      *
      * @param row row to place into
      * @param col column to place into
@@ -425,54 +882,292 @@ public:
      * @return true if safe
      * @return false otherwise
      */
-    bool is_safe(unsigned int row, unsigned int col, char num) const
+    inline bool is_safe(unsigned int row, unsigned int col, char num) const
+    {
+        return (candidates(row, col) & bit(num)) != 0;
+    }
+
+    inline bool is_safe(unsigned int idx, char num) const
+    {
+        unsigned int row = idx / SIZE;
+        unsigned int col = idx % SIZE;
+        return is_safe(row, col, num);
+    }
+
+    /**
+     * @brief Print the board, one row per line.
+     *
+     */
+    friend std::ostream &operator<<(std::ostream &os, const basic_sudoku &game)
+    {
+        for (unsigned int i = 0; i < CELLS; i += SIZE)
+        {
+            os.write(game.board_.data() + i, SIZE);
+            os << '\n';
+        }
+        return os;
+    }
+
+    /**
+     * @brief Mask with all `SIZE` digits set.
+     *
+     */
+    static constexpr mask_t ALL_DIGITS = static_cast<mask_t>((uint64_t{1} << SIZE) - 1);
+
+    /**
+     * @brief Get the char for a digit.
+     *
+     * @param d the digit's index, from 0 to `SIZE` - 1
+     * @return char '1' to '9', then 'A', 'B', ...
+     */
+    static constexpr char digit(unsigned int d)
+    {
+        return static_cast<char>(d < 9 ? '1' + d : 'A' + (d - 9));
+    }
+
+    /**
+     * @brief Convert a digit to its bit in a candidate mask.
+     *
+     * @param num a digit as written by `digit()`
+     * @return mask_t bit representing the digit, 0 for anything else
+     */
+    static constexpr mask_t bit(char num)
+    {
+        if constexpr (SIZE <= 9)
+        {
+            return num >= '1' && num < static_cast<char>('1' + SIZE)
+                       ? static_cast<mask_t>(1U << (num - '1'))
+                       : mask_t{0};
+        }
+        else
+        {
+            return num >= '1' && num <= '9'
+                       ? static_cast<mask_t>(1U << (num - '1'))
+                   : num >= 'A' && num < static_cast<char>('A' + (SIZE - 9))
+                       ? static_cast<mask_t>(1U << (num - 'A' + 9))
+                       : mask_t{0};
+        }
+    }
+
+private:
+    /**
+     * @brief Backtracker behind `solve()`, on the board's explicit search stack.
+     *
+     * @param on_solution visitor called for every solution
+     * @return false if the visitor stopped the search or it has been aborted, true otherwise
+     */
+    template <typename Visitor>
+    bool visit_solutions(Visitor &on_solution)
     {
-        // check row and column
-        unsigned int col_idx = col;
-        for (unsigned int row_idx = row * 9; row_idx < row * 9 + 9; ++row_idx)
+        if (aborted())
+        {
+            return false;
+        }
+        start_search();
+        while (true)
         {
-            if (board_.at(row_idx) == num)
+            switch (step())
             {
+            case step_result::running:
+                break;
+            case step_result::solution:
+                if (!on_solution(board_))
+                {
+                    end_search();
+                    return false;
+                }
+                break;
+            case step_result::exhausted:
+                return true;
+            default:
                 return false;
             }
-            if (board_.at(col_idx) == num)
+        }
+    }
+
+    inline bool aborted() const
+    {
+        return (abort_ != nullptr && abort_->load(std::memory_order_relaxed)) ||
+               counters_.n_nodes > node_limit_;
+    }
+
+    /**
+     * @brief Find the empty cell with the minimum number of remaining values.
+     *
+     * @param[out] row the row of the cell found, if any
+     * @param[out] col the columns of the cell found, if any
+     * @return true if an empty cell could be found
+     * @return false otherwise
+     */
+    bool find_mrv_cell(unsigned int &row, unsigned int &col) const
+    {
+        int best = SIZE + 1;
+        for (unsigned int i = 0; i < CELLS; ++i)
+        {
+            if (board_[i] != EMPTY)
             {
-                return false;
+                continue;
+            }
+            int const n = std::popcount(candidates(i));
+            if (n < best)
+            {
+                best = n;
+                row = i / SIZE;
+                col = i % SIZE;
+                if (n <= 1)
+                {
+                    // cannot get any better
+                    break;
+                }
             }
-            col_idx += 9;
         }
-        // check 3x3 box
-        row -= row % 3;
-        col -= col % 3;
-        for (unsigned int i = row; i < row + 3; ++i)
+        return best < static_cast<int>(SIZE) + 1;
+    }
+
+    /**
+     * @brief Place all naked singles, i.e. empty cells with a single candidate.
+     *
+     * Only active in `search_mode::mrv`. The cells placed are recorded in
+     * the trail so that `undo()` can take them back. 9x9 boards find the
+     * singles with a `propagate` kernel, a pass at a time; all others
+     * cell by cell. Either way the same cells get placed.
+     *
+     * @return false if an empty cell without any candidate was found, true otherwise
+     */
+    bool propagate_singles()
+    {
+        if (search_mode_ != search_mode::mrv)
+        {
+            return true;
+        }
+        if constexpr (N == 3)
+        {
+            return propagate_scanned_singles();
+        }
+        bool placed;
+        do
         {
-            for (unsigned int j = col; j < col + 3; ++j)
+            placed = false;
+            for (unsigned int i = 0; i < CELLS; ++i)
             {
-                if (get(i, j) == num)
+                if (board_[i] != EMPTY)
+                {
+                    continue;
+                }
+                mask_t const c = candidates(i);
+                if (c == 0)
                 {
                     return false;
                 }
+                if ((c & (c - 1)) == 0)
+                {
+                    set(i, digit(static_cast<unsigned int>(std::countr_zero(c))));
+                    trail_[trail_size_++] = static_cast<cell_t>(i);
+                    placed = true;
+                }
             }
-        }
+        } while (placed);
         return true;
     }
 
-    inline bool is_safe(unsigned int idx, char num) const
+    /**
+     * @brief `propagate_singles()` for 9x9 boards.
+     *
+     * All singles of a pass are placed together. A single whose digit an
+     * earlier one of the same pass took has no candidate left, as it would
+     * have if the singles had been placed one by one.
+     */
+    bool propagate_scanned_singles()
     {
-        unsigned int row = idx / 9;
-        unsigned int col = idx % 9;
-        return is_safe(row, col, num);
+        static_assert(EMPTY == propagate::EMPTY && ALL_DIGITS == propagate::ALL_DIGITS);
+        propagate::scan_result scan;
+        bool placed;
+        do
+        {
+            propagate::scan(row_mask_.data(), col_mask_.data(), box_mask_.data(), board_.data(), scan);
+            if (scan.contradiction)
+            {
+                return false;
+            }
+            placed = false;
+            for (unsigned int row = 0; row < SIZE; ++row)
+            {
+                for (unsigned int singles = scan.naked[row]; singles != 0; singles &= singles - 1)
+                {
+                    unsigned int const col = static_cast<unsigned int>(std::countr_zero(singles));
+                    unsigned int const i = row * SIZE + col;
+                    mask_t const c = scan.cand[row][col];
+                    if ((candidates(i) & c) == 0)
+                    {
+                        return false;
+                    }
+                    set(i, digit(static_cast<unsigned int>(std::countr_zero(c))));
+                    trail_[trail_size_++] = static_cast<cell_t>(i);
+                    placed = true;
+                }
+            }
+        } while (placed);
+        return true;
     }
 
-    friend std::ostream &operator<<(std::ostream &os, const sudoku &game);
+    /**
+     * @brief Clear all cells placed by `propagate_singles()` since `mark`.
+     *
+     * @param mark the trail size to return to
+     */
+    inline void undo(unsigned int mark)
+    {
+        while (trail_size_ > mark)
+        {
+            set(trail_[--trail_size_], EMPTY);
+        }
+    }
 
     /**
-     * @brief Value of an empty field
+     * @brief Empty the board without touching the guesses.
      *
      */
-    static constexpr char EMPTY = '0';
+    void clear()
+    {
+        std::fill(board_.begin(), board_.end(), EMPTY);
+        row_mask_.fill(0);
+        col_mask_.fill(0);
+        box_mask_.fill(0);
+        trail_size_ = 0;
+    }
+
+    /**
+     * @brief Recalculate the row, column and box masks from the board.
+     *
+     */
+    void update_masks()
+    {
+        row_mask_.fill(0);
+        col_mask_.fill(0);
+        box_mask_.fill(0);
+        for (unsigned int i = 0; i < CELLS; ++i)
+        {
+            mask_t const b = bit(board_[i]);
+            row_mask_[i / SIZE] |= b;
+            col_mask_[i % SIZE] |= b;
+            box_mask_[BOX[i]] |= b;
+        }
+    }
+
+    /**
+     * @brief Maps a cell index to the index of the box it belongs to.
+     *
+     */
+    static constexpr std::array<uint8_t, CELLS> BOX = []
+    {
+        std::array<uint8_t, CELLS> box{};
+        for (unsigned int i = 0; i < CELLS; ++i)
+        {
+            box[i] = static_cast<uint8_t>((i / (N * SIZE)) * N + (i % SIZE) / N);
+        }
+        return box;
+    }();
 
-private:
     /**
      * @brief Holds the Sudoku cells in a flattened array.
      *
@@ -480,30 +1175,65 @@ private:
     board_t board_;
 
     /**
-     * @brief Holds all solutions to the current game.
+     * @brief Digits present in each row, column and NxN box.
+     *
+     * Bit 0 stands for the first digit, bit `SIZE` - 1 for the last one.
+     */
+    std::array<mask_t, SIZE> row_mask_;
+    std::array<mask_t, SIZE> col_mask_;
+    std::array<mask_t, SIZE> box_mask_;
+
+    /**
+     * @brief Helper array with the shuffled digits
      *
      */
-    std::vector<board_t> solved_boards_;
+    std::array<char, SIZE> guess_num_;
 
     /**
-     * @brief Helper array with shuffled digits from 1 to 9
+     * @brief Cells placed by `propagate_singles()`, in order of placement.
      *
      */
-    std::array<char, 9> guess_num_;
+    std::array<cell_t, CELLS> trail_;
+    unsigned int trail_size_{0};
+
+    search_stack stack_;
 
     /**
-     * @brief Random number generator for a couple of uses.
+     * @brief Strategy for picking the cell to branch on.
      *
-     * The Mersenne-Twister is known for speed, quite good distribution
-     * and a looooooong period of 2^19937-1.
+     */
+    search_mode search_mode_{search_mode::mrv};
+
+    /**
+     * @brief If set, `solve()` stops when this flag becomes true.
      *
-     * A better variant of MT exists: SFMT is better in terms of speed
-     * and robustness against statistical tests.
-     * TODO: Exchange MT19937 for SFMT (http://www.math.sci.hiroshima-u.ac.jp/m-mat/MT/SFMT/)
      */
-    std::mt19937 rng_;
+    std::atomic<bool> const *abort_{nullptr};
+
+    /**
+     * @brief Work done since the last `take_counters()`.
+     *
+     * The backtrackers add their `is_safe()` calls once per node,
+     * not per call, to keep the innermost loop free of stores.
+     */
+    search_counters counters_;
+
+    /**
+     * @brief See `set_node_limit()`.
+     *
+     */
+    uint64_t node_limit_{std::numeric_limits<uint64_t>::max()};
+
+    /**
+     * @brief Caller-owned random number generator, if any.
+     *
+     * Boards don't own a generator, so they're cheap to construct.
+     */
+    rng_t *rng_{nullptr};
 };
 
+typedef basic_sudoku<3> sudoku;
+
 std::ostream &operator<<(std::ostream &, const sudoku::board_t &);
 
 #endif // __SUDOKU_HPP__
@@ -20,13 +20,29 @@
     SOFTWARE.
 */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <cstdlib>
-#include <string>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #include <getopt.hpp>
 
+#include "corpus.hpp"
+#include "sudoku.hpp"
 #include "util.hpp"
 
 namespace
@@ -35,18 +51,391 @@ namespace
     {
         std::cout
             << "USAGE:\n\n"
-               "  sudoku2svg SUDOKU_FILENAME SVG_FILENAME\n\n";
+               "  sudoku2svg SUDOKU_FILENAME SVG_FILENAME\n"
+               "  sudoku2svg --batch CORPUS [--out PREFIX] [--per-page N] [--columns N] [--cell-size PX] [-T THREADS]\n\n"
+               "--batch reads a corpus, text with one board per line or binary (.sdk),\n"
+               "or stdin (`-`), and writes the boards to PREFIX-0001.svg, PREFIX-0002.svg\n"
+               "and so on, N boards per sheet (1 by default), spread over THREADS threads.\n\n";
     }
 
+    /**
+     * @brief Renders boards into SVG sheets of `per_page` boards each, `columns` of them side by side.
+     *
+     * Everything that's the same on each sheet, the style and the grid, is
+     * built once. The grid goes into a `<symbol>` that each board `<use>`s,
+     * taking the stroke color from the board's group, and each cell's
+     * `<text>` tag is prebuilt, so a board costs about one short append per
+     * given. A sheet is built in a single buffer.
+     */
+    class sheet_renderer
+    {
+    public:
+        sheet_renderer(int cell_size, unsigned int per_page, unsigned int columns, std::string const &stroke_color)
+            : per_page_(per_page), columns_(columns)
+        {
+            int const padding = cell_size / 10;
+            int const grid_size = 9 * cell_size;
+            slot_size_ = grid_size + 2 * padding;
+            gap_ = per_page_ > 1 ? cell_size : 0;
+            unsigned int const rows = (per_page_ + columns_ - 1) / columns_;
+            std::ostringstream head;
+            head << "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"" << extent(columns_) << "\" height=\"" << extent(rows) << "\" version=\"1.1\">\n"
+                 << " <style>\n"
+                 << " text {\n"
+                 << "  font-family: \"Courier New\", Courier, monospace;\n"
+                 << "  font-size: " << (static_cast<float>(cell_size) / 1.618f) << "px;\n"
+                 << "  text-anchor: middle;\n"
+                 << "  dominant-baseline: middle;\n"
+                 << "  color: " << stroke_color << '\n'
+                 << " }\n"
+                 << " </style>\n"
+                 << " <defs>\n"
+                 << "  <symbol id=\"grid\" overflow=\"visible\">\n"
+                 << "   <rect x=\"0\" y=\"0\" width=\"" << grid_size << "\" height=\"" << grid_size << "\" fill=\"white\" />\n";
+            for (int i = 0; i < 10; ++i)
+            {
+                float stroke_width = (i % 3) == 0
+                                         ? 2.f
+                                         : 0.5f;
+                head << "   <line stroke-width=\"" << stroke_width << "\" x1=\"" << (i * cell_size) << "\" y1=\"0\" x2=\"" << (i * cell_size) << "\" y2=\"" << grid_size << "\"/>\n"
+                     << "   <line stroke-width=\"" << stroke_width << "\" x1=\"0\" y1=\"" << (i * cell_size) << "\" x2=\"" << grid_size << "\" y2=\"" << (i * cell_size) << "\"/>\n";
+            }
+            head << "  </symbol>\n"
+                 << " </defs>\n";
+            head_ = head.str();
+            for (unsigned int slot = 0; slot < per_page_; ++slot)
+            {
+                std::ostringstream open;
+                open << " <g transform=\"translate(" << (static_cast<int>(slot % columns_) * (slot_size_ + gap_) + padding) << " "
+                     << (static_cast<int>(slot / columns_) * (slot_size_ + gap_) + padding) << ")\" stroke=\"" << stroke_color << "\">\n"
+                     << "  <use xlink:href=\"#grid\"/>\n";
+                slot_open_.push_back(open.str());
+            }
+            for (int row = 0; row < 9; ++row)
+            {
+                for (int col = 0; col < 9; ++col)
+                {
+                    std::ostringstream cell;
+                    cell << "  <text x=\"" << ((col + 0.5) * cell_size) << "\" y=\"" << ((row + 0.5) * cell_size) << "\">";
+                    cell_open_[static_cast<std::size_t>(row * 9 + col)] = cell.str();
+                }
+            }
+        }
+
+        inline unsigned int per_page() const
+        {
+            return per_page_;
+        }
+
+        /**
+         * @brief Render `count` boards, starting at `boards`, as one sheet into `out`.
+         *
+         */
+        void render(sudoku::board_t const *boards, std::size_t count, std::string &out) const
+        {
+            out.clear();
+            out += head_;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                out += slot_open_[i];
+                sudoku::board_t const &board = boards[i];
+                for (std::size_t idx = 0; idx < board.size(); ++idx)
+                {
+                    if (board[idx] != sudoku::EMPTY)
+                    {
+                        out += cell_open_[idx];
+                        out += board[idx];
+                        out += "</text>\n";
+                    }
+                }
+                out += " </g>\n";
+            }
+            out += "</svg>\n";
+        }
+
+    private:
+        inline int extent(unsigned int n) const
+        {
+            return static_cast<int>(n) * slot_size_ + (static_cast<int>(n) - 1) * gap_;
+        }
+
+        unsigned int per_page_;
+        unsigned int columns_;
+        int slot_size_;
+        int gap_;
+        std::string head_;
+        std::vector<std::string> slot_open_;
+        std::array<std::string, 81> cell_open_;
+    };
+
+    /**
+     * @brief Reads the boards of a corpus, text or binary (see `corpus_writer`), one after the other, from a file or from stdin (`-`).
+     *
+     * Files are memory-mapped and read in place; stdin is read as the
+     * boards are asked for, so memory use doesn't depend on the size of
+     * the corpus. Boards that aren't valid (see `board_record::valid()`)
+     * and lines that don't hold a board are counted in `skipped()`.
+     * Not thread-safe.
+     */
+    class corpus_reader
+    {
+    public:
+        /**
+         * @return false if the corpus can't be read
+         */
+        bool open(std::string const &filename)
+        {
+            std::array<char, 4> magic{};
+            if (filename == "-")
+            {
+#ifdef _MSC_VER
+                // binary corpora must come through unchanged
+                _setmode(_fileno(stdin), _O_BINARY);
+#endif
+                std::ios::sync_with_stdio(false);
+                std::cin.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+                binary_ = std::cin.gcount() == static_cast<std::streamsize>(magic.size()) && magic == corpus_writer::MAGIC;
+                if (!binary_)
+                {
+                    // the start of the first line
+                    pending_.assign(magic.data(), static_cast<std::size_t>(std::cin.gcount()));
+                }
+                return true;
+            }
+            mapped_ = std::make_unique<util::mapped_file>(filename);
+            if (!mapped_->is_open())
+            {
+                return false;
+            }
+            pos_ = mapped_->data();
+            end_ = pos_ + mapped_->size();
+            binary_ = static_cast<std::size_t>(end_ - pos_) >= magic.size() && std::equal(corpus_writer::MAGIC.begin(), corpus_writer::MAGIC.end(), pos_);
+            if (binary_)
+            {
+                pos_ += magic.size();
+            }
+            return true;
+        }
+
+        /**
+         * @return false if there are no boards left
+         */
+        bool next(sudoku::board_t &board)
+        {
+            while (true)
+            {
+                board_record rec;
+                if (binary_)
+                {
+                    std::array<uint8_t, board_record::SIZE> raw;
+                    if (!read_record(raw))
+                    {
+                        return false;
+                    }
+                    rec = board_record::unpack(raw.data());
+                }
+                else
+                {
+                    char const *begin = nullptr;
+                    char const *end = nullptr;
+                    if (!read_line(begin, end))
+                    {
+                        return false;
+                    }
+                    if (!parse_board(begin, end, rec.board))
+                    {
+                        n_skipped_ += std::any_of(begin, end, [](char c)
+                                                  { return c != ' ' && c != '\t' && c != '\r'; });
+                        continue;
+                    }
+                    rec.difficulty = static_cast<uint8_t>(std::count(rec.board.begin(), rec.board.end(), sudoku::EMPTY));
+                    rec.generator = 0;
+                }
+                if (!rec.valid())
+                {
+                    ++n_skipped_;
+                    continue;
+                }
+                board = rec.board;
+                return true;
+            }
+        }
+
+        inline unsigned long long skipped() const
+        {
+            return n_skipped_;
+        }
+
+    private:
+        bool read_record(std::array<uint8_t, board_record::SIZE> &raw)
+        {
+            if (mapped_)
+            {
+                if (static_cast<std::size_t>(end_ - pos_) < raw.size())
+                {
+                    // a record cut short, e.g. by a crash while writing
+                    n_skipped_ += pos_ != end_;
+                    pos_ = end_;
+                    return false;
+                }
+                std::copy(pos_, pos_ + raw.size(), reinterpret_cast<char *>(raw.data()));
+                pos_ += raw.size();
+                return true;
+            }
+            std::cin.read(reinterpret_cast<char *>(raw.data()), static_cast<std::streamsize>(raw.size()));
+            n_skipped_ += std::cin.gcount() > 0 && std::cin.gcount() < static_cast<std::streamsize>(raw.size());
+            return std::cin.gcount() == static_cast<std::streamsize>(raw.size());
+        }
+
+        bool read_line(char const *&begin, char const *&end)
+        {
+            if (mapped_)
+            {
+                if (pos_ >= end_)
+                {
+                    return false;
+                }
+                char const *eol = std::find(pos_, end_, '\n');
+                begin = pos_;
+                end = eol;
+                pos_ = eol == end_ ? end_ : eol + 1;
+                return true;
+            }
+            std::string rest;
+            if (!std::getline(std::cin, rest) && pending_.empty())
+            {
+                return false;
+            }
+            line_ = pending_ + rest;
+            pending_.clear();
+            begin = line_.data();
+            end = begin + line_.size();
+            return true;
+        }
+
+        bool binary_{false};
+        std::unique_ptr<util::mapped_file> mapped_;
+        char const *pos_{nullptr};
+        char const *end_{nullptr};
+        std::string pending_;
+        std::string line_;
+        unsigned long long n_skipped_{0};
+    };
+
+    bool write_file(std::string const &filename, std::string const &data)
+    {
+        std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+        fout.write(data.data(), static_cast<std::streamsize>(data.size()));
+        return static_cast<bool>(fout);
+    }
+
+    /**
+     * @brief Render all boards of `corpus` onto sheets named `prefix` plus a running number, in `thread_count` threads.
+     *
+     * Each thread takes the boards for the next sheet from the reader,
+     * builds the sheet in its own buffer, which is reused from one sheet to
+     * the next, and writes it with a single write. So only as many boards
+     * as fit on a sheet are held per thread, however large the corpus is.
+     */
+    int render_batch(std::string const &corpus, std::string const &prefix, sheet_renderer const &renderer, unsigned int thread_count)
+    {
+        static constexpr std::size_t NUMBER_WIDTH = 4;
+        corpus_reader reader;
+        if (!reader.open(corpus))
+        {
+            std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot read " << corpus << ".\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << "Rendering " << (corpus == "-" ? std::string("stdin") : corpus) << " onto sheets " << prefix << "-*.svg ...\n";
+        std::mutex reader_mutex;
+        std::size_t n_sheets = 0;
+        unsigned long long n_boards = 0;
+        std::atomic<bool> failed{false};
+        auto render_sheets = [&]()
+        {
+            std::vector<sudoku::board_t> boards(renderer.per_page());
+            std::string buffer;
+            std::string filename;
+            while (!failed.load(std::memory_order_relaxed))
+            {
+                std::size_t count = 0;
+                std::size_t sheet;
+                {
+                    std::lock_guard<std::mutex> lock(reader_mutex);
+                    while (count < boards.size() && reader.next(boards[count]))
+                    {
+                        ++count;
+                    }
+                    if (count == 0)
+                    {
+                        break;
+                    }
+                    sheet = ++n_sheets;
+                    n_boards += count;
+                }
+                renderer.render(boards.data(), count, buffer);
+                std::string const number = std::to_string(sheet);
+                filename = prefix + '-' + std::string(NUMBER_WIDTH - std::min(number.size(), NUMBER_WIDTH), '0') + number + ".svg";
+                if (!write_file(filename, buffer))
+                {
+                    std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot write " << filename << ".\n";
+                    failed.store(true);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < std::max(1U, thread_count); ++i)
+        {
+            threads.emplace_back(render_sheets);
+        }
+        render_sheets();
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+        if (reader.skipped() > 0)
+        {
+            std::cerr << "\u001b[33;1mWARNING:\u001b[0m Skipped " << reader.skipped() << " lines or records that don't hold a valid board.\n";
+        }
+        if (failed.load())
+        {
+            return EXIT_FAILURE;
+        }
+        std::cout << "Rendered " << n_boards << " boards onto " << n_sheets << " sheets.\n"
+                  << "Ready.\n";
+        return EXIT_SUCCESS;
+    }
 }
 
 int main(int argc, char *argv[])
 {
     std::string sudoku_filename{};
     std::string svg_filename{};
+    std::string batch_filename{};
+    std::string prefix{"sudoku"};
+    int cell_size = 40;
+    unsigned int per_page = 1;
+    unsigned int columns = 0;
+    unsigned int thread_count{std::thread::hardware_concurrency()};
     using argparser = argparser::argparser;
     argparser opt(argc, argv);
     opt
+        .reg({"-?", "--help"}, argparser::no_argument, [](std::string const &)
+             {
+                usage();
+                exit(EXIT_SUCCESS); })
+        .reg({"--batch"}, argparser::required_argument, [&batch_filename](std::string const &val)
+             { batch_filename = val; })
+        .reg({"-o", "--out"}, argparser::required_argument, [&prefix](std::string const &val)
+             { prefix = val; })
+        .reg({"--per-page"}, argparser::required_argument, [&per_page](std::string const &val)
+             { per_page = static_cast<unsigned int>(std::max(1, std::stoi(val))); })
+        .reg({"--columns"}, argparser::required_argument, [&columns](std::string const &val)
+             { columns = static_cast<unsigned int>(std::max(1, std::stoi(val))); })
+        .reg({"--cell-size"}, argparser::required_argument, [&cell_size](std::string const &val)
+             { cell_size = std::max(10, std::stoi(val)); })
+        .reg({"-T", "--threads"}, argparser::required_argument, [&thread_count](std::string const &val)
+             { thread_count = static_cast<unsigned int>(std::stoi(val)); })
         .pos([&sudoku_filename](std::string const &val)
              { sudoku_filename = val; })
         .pos([&svg_filename](std::string const &val)
@@ -62,6 +451,17 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    std::string const stroke_color = "#222";
+    if (!batch_filename.empty())
+    {
+        if (columns == 0)
+        {
+            columns = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(per_page))));
+        }
+        sheet_renderer const renderer(cell_size, per_page, std::min(columns, per_page), stroke_color);
+        return render_batch(batch_filename, prefix, renderer, thread_count);
+    }
+
     if (sudoku_filename.empty() || svg_filename.empty())
     {
         std::cerr << "\u001b[31;1mERROR:\u001b[0m A filename is missing.\n\n";
@@ -77,51 +477,22 @@ int main(int argc, char *argv[])
     {
         data.append(line);
     }
-    data = util::trim(data, " \t\n\r");
-    if (data.length() != 81)
+    sudoku::board_t board;
+    if (!parse_board(data.data(), data.data() + data.size(), board))
     {
         std::cerr << "Board data must contain exactly 81 digits.\n";
         return EXIT_FAILURE;
     }
-    int cell_size = 40;
-    int padding = cell_size / 10;
-    std::string stroke_color = "#222";
 
     std::cout << "Writing SVG to " << svg_filename << " ...\n";
-    std::ofstream fout{svg_filename};
-    fout << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << (9 * cell_size + 2 * padding) << "\" height=\"" << (9 * cell_size + 2 * padding) << "\" version=\"1.1\">\n"
-         << " <style>\n"
-         << " text {\n"
-         << "  font-family: \"Courier New\", Courier, monospace;\n"
-         << "  font-size: " << (static_cast<float>(cell_size) / 1.618f) << "px;\n"
-         << "  text-anchor: middle;\n"
-         << "  dominant-baseline: middle;\n"
-         << "  color: " << stroke_color << '\n'
-         << " }\n"
-         << " </style>\n"
-         << " <g transform=\"translate(" << padding << " " << padding << ")\" stroke=\"" << stroke_color << "\">\n"
-         << "  <rect x=\"0\" y=\"0\" width=\"" << (9 * cell_size) << "\" height=\"" << (9 * cell_size) << "\" fill=\"white\" />\n";
-    for (int i = 0; i < 10; ++i)
+    sheet_renderer const renderer(cell_size, 1, 1, stroke_color);
+    std::string svg;
+    renderer.render(&board, 1, svg);
+    if (!write_file(svg_filename, svg))
     {
-        float stroke_width = (i % 3) == 0
-                                 ? 2.f
-                                 : 0.5f;
-        fout << "  <line stroke-width=\"" << stroke_width << "\" x1=\"" << (i * cell_size) << "\" y1=\"0\" x2=\"" << (i * cell_size) << "\" y2=\"" << (9 * cell_size) << "\"/>\n"
-             << "  <line stroke-width=\"" << stroke_width << "\" x1=\"0\" y1=\"" << (i * cell_size) << "\" x2=\"" << (9 * cell_size) << "\" y2=\"" << (i * cell_size) << "\"/>\n";
-    }
-    for (int row = 0; row < 9; ++row)
-    {
-        for (int col = 0; col < 9; ++col)
-        {
-            char cell = data.at(static_cast<size_t>(row * 9 + col));
-            if (cell != '0')
-            {
-                fout << "  <text x=\"" << ((col + 0.5) * cell_size) << "\" y=\"" << ((row + 0.5) * cell_size) << "\">" << cell << "</text>" << std::endl;
-            }
-        }
+        std::cerr << "\u001b[31;1mERROR:\u001b[0m Cannot write " << svg_filename << ".\n";
+        return EXIT_FAILURE;
     }
-    fout << " </g>\n"
-         << "</svg>\n";
     std::cout << "Ready.\n";
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,134 @@
+/*
+    Copyright (c) 2023 Oliver Lau, oliver@ersatzworld.net
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#ifndef __SYMMETRY_HPP__
+#define __SYMMETRY_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+
+#include "sudoku.hpp"
+
+/**
+ * @brief A validity-preserving transformation of a Sudoku board.
+ *
+ * Combines a relabelling of the digits, an order of the rows that keeps
+ * bands intact, an order of the columns that keeps stacks intact, and an
+ * optional transposition. A board with exactly one solution keeps exactly
+ * one solution, and the number of empty cells is unchanged, so transformed
+ * boards need not be checked again.
+ */
+struct symmetry
+{
+    typedef std::array<uint8_t, 9> line_order_t;
+
+    /**
+     * @brief Row `r` of the result is row `rows[r]` of the source.
+     *
+     */
+    line_order_t rows;
+
+    /**
+     * @brief Column `c` of the result is column `cols[c]` of the source.
+     *
+     */
+    line_order_t cols;
+
+    /**
+     * @brief Digit `d` becomes `digits[d]`; `digits[0]` must be 0, so empty cells stay empty.
+     *
+     */
+    std::array<uint8_t, 10> digits;
+
+    /**
+     * @brief Transpose after reordering.
+     *
+     */
+    bool transpose{false};
+
+    static symmetry identity()
+    {
+        symmetry s;
+        std::iota(s.rows.begin(), s.rows.end(), uint8_t{0});
+        std::iota(s.cols.begin(), s.cols.end(), uint8_t{0});
+        std::iota(s.digits.begin(), s.digits.end(), uint8_t{0});
+        return s;
+    }
+
+    /**
+     * @brief Draw a transformation uniformly from all 2 * 1296^2 * 9! of them.
+     *
+     * @param rng the random number generator to draw from
+     */
+    template <class RNG>
+    static symmetry random(RNG &rng)
+    {
+        symmetry s = identity();
+        random_line_order(s.rows, rng);
+        random_line_order(s.cols, rng);
+        std::shuffle(s.digits.begin() + 1, s.digits.end(), rng);
+        s.transpose = (rng() & 1) != 0;
+        return s;
+    }
+
+    /**
+     * @brief Transform a board.
+     *
+     * @param board the source board
+     * @return sudoku::board_t the transformed board
+     */
+    sudoku::board_t apply(sudoku::board_t const &board) const
+    {
+        sudoku::board_t result;
+        for (unsigned int r = 0; r < 9U; ++r)
+        {
+            for (unsigned int c = 0; c < 9U; ++c)
+            {
+                unsigned int const src = rows[r] * 9U + cols[c];
+                unsigned int const dst = transpose ? c * 9U + r : r * 9U + c;
+                result[dst] = static_cast<char>(sudoku::EMPTY + digits[static_cast<unsigned int>(board[src] - sudoku::EMPTY)]);
+            }
+        }
+        return result;
+    }
+
+private:
+    template <class RNG>
+    static void random_line_order(line_order_t &order, RNG &rng)
+    {
+        std::array<uint8_t, 3> groups{0, 1, 2};
+        std::shuffle(groups.begin(), groups.end(), rng);
+        for (unsigned int g = 0; g < 3U; ++g)
+        {
+            std::array<uint8_t, 3> lines{0, 1, 2};
+            std::shuffle(lines.begin(), lines.end(), rng);
+            for (unsigned int i = 0; i < 3U; ++i)
+            {
+                order[3 * g + i] = static_cast<uint8_t>(3 * groups[g] + lines[i]);
+            }
+        }
+    }
+};
+
+#endif // __SYMMETRY_HPP__
@@ -6,10 +6,16 @@
 
 #ifdef _MSC_VER
 #include <process.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 #include "util.hpp"
 
+#include <algorithm>
 #include <random>
 
 namespace util
@@ -67,4 +73,135 @@ namespace util
         return str.substr(start, actual_range);
     }
 
+#ifdef _MSC_VER
+    bool sync_file(std::string const &filename)
+    {
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        bool const ok = FlushFileBuffers(file) != 0;
+        CloseHandle(file);
+        return ok;
+    }
+
+    bool sync_directory_of(std::string const &)
+    {
+        return true;
+    }
+#else
+    bool sync_file(std::string const &filename)
+    {
+        int const fd = ::open(filename.c_str(), O_RDWR);
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool const ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+
+    bool sync_directory_of(std::string const &filename)
+    {
+        std::string::size_type const slash = filename.rfind('/');
+        std::string const dirname = slash == std::string::npos ? "." : filename.substr(0, std::max<std::string::size_type>(slash, 1));
+        int const fd = ::open(dirname.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool const ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+#endif
+
+#ifdef _MSC_VER
+    mapped_file::mapped_file(std::string const &filename, bool sequential)
+    {
+        file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS), nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            file_ = nullptr;
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size))
+        {
+            return;
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+        if (size_ > 0)
+        {
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping_ == nullptr)
+            {
+                return;
+            }
+            data_ = static_cast<char const *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+            if (data_ == nullptr)
+            {
+                return;
+            }
+        }
+        open_ = true;
+    }
+
+    mapped_file::~mapped_file()
+    {
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+        if (file_ != nullptr)
+        {
+            CloseHandle(file_);
+        }
+    }
+#else
+    mapped_file::mapped_file(std::string const &filename, bool sequential)
+    {
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0)
+        {
+            return;
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (p == MAP_FAILED)
+            {
+                return;
+            }
+            data_ = static_cast<char const *>(p);
+            madvise(p, size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        }
+        open_ = true;
+    }
+
+    mapped_file::~mapped_file()
+    {
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<char *>(data_), size_);
+        }
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+#endif
+
 }
@@ -1,6 +1,7 @@
 #ifndef __UTIL_HPP__
 #define __UTIL_HPP__
 
+#include <cstddef>
 #include <string>
 
 
@@ -8,6 +9,63 @@ namespace util
 {
     unsigned long make_seed();
     std::string trim(std::string const& str, std::string const & whitespace = " \t");
+
+    /**
+     * @brief Make sure what has been written to a file is on disk, not just in the OS's cache.
+     *
+     * @return false if the file can't be opened or flushed
+     */
+    bool sync_file(std::string const &filename);
+
+    /**
+     * @brief Make sure a file created or renamed in the directory of `filename` stays so after a crash.
+     *
+     * Does nothing on Windows, where renames are written through.
+     *
+     * @return false if the directory can't be opened or flushed
+     */
+    bool sync_directory_of(std::string const &filename);
+
+    /**
+     * @brief Read-only memory mapping of a whole file.
+     *
+     * `sequential` tells the OS that the file is going to be read from
+     * front to back, so it can read ahead; otherwise it's accessed at random.
+     */
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(std::string const &filename, bool sequential = true);
+        ~mapped_file();
+        mapped_file(mapped_file const &) = delete;
+        mapped_file &operator=(mapped_file const &) = delete;
+
+        inline bool is_open() const
+        {
+            return open_;
+        }
+
+        inline char const *data() const
+        {
+            return data_;
+        }
+
+        inline std::size_t size() const
+        {
+            return size_;
+        }
+
+    private:
+        char const *data_{nullptr};
+        std::size_t size_{0};
+        bool open_{false};
+#ifdef _MSC_VER
+        void *file_{nullptr};
+        void *mapping_{nullptr};
+#else
+        int fd_{-1};
+#endif
+    };
 }
 
 #endif // __UTIL_HPP__